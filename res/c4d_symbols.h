@@ -20,6 +20,34 @@ enum
   IDS_PASSWORD_EMPTY,
   IDS_PASSWORD_NOMATCH,
   IDS_PASSWORD_INVALID,
+  IDS_COMMAND_PREFERENCES_TITLE,
+  IDS_COMMAND_PREFERENCES_HELP,
+  IDS_PREFS_DEDUPE_ON_SAVE,
+  IDS_COMMAND_UPDATECONTAINER_TITLE,
+  IDS_COMMAND_UPDATECONTAINER_HELP,
+  IDS_INFO_NOCONTAINERINFILE,
+  IDS_PREFS_PROGRESSIVE_UNPACK,
+  IDS_STATUS_UNPACKING,
+  IDS_PREFS_COMPACT_ICONS,
+  IDS_PREFS_PROFILE_EVALUATION,
+  IDS_CACHEWARMUP,
+  IDS_PREFS_ICON_CACHE_BUDGET,
+  IDS_PREFS_WRITE_CATALOG,
+  IDS_PREFS_RECORD_TRACE,
+  IDS_STATUS_RECORDING_CACHE,
+  IDS_COMMAND_SOLOCONTAINER_TITLE,
+  IDS_COMMAND_SOLOCONTAINER_HELP,
+  IDS_INFO_CHECKPOINT_FAILED,
+  IDS_SELECTIONSUMMARY,
+  IDS_COMMAND_EXPORTCACHE_TITLE,
+  IDS_COMMAND_EXPORTCACHE_HELP,
+  IDS_TITLE_EXPORTCACHE,
+  IDS_INFO_EXPORTCACHE_FAILED,
+  IDS_STATUS_EXPORTING_CACHE,
+  IDS_DEDUPE,
+  IDS_CATALOG,
+  IDS_PLAYBACKCACHE,
+  IDS_CONTAINERAPI,
 };
 
 #endif // c4d_symbols_H
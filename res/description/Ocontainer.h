@@ -14,6 +14,12 @@ enum
   NRCONTAINER_ICON_LOAD = 2003,           // BUTTON
   NRCONTAINER_ICON_CLEAR = 2004,          // BUTTON
   NRCONTAINER_PACKUP = 2005,              // BUTTON
+  NRCONTAINER_PROMOTE_USERDATA = 2027,    // BUTTON
+  NRCONTAINER_BOUNDS_MODE = 2028,         // LONG
+    NRCONTAINER_BOUNDS_MODE_AABB = 0,
+    NRCONTAINER_BOUNDS_MODE_OBB = 1,
+  NRCONTAINER_INSTANCE_ON_LOCK = 2029,    // BOOL
+  NRCONTAINER_PLAYBACK_CACHE = 2030,      // BOOL
 
   NRCONTAINER_INFO = 2020,                // GROUP
   NRCONTAINER_INFO_NAME = 2021,           // STRING
@@ -23,7 +29,14 @@ enum
   NRCONTAINER_INFO_AUTHOR_EMAIL = 2025,   // STRING
   NRCONTAINER_INFO_DESCRIPTION = 2026,    // STRING
 
-  // Next ID: 2027
+  NRCONTAINER_CHECKPOINTS = 2031,         // GROUP
+  NRCONTAINER_CHECKPOINT_NAME = 2032,     // STRING
+  NRCONTAINER_CHECKPOINT_SAVE = 2033,     // BUTTON
+  NRCONTAINER_CHECKPOINT_RESTORE = 2034,  // BUTTON
+  NRCONTAINER_CHECKPOINT_DELETE = 2035,   // BUTTON
+  NRCONTAINER_CHECKPOINT_INFO = 2036,     // STATICTEXT
+
+  // Next ID: 2037
 };
 
 #endif // Ocontainer_H
@@ -8,12 +8,21 @@ CONTAINER Ocontainer {
     BOOL NRCONTAINER_HIDE_TAGS { DEFAULT 1; }
     BOOL NRCONTAINER_HIDE_MATERIALS { DEFAULT 1; }
     BOOL NRCONTAINER_GENERATOR_CHECKMARK { DEFAULT 1; }
+    BOOL NRCONTAINER_INSTANCE_ON_LOCK { }
+    BOOL NRCONTAINER_PLAYBACK_CACHE { }
+    LONG NRCONTAINER_BOUNDS_MODE {
+      CYCLE {
+        NRCONTAINER_BOUNDS_MODE_AABB;
+        NRCONTAINER_BOUNDS_MODE_OBB;
+      }
+    }
     GROUP {
       COLUMNS 3;
       BUTTON NRCONTAINER_ICON_LOAD { }
       BUTTON NRCONTAINER_ICON_CLEAR { }
       BUTTON NRCONTAINER_PACKUP { }
     }
+    BUTTON NRCONTAINER_PROMOTE_USERDATA { }
   }
   GROUP NRCONTAINER_INFO {
     STRING NRCONTAINER_INFO_NAME { }
@@ -23,4 +32,14 @@ CONTAINER Ocontainer {
     STRING NRCONTAINER_INFO_AUTHOR_EMAIL { }
     STRING NRCONTAINER_INFO_DESCRIPTION { CUSTOMGUI MULTISTRING; }
   }
+  GROUP NRCONTAINER_CHECKPOINTS {
+    STRING NRCONTAINER_CHECKPOINT_NAME { }
+    GROUP {
+      COLUMNS 3;
+      BUTTON NRCONTAINER_CHECKPOINT_SAVE { }
+      BUTTON NRCONTAINER_CHECKPOINT_RESTORE { }
+      BUTTON NRCONTAINER_CHECKPOINT_DELETE { }
+    }
+    STATICTEXT NRCONTAINER_CHECKPOINT_INFO { }
+  }
 }
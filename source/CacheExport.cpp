@@ -0,0 +1,148 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file CacheExport.cpp
+
+#include "CacheExport.h"
+#include "ContainerObject.h"
+#include "EvalProfile.h"
+#include "PlaybackCache.h"
+#include "Utils/GeometryCache.h"
+#include "Utils/Misc.h"
+#include "res/c4d_symbols.h"
+#include <Ocontainer.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Number of points converted and written at once.
+static const LONG BLOCK_POINTS = 4096;
+
+/// ***************************************************************************
+/// The mesh written for a polygon object. Slots are keyed by the marker of
+/// the object that generated it and its position among the objects of
+/// that one, as the caches are built again on every frame. The objects of
+/// a playback cache are rebuilt as well, they are keyed by their position
+/// only.
+/// ***************************************************************************
+struct ExportSlot
+{
+  uint32_t mesh;
+  LONG points;
+  LONG polygons;
+  uint64_t topology;   ///< Hash of the polygon indices.
+};
+
+typedef std::pair<std::string, LONG> ExportKey;
+
+/// ***************************************************************************
+/// Returns the FNV-1a hash of the polygon indices of \p poly.
+/// ***************************************************************************
+static uint64_t HashPolygons(PolygonObject* poly)
+{
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(poly->GetPolygonR());
+  const size_t size = (size_t) poly->GetPolygonCount() * sizeof(CPolygon);
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i=0; i < size; i++)
+    hash = (hash ^ data[i]) * 1099511628211ULL;
+  return hash;
+}
+
+/// ***************************************************************************
+/// Writes the points of \p source in \p frame, transformed by \p local.
+/// ***************************************************************************
+static Bool WritePoints(GeometryCacheWriter& writer, EvaluatedPolygon const& source,
+    Matrix const& local, LONG frame, uint32_t mesh, std::vector<float>& block)
+{
+  if (!writer.BeginPoints((int32_t) frame, mesh)) return false;
+  const LONG count = source.poly->GetPointCount();
+  const Vector* padr = source.poly->GetPointR();
+  const Matrix m = local * source.mg;
+  for (LONG start=0; start < count; start += BLOCK_POINTS)
+  {
+    const LONG end = std::min(count, start + BLOCK_POINTS);
+    for (LONG j=start; j < end; j++)
+    {
+      Vector p = m * padr[j];
+      float* out = &block[(size_t) (j - start) * 3];
+      out[0] = (float) p.x;
+      out[1] = (float) p.y;
+      out[2] = (float) p.z;
+    }
+    if (!writer.WritePoints(block.data(), (uint32_t) (end - start))) return false;
+  }
+  return writer.EndPoints();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool ExportContainerCache(BaseObject* op, BaseDocument* doc, Filename const& filename,
+    LONG first, LONG last)
+{
+  if (!op || op->GetType() != Ocontainer || !doc || last < first) return false;
+  GeometryCacheWriter writer;
+  if (!writer.Open(ToStdString(filename.GetString()))) return false;
+
+  static_assert(sizeof(CPolygon) == 4 * sizeof(int32_t), "CPolygon must be four indices");
+  const LONG fps = doc->GetFps();
+  const BaseTime time = doc->GetTime();
+  std::vector<EvaluatedPolygon> sources;
+  std::map<ExportKey, ExportSlot> slots;
+  std::unordered_map<std::string, LONG> ordinals;
+  std::vector<float> block((size_t) BLOCK_POINTS * 3);
+  Bool ok = true;
+  for (LONG frame = first; frame <= last && ok; frame++)
+  {
+    StatusSetText(GeLoadString(IDS_STATUS_EXPORTING_CACHE));
+    StatusSetBar(100 * (frame - first) / (last - first + 1));
+    doc->SetTime(BaseTime(frame, fps));
+    EvalProfileExecutePasses(op, doc);
+
+    // The hierarchy of a container with a playback cache is bypassed,
+    // its own cache holds the geometry.
+    sources.clear();
+    const Bool playback = ContainerHasPlaybackCache(op);
+    BaseObject* root = playback ? op->GetCache() : op->GetDown();
+    CollectEvaluatedPolygons(root, op->GetMg(), sources);
+
+    const Matrix local = ~op->GetMg();
+    ordinals.clear();
+    for (size_t i=0; i < sources.size() && ok; i++)
+    {
+      PolygonObject* poly = sources[i].poly;
+      const LONG points = poly->GetPointCount();
+      const LONG polygons = poly->GetPolygonCount();
+      const uint64_t topology = HashPolygons(poly);
+      std::string origin = playback ? std::string() : GetMarkerKey(sources[i].origin);
+      const LONG ordinal = ordinals[origin]++;
+      const ExportKey key(std::move(origin), ordinal);
+
+      // A mesh is only written again if its topology changed.
+      auto it = slots.find(key);
+      ExportSlot slot;
+      if (it != slots.end() && it->second.points == points &&
+          it->second.polygons == polygons && it->second.topology == topology)
+        slot = it->second;
+      else
+      {
+        slot.mesh = writer.AddMesh(ToStdString(poly->GetName()), (uint32_t) points,
+          (uint32_t) polygons, reinterpret_cast<const int32_t*>(poly->GetPolygonR()));
+        slot.points = points;
+        slot.polygons = polygons;
+        slot.topology = topology;
+        slots[key] = slot;
+      }
+      ok = WritePoints(writer, sources[i], local, frame, slot.mesh, block);
+    }
+  }
+  ok = writer.Close() && ok;
+
+  doc->SetTime(time);
+  EvalProfileExecutePasses(op, doc);
+  StatusClear();
+  return ok;
+}
@@ -0,0 +1,26 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file CacheExport.h
+///
+/// Exports the evaluated geometry of a container to a geometry cache (see
+/// Utils/GeometryCache.h) that can be read without Cinema 4D, eg. with
+/// the `cachereader` tool. The geometry is streamed to the file object by
+/// object, so the memory used doesn't depend on the size of the rig.
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+
+/// ***************************************************************************
+/// Evaluates \p doc at the frames \p first to \p last and writes the
+/// polygon objects generated by the hierarchy of the container \p op, in
+/// the space of \p op, to \p filename. Containers with a playback cache
+/// export the cached geometry. The time of \p doc is restored. Must be
+/// called from the main thread.
+/// ***************************************************************************
+Bool ExportContainerCache(BaseObject* op, BaseDocument* doc, Filename const& filename,
+    LONG first, LONG last);
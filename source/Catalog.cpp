@@ -0,0 +1,239 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Catalog.cpp
+
+#include "Catalog.h"
+#include "ContainerObject.h"
+#include "Dedupe.h"
+#include "Dependencies.h"
+#include "Preferences.h"
+#include "Utils/CatalogFile.h"
+#include "Utils/Misc.h"
+#include "res/c4d_symbols.h"
+#include <Ocontainer.h>
+#include <unordered_map>
+#include <unordered_set>
+
+enum
+{
+  ID_CATALOG = 1036120,
+  ID_CATALOGHOOK = 1036121,
+};
+
+/// Milliseconds between checks for stale save sessions.
+static const LONG STALE_INTERVAL = 100;
+
+/// ***************************************************************************
+/// Entries collected while a document is saved.
+/// ***************************************************************************
+struct CatalogSession
+{
+  std::vector<CatalogEntry> entries;
+  std::unordered_set<BaseObject*> pending;   ///< Containers that didn't finish the save yet.
+};
+
+// Only accessed from the main thread.
+static std::unordered_map<BaseDocument*, CatalogSession> g_sessions;
+
+/// ***************************************************************************
+/// Returns the session of \p doc, waking up the message plugin if it is
+/// a new one.
+/// ***************************************************************************
+static CatalogSession& GetSession(BaseDocument* doc)
+{
+  auto it = g_sessions.find(doc);
+  if (it != g_sessions.end()) return it->second;
+  SpecialEventAdd(ID_CATALOG);
+  return g_sessions[doc];
+}
+
+/// ***************************************************************************
+/// Returns the name of the catalog of \p doc saved as \p filename.
+/// ***************************************************************************
+static std::string GetCatalogFilename(BaseDocument* doc, Filename const& filename)
+{
+  Filename path = filename;
+  if (!path.Content())
+    path = doc->GetDocumentPath() + doc->GetDocumentName();
+  return ToStdString(path.GetString()) + CATALOG_EXTENSION;
+}
+
+/// ***************************************************************************
+/// Returns the names of \p op and its parents joined by slashes.
+/// ***************************************************************************
+static std::string GetObjectPath(BaseObject* op)
+{
+  std::string path;
+  for (; op; op = op->GetUp())
+  {
+    std::string name = ToStdString(op->GetName());
+    path = path.empty() ? name : name + "/" + path;
+  }
+  return path;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void CatalogBeginSave(BaseDocument* doc, BaseObject* op, DedupeState& dedupe,
+    std::vector<uint8_t> const& icon)
+{
+  if (!doc || !GetPrefBool(PREF_WRITE_CATALOG)) return;
+  BaseContainer* bc = op->GetDataInstance();
+  if (!bc) return;
+
+  CatalogEntry entry;
+  entry.path = GetObjectPath(op);
+  entry.name = ToStdString(bc->GetString(NRCONTAINER_INFO_NAME));
+  entry.version = ToStdString(bc->GetString(NRCONTAINER_INFO_VERSION));
+  entry.url = ToStdString(bc->GetString(NRCONTAINER_INFO_URL));
+  entry.author = ToStdString(bc->GetString(NRCONTAINER_INFO_AUTHOR));
+  entry.authorEmail = ToStdString(bc->GetString(NRCONTAINER_INFO_AUTHOR_EMAIL));
+  entry.description = ToStdString(bc->GetString(NRCONTAINER_INFO_DESCRIPTION));
+  if (ContainerIsProtected(op))
+    entry.flags |= CATALOGFLAG_PROTECTED;
+  entry.icon = icon;
+
+  // Textures and other files the container needs when it is published.
+  ContainerDependencies deps;
+  if (ContainerGetDependencies(op, deps))
+  {
+    for (Filename const& flname : deps.files)
+      entry.files.push_back(ToStdString(flname.GetString()));
+  }
+
+  // The key of the deduplication is the same fingerprint, don't compute
+  // it again if it is still valid.
+  if (DedupeVerify(op, dedupe))
+    entry.fingerprint = ToStdString(dedupe.key);
+  else
+    entry.fingerprint = ToStdString(DedupeFingerprint(op));
+
+  CatalogSession& session = GetSession(doc);
+  if (!session.pending.insert(op).second) return;
+  session.entries.push_back(std::move(entry));
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void CatalogEndSave(BaseDocument* doc, BaseObject* op, Filename const& filename)
+{
+  auto it = g_sessions.find(doc);
+  if (it == g_sessions.end()) return;
+  CatalogSession& session = it->second;
+  if (!session.pending.erase(op) || !session.pending.empty()) return;
+
+  std::string dest = GetCatalogFilename(doc, filename);
+  if (!CatalogWriteFile(dest, session.entries))
+    GePrint("Container Object: could not write " + String(dest.c_str()));
+  g_sessions.erase(it);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void CatalogForget(BaseObject* op)
+{
+  for (auto it = g_sessions.begin(); it != g_sessions.end(); )
+  {
+    if (it->second.pending.erase(op) && it->second.pending.empty())
+      it = g_sessions.erase(it);
+    else
+      ++it;
+  }
+}
+
+/// ***************************************************************************
+/// Called for MSG_DOCUMENTINFO_TYPE_SAVE_BEFORE of \p doc, before or after
+/// its containers.
+/// ***************************************************************************
+static void CatalogBeginDocument(BaseDocument* doc)
+{
+  if (!doc || !GetPrefBool(PREF_WRITE_CATALOG)) return;
+  GetSession(doc);
+}
+
+/// ***************************************************************************
+/// Called for MSG_DOCUMENTINFO_TYPE_SAVE_AFTER of \p doc. If no container
+/// added an entry, the catalog of an earlier save is removed, it would
+/// list containers that are no longer in the document.
+/// ***************************************************************************
+static void CatalogEndDocument(BaseDocument* doc, Filename const& filename)
+{
+  auto it = g_sessions.find(doc);
+  if (it == g_sessions.end() || !it->second.entries.empty()) return;
+  g_sessions.erase(it);
+
+  Filename dest(String(GetCatalogFilename(doc, filename).c_str()));
+  if (GeFExist(dest) && !GeFKill(dest))
+    GePrint("Container Object: could not remove " + dest.GetString());
+}
+
+/// ***************************************************************************
+/// Receives the save messages of the document itself, these are sent
+/// even if it has no containers.
+/// ***************************************************************************
+class CatalogSceneHook : public SceneHookData
+{
+  typedef SceneHookData super;
+
+public:
+
+  static NodeData* Alloc() { return gNew(CatalogSceneHook); }
+
+  virtual Bool Message(GeListNode* node, LONG msgType, void* pData) override
+  {
+    if (msgType == MSG_DOCUMENTINFO && pData)
+    {
+      DocumentInfoData* info = static_cast<DocumentInfoData*>(pData);
+      if (info->type == MSG_DOCUMENTINFO_TYPE_SAVE_BEFORE)
+        CatalogBeginDocument(info->doc);
+      else if (info->type == MSG_DOCUMENTINFO_TYPE_SAVE_AFTER)
+        CatalogEndDocument(info->doc, info->filename);
+    }
+    return super::Message(node, msgType, pData);
+  }
+
+};
+
+/// ***************************************************************************
+/// Saves are synchronous on the main thread, a session that is still
+/// open when the timer fires lost its SAVE_AFTER (eg. the save was
+/// aborted) and is dropped without writing the catalog.
+/// ***************************************************************************
+class CatalogMessage : public MessageData
+{
+public:
+
+  virtual LONG GetTimer()
+  {
+    return g_sessions.empty() ? 0 : STALE_INTERVAL;
+  }
+
+  virtual Bool CoreMessage(LONG id, const BaseContainer& bc)
+  {
+    if (id == MSG_TIMER) g_sessions.clear();
+    return true;
+  }
+
+};
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool RegisterCatalog()
+{
+  if (!RegisterSceneHookPlugin(
+      ID_CATALOGHOOK,
+      GeLoadString(IDS_CATALOG),
+      0,
+      CatalogSceneHook::Alloc,
+      EXECUTIONPRIORITY_INITIAL,
+      0))
+    return false;
+  return RegisterMessagePlugin(
+    ID_CATALOG,
+    GeLoadString(IDS_CATALOG),
+    0,
+    gNew(CatalogMessage));
+}
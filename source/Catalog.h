@@ -0,0 +1,48 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Catalog.h
+///
+/// When the #PREF_WRITE_CATALOG preference is enabled, a catalog of all
+/// containers is written next to the document when it is saved (see
+/// Utils/CatalogFile.h). Every container adds its entry to the save
+/// session of its document, and the last one to finish the save writes
+/// the file. A scene hook removes the catalog of a document that is saved
+/// without containers. Search catalogs with the `inspector` tool.
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+#include <cstdint>
+#include <vector>
+
+struct DedupeState;
+
+/// ***************************************************************************
+/// Called for MSG_DOCUMENTINFO_TYPE_SAVE_BEFORE, before the container
+/// \p op took part in the deduplication. Adds the entry of \p op with
+/// its encoded \p icon to the save session of \p doc.
+/// ***************************************************************************
+void CatalogBeginSave(BaseDocument* doc, BaseObject* op, DedupeState& dedupe,
+    std::vector<uint8_t> const& icon);
+
+/// ***************************************************************************
+/// Called for MSG_DOCUMENTINFO_TYPE_SAVE_AFTER. Writes the catalog next
+/// to \p filename if \p op is the last container of the session.
+/// ***************************************************************************
+void CatalogEndSave(BaseDocument* doc, BaseObject* op, Filename const& filename);
+
+/// ***************************************************************************
+/// Removes \p op from all save sessions when it is freed. A session that
+/// loses its last container is dropped without writing the catalog.
+/// ***************************************************************************
+void CatalogForget(BaseObject* op);
+
+/// ***************************************************************************
+/// Registers the scene hook that follows the saves of documents and the
+/// message plugin that drops save sessions that never ended.
+/// ***************************************************************************
+Bool RegisterCatalog();
@@ -0,0 +1,342 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Checkpoints.cpp
+
+#include "Checkpoints.h"
+#include "Utils/Fingerprint.h"
+#include "Utils/IconCodec.h"
+#include "Utils/Misc.h"
+#include <unordered_set>
+
+/// ***************************************************************************
+/// A compressed document holding a snapshot of a branch.
+/// ***************************************************************************
+struct CheckpointBlob
+{
+  std::vector<uint8_t> data;
+  size_t rawSize;
+  std::string markers;   ///< Markers of the saved nodes, see GetBranchMarkers().
+
+  CheckpointBlob() : rawSize(0) { }
+};
+
+/// ***************************************************************************
+/// Saves \p op into a compressed document, or the tags of \p tagOwner on
+/// a Null-Object if \p op is \c nullptr. The nodes keep their markers, so
+/// links to them and from them to nodes outside of the snapshot (eg.
+/// materials) are resolved again when the snapshot is restored.
+/// ***************************************************************************
+static std::shared_ptr<CheckpointBlob> Snapshot(BaseObject* op, BaseObject* tagOwner)
+{
+  BaseObject* root = nullptr;
+  if (op)
+    root = static_cast<BaseObject*>(op->GetClone(COPYFLAGS_PRIVATE_IDENTMARKER, nullptr));
+  else
+  {
+    root = BaseObject::Alloc(Onull);
+    BaseTag* pred = nullptr;
+    for (BaseTag* tag = tagOwner->GetFirstTag(); root && tag; tag = tag->GetNext())
+    {
+      BaseTag* clone = static_cast<BaseTag*>(tag->GetClone(COPYFLAGS_PRIVATE_IDENTMARKER, nullptr));
+      if (!clone) continue;
+      root->InsertTag(clone, pred);
+      pred = clone;
+    }
+  }
+  if (!root) return nullptr;
+
+  BaseDocument* doc = BaseDocument::Alloc();
+  AutoAlloc<MemoryFileStruct> mfs;
+  if (!doc || !mfs)
+  {
+    BaseObject::Free(root);
+    BaseDocument::Free(doc);
+    return nullptr;
+  }
+  doc->InsertObject(root, nullptr, nullptr);
+  Bool ok = SaveDocument(doc, mfs->GetFilename(), SAVEDOCUMENTFLAGS_DONTADDTORECENTLIST, FORMAT_C4DEXPORT);
+  BaseDocument::Free(doc);
+
+  void* mem = nullptr;
+  VLONG size = 0;
+  if (ok) mfs->GetData(mem, size, false);
+  if (!mem || size <= 0) return nullptr;
+
+  std::shared_ptr<CheckpointBlob> blob = std::make_shared<CheckpointBlob>();
+  blob->rawSize = (size_t) size;
+  LZCompress(static_cast<const uint8_t*>(mem), (size_t) size, blob->data);
+  return blob;
+}
+
+/// ***************************************************************************
+/// Loads the document of a snapshot. Returns \c nullptr if it is corrupt.
+/// ***************************************************************************
+static BaseDocument* LoadSnapshot(CheckpointBlob const& blob)
+{
+  std::vector<uint8_t> raw(blob.rawSize);
+  if (!LZDecompress(blob.data.data(), blob.data.size(), raw.data(), raw.size()))
+    return nullptr;
+  AutoAlloc<MemoryFileStruct> mfs;
+  if (!mfs) return nullptr;
+  mfs->SetData(raw.data(), (VLONG) raw.size(), false);
+  BaseDocument* doc = LoadDocument(mfs->GetFilename(), SCENEFILTER_OBJECTS, nullptr);
+  if (doc && !doc->GetFirstObject())
+  {
+    KillDocument(doc);
+    return nullptr;
+  }
+  return doc;
+}
+
+/// ***************************************************************************
+/// Adds the branch starting at \p op to \p fp. Links are hashed by their
+/// position in the hierarchy indexed in \p fp.
+/// ***************************************************************************
+static void AddBranch(Fingerprint& fp, BaseObject* op)
+{
+  fp.AddNode(op);
+  for (BaseTag* tag = op->GetFirstTag(); tag; tag = tag->GetNext())
+    fp.AddNode(tag);
+  for (NodeIterator<BaseObject> it(op->GetDown(), op); it; ++it)
+  {
+    LONG depth = 0;
+    for (BaseObject* up = it->GetUp(); up && up != op; up = up->GetUp())
+      depth++;
+    fp.AddLong(depth);
+    fp.AddNode(*it);
+    for (BaseTag* tag = it->GetFirstTag(); tag; tag = tag->GetNext())
+      fp.AddNode(tag);
+  }
+}
+
+/// ***************************************************************************
+/// Returns the markers of the branch starting at \p op and its tags, or
+/// of the tags of \p tagOwner if \p op is \c nullptr. The snapshots keep
+/// the markers, which the fingerprint doesn't cover.
+/// ***************************************************************************
+static std::string GetBranchMarkers(BaseObject* op, BaseObject* tagOwner)
+{
+  std::string markers;
+  if (!op)
+  {
+    for (BaseTag* tag = tagOwner->GetFirstTag(); tag; tag = tag->GetNext())
+      markers += GetMarkerKey(tag);
+    return markers;
+  }
+  markers += GetMarkerKey(op);
+  for (BaseTag* tag = op->GetFirstTag(); tag; tag = tag->GetNext())
+    markers += GetMarkerKey(tag);
+  for (NodeIterator<BaseObject> it(op->GetDown(), op); it; ++it)
+  {
+    markers += GetMarkerKey(*it);
+    for (BaseTag* tag = it->GetFirstTag(); tag; tag = tag->GetNext())
+      markers += GetMarkerKey(tag);
+  }
+  return markers;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Checkpoint* CheckpointList::Find(String const& name)
+{
+  if (m_checkpoints.empty()) return nullptr;
+  if (!name.Content()) return &m_checkpoints.back();
+  for (Checkpoint& checkpoint : m_checkpoints)
+  {
+    if (checkpoint.name == name)
+      return &checkpoint;
+  }
+  return nullptr;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+std::shared_ptr<CheckpointBlob> CheckpointList::Share(std::string const& key,
+    BaseObject* op, BaseObject* tagOwner, LONG* shared)
+{
+  std::string markers = GetBranchMarkers(op, tagOwner);
+  std::shared_ptr<CheckpointBlob> blob = m_blobs[key].lock();
+  if (blob && blob->markers == markers)
+  {
+    if (shared) (*shared)++;
+    return blob;
+  }
+  blob = Snapshot(op, tagOwner);
+  if (!blob) return nullptr;
+  blob->markers = std::move(markers);
+  m_blobs[key] = blob;
+  return blob;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool CheckpointList::Save(BaseObject* op, String const& name, LONG* shared)
+{
+  if (!op) return false;
+  Checkpoint checkpoint;
+  checkpoint.name = name;
+  if (shared) *shared = 0;
+
+  // The same content at the same position is the same snapshot. The
+  // position is part of the key as the snapshot keeps the markers of
+  // the nodes, identical siblings must not share them.
+  Fingerprint fp(op->GetDocument());
+  fp.IndexHierarchy(op);
+  LONG position = 0;
+  for (BaseObject* child = op->GetDown(); child; child = child->GetNext())
+  {
+    fp.AddLong(position++);
+    AddBranch(fp, child);
+    std::shared_ptr<CheckpointBlob> blob = Share(ToStdString(fp.GetHash()), child, nullptr, shared);
+    if (!blob) return false;
+    checkpoint.branches.push_back(blob);
+  }
+
+  if (op->GetFirstTag())
+  {
+    fp.AddLong(NOTOK);
+    for (BaseTag* tag = op->GetFirstTag(); tag; tag = tag->GetNext())
+      fp.AddNode(tag);
+    checkpoint.tags = Share(ToStdString(fp.GetHash()), nullptr, op, nullptr);
+    if (!checkpoint.tags) return false;
+  }
+
+  Checkpoint* existing = name.Content() ? Find(name) : nullptr;
+  if (existing)
+    *existing = std::move(checkpoint);
+  else
+    m_checkpoints.push_back(std::move(checkpoint));
+
+  // Drop the keys of snapshots no checkpoint uses anymore.
+  for (auto it = m_blobs.begin(); it != m_blobs.end(); )
+  {
+    if (it->second.expired()) it = m_blobs.erase(it);
+    else ++it;
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool CheckpointList::Restore(BaseObject* op, String const& name, BaseDocument* doc)
+{
+  Checkpoint* checkpoint = Find(name);
+  if (!op || !checkpoint) return false;
+
+  // Load all snapshots before the hierarchy is touched.
+  std::vector<BaseDocument*> branches;
+  BaseDocument* tags = nullptr;
+  Bool ok = true;
+  for (std::shared_ptr<CheckpointBlob> const& blob : checkpoint->branches)
+  {
+    BaseDocument* loaded = LoadSnapshot(*blob);
+    if (!loaded)
+    {
+      ok = false;
+      break;
+    }
+    branches.push_back(loaded);
+  }
+  if (ok && checkpoint->tags)
+  {
+    tags = LoadSnapshot(*checkpoint->tags);
+    ok = tags != nullptr;
+  }
+  if (!ok)
+  {
+    for (BaseDocument* loaded : branches)
+      KillDocument(loaded);
+    return false;
+  }
+
+  // The removed nodes are owned by the undo from here on.
+  while (BaseObject* child = op->GetDown())
+    RemoveWithUndo(child, doc);
+  while (BaseTag* tag = op->GetFirstTag())
+    RemoveWithUndo(tag, doc);
+
+  BaseObject* pred = nullptr;
+  for (BaseDocument* loaded : branches)
+  {
+    BaseObject* child = loaded->GetFirstObject();
+    child->Remove();
+    if (pred) child->InsertAfter(pred);
+    else child->InsertUnder(op);
+    if (doc) doc->AddUndo(UNDOTYPE_NEW, child);
+    pred = child;
+    KillDocument(loaded);
+  }
+  if (tags)
+  {
+    BaseObject* holder = tags->GetFirstObject();
+    BaseTag* predTag = nullptr;
+    while (BaseTag* tag = holder->GetFirstTag())
+    {
+      tag->Remove();
+      op->InsertTag(tag, predTag);
+      if (doc) doc->AddUndo(UNDOTYPE_NEW, tag);
+      predTag = tag;
+    }
+    KillDocument(tags);
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool CheckpointList::Remove(String const& name)
+{
+  Checkpoint* checkpoint = Find(name);
+  if (!checkpoint) return false;
+  m_checkpoints.erase(m_checkpoints.begin() + (checkpoint - m_checkpoints.data()));
+  for (auto it = m_blobs.begin(); it != m_blobs.end(); )
+  {
+    if (it->second.expired()) it = m_blobs.erase(it);
+    else ++it;
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void CheckpointList::Flush()
+{
+  m_checkpoints.clear();
+  m_blobs.clear();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+size_t CheckpointList::GetMemory() const
+{
+  std::unordered_set<CheckpointBlob const*> counted;
+  size_t bytes = 0;
+  for (Checkpoint const& checkpoint : m_checkpoints)
+  {
+    for (std::shared_ptr<CheckpointBlob> const& blob : checkpoint.branches)
+    {
+      if (counted.insert(blob.get()).second)
+        bytes += blob->data.size();
+    }
+    if (checkpoint.tags && counted.insert(checkpoint.tags.get()).second)
+      bytes += checkpoint.tags->data.size();
+  }
+  return bytes;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+String CheckpointList::GetSummary() const
+{
+  if (m_checkpoints.empty()) return String();
+  String names;
+  for (Checkpoint const& checkpoint : m_checkpoints)
+  {
+    if (names.Content()) names += ", ";
+    names += checkpoint.name;
+  }
+  return names + " (" + LongToString((LONG) (GetMemory() / 1024)) + " KB)";
+}
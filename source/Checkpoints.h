@@ -0,0 +1,76 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Checkpoints.h
+///
+/// Named in-memory checkpoints of the hierarchy of a container. Every
+/// branch below the container is saved as a compressed document snapshot.
+/// Snapshots are keyed by the content fingerprint of their branch, so
+/// checkpoints share the snapshots of the branches that did not change
+/// between them.
+/// Checkpoints are not saved with the document and not copied with the
+/// container.
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct CheckpointBlob;
+
+/// ***************************************************************************
+/// ***************************************************************************
+struct Checkpoint
+{
+  String name;
+  std::vector<std::shared_ptr<CheckpointBlob>> branches;   ///< One per child of the container.
+  std::shared_ptr<CheckpointBlob> tags;                    ///< The tags of the container, may be \c nullptr.
+};
+
+/// ***************************************************************************
+/// The checkpoints of a container.
+/// ***************************************************************************
+class CheckpointList
+{
+  std::vector<Checkpoint> m_checkpoints;
+  std::unordered_map<std::string, std::weak_ptr<CheckpointBlob>> m_blobs;
+
+  Checkpoint* Find(String const& name);
+
+  /// Returns the snapshot with the fingerprint \p key if its nodes have
+  /// the same markers and counts it in \p shared. Otherwise takes a new
+  /// snapshot of \p op or of the tags of \p tagOwner.
+  std::shared_ptr<CheckpointBlob> Share(std::string const& key, BaseObject* op,
+      BaseObject* tagOwner, LONG* shared);
+
+public:
+
+  /// Saves the hierarchy and tags of \p op as the checkpoint \p name,
+  /// replacing a checkpoint with the same name. \p shared receives the
+  /// number of branches that were taken from earlier checkpoints.
+  Bool Save(BaseObject* op, String const& name, LONG* shared=nullptr);
+
+  /// Replaces the hierarchy and tags of \p op by the checkpoint \p name,
+  /// or by the last checkpoint if \p name is empty. Undos are added to
+  /// \p doc if it is not \c nullptr.
+  Bool Restore(BaseObject* op, String const& name, BaseDocument* doc);
+
+  /// Deletes the checkpoint \p name, or the last one if \p name is empty.
+  Bool Remove(String const& name);
+
+  void Flush();
+
+  LONG GetCount() const { return (LONG) m_checkpoints.size(); }
+
+  /// Returns the compressed size of all snapshots.
+  size_t GetMemory() const;
+
+  /// Returns the names of the checkpoints and their memory usage.
+  String GetSummary() const;
+};
@@ -16,7 +16,19 @@
 #include <c4d_apibridge.h>
 #include <Ocontainer.h>
 #include "res/c4d_symbols.h"
+#include "CacheExport.h"
+#include "Commands.h"
 #include "ContainerObject.h"
+#include "SelectionSummary.h"
+#include "Solo.h"
+#include "Utils/Fingerprint.h"
+#include "Utils/Misc.h"
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 using c4d_apibridge::IsEmpty;
 
@@ -24,6 +36,9 @@ enum
 {
   ID_COMMAND_LOADCONTAINER = 1030970,
   ID_COMMAND_CONVERTCONTAINER = 1030971,
+  ID_COMMAND_UPDATECONTAINER = 1036109,
+  ID_COMMAND_SOLOCONTAINER = 1036115,
+  ID_COMMAND_EXPORTCACHE = 1036118,
 };
 
 static Bool GetState(CommandData* dat, BaseDocument* doc, GeDialog* parentManager) {
@@ -64,7 +79,7 @@ static Bool CopyBranchesTo(GeListNode* src, GeListNode* dst, COPYFLAGS flags,
     // Search for a branch with a matching base id.
     for (LONG j=0; j < branchcount_dst; j++)
     {
-      const BranchInfo& branch_dst = branches_dst[i];
+      const BranchInfo& branch_dst = branches_dst[j];
 
       Bool valid = branch_src.id == branch_dst.id;
       valid = valid && branch_src.head && branch_dst.head;
@@ -206,15 +221,327 @@ static Bool ReplaceObjects(
   if (doc)
     doc->AddUndo(UNDOTYPE_NEW, new_op);
 
-  if (doc)
-    doc->AddUndo(UNDOTYPE_DELETE, old_op);
-  old_op->Remove();
-
   if (at)
     at->Translate(true);
+  RemoveWithUndo(old_op, doc);
   return true;
 }
 
+/// ***************************************************************************
+/// Adds the selected objects of \p doc that are instances of \p type to
+/// \p out, parents before their children.
+/// ***************************************************************************
+static void GetSelectedObjects(BaseDocument* doc, LONG type, std::vector<BaseObject*>& out)
+{
+  AutoAlloc<AtomArray> selection;
+  if (!selection) return;
+  doc->GetActiveObjects(selection, GETACTIVEOBJECTFLAGS_0);
+  for (LONG i=0; i < selection->GetCount(); i++)
+  {
+    BaseObject* op = static_cast<BaseObject*>(selection->GetIndex(i));
+    if (op && op->IsInstanceOf(type))
+      out.push_back(op);
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+BaseObject* ConvertNullToContainer(BaseObject* op, BaseDocument* doc)
+{
+  if (!op || !op->IsInstanceOf(Onull)) return nullptr;
+  AliasTrans* at = nullptr; // @FUTURE_EXT_OP
+  BaseObject* root = BaseObject::Alloc(Ocontainer);
+  if (!root) return nullptr;
+
+  BaseContainer* bc = op->GetDataInstance();
+  CriticalAssert(bc != nullptr);
+  String hash = bc->GetString(CONTAINEROBJECT_PROTECTIONHASH);
+  if (!IsEmpty(hash))
+  {
+    ContainerProtect(root, "", hash, false);
+  }
+
+  ReplaceObjects(op, root, doc, at);
+  return root;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+BaseObject* ConvertContainerToNull(BaseObject* op, BaseDocument* doc)
+{
+  if (!op || !op->IsInstanceOf(Ocontainer)) return nullptr;
+  AliasTrans* at = nullptr; // @FUTURE_EXT_OP
+  BaseObject* root = BaseObject::Alloc(Onull);
+  if (!root) return nullptr;
+
+  String hash = "";
+  if (ContainerIsProtected(op, &hash))
+  {
+    BaseContainer* bc = root->GetDataInstance();
+    CriticalAssert(bc != nullptr);
+    bc->SetString(CONTAINEROBJECT_PROTECTIONHASH, hash);
+  }
+
+  ReplaceObjects(op, root, doc, at);
+  return root;
+}
+
+/// ***************************************************************************
+/// State of an UpdateHierarchy() call. The fingerprints index the
+/// hierarchies of both containers, so links inside of them compare equal.
+/// ***************************************************************************
+struct UpdateContext
+{
+  BaseDocument* doc;
+  AliasTrans* at;
+  Fingerprint fpOld;
+  Fingerprint fpNew;
+  LONG patched;
+  LONG tags;
+  LONG added;
+  LONG removed;
+  LONG materials;
+  std::vector<BaseObject*> inserted;                    ///< Cloned objects.
+  std::unordered_map<BaseList2D*, BaseMaterial*> reuse; ///< Materials of the source that already exist.
+
+  UpdateContext(BaseDocument* doc, BaseDocument* src, AliasTrans* at)
+  : doc(doc), at(at), fpOld(doc), fpNew(src), patched(0), tags(0),
+    added(0), removed(0), materials(0) { }
+};
+
+/// ***************************************************************************
+/// The nodes of a list by type and name, in list order. Built once per
+/// list, so matching the nodes of wide lists doesn't search the whole list
+/// for every node.
+/// ***************************************************************************
+template <typename T>
+class SiblingIndex
+{
+  std::unordered_map<std::string, std::deque<T*>> m_nodes;
+
+  static std::string GetKey(T* node)
+  {
+    return ToStdString(LongToString(node->GetType()) + ":" + node->GetName());
+  }
+
+public:
+
+  explicit SiblingIndex(T* first)
+  {
+    for (T* node = first; node; node = node->GetNext())
+      m_nodes[GetKey(node)].push_back(node);
+  }
+
+  /// Returns the first node with the type and name of \p ref that was not
+  /// taken yet, or \c nullptr.
+  T* Take(T* ref)
+  {
+    auto it = m_nodes.find(GetKey(ref));
+    if (it == m_nodes.end() || it->second.empty()) return nullptr;
+    T* node = it->second.front();
+    it->second.pop_front();
+    return node;
+  }
+};
+
+/// ***************************************************************************
+/// Patches the tags of \p dst to match the ones of \p src. Tags are
+/// matched by type and name and only changed tags are copied, so links to
+/// the others are kept. The point and polygon tags hold the geometry that
+/// is part of the object's fingerprint, they are copied if \p geometry is
+/// \c true.
+/// ***************************************************************************
+static void UpdateTags(BaseObject* dst, BaseObject* src, Bool geometry, UpdateContext& ctx)
+{
+  SiblingIndex<BaseTag> index(dst->GetFirstTag());
+  std::unordered_set<BaseTag*> matched;
+  BaseTag* pred = nullptr;
+  for (BaseTag* tag = src->GetFirstTag(); tag; tag = tag->GetNext())
+  {
+    BaseTag* match = index.Take(tag);
+    if (!match)
+    {
+      BaseTag* clone = static_cast<BaseTag*>(tag->GetClone(COPYFLAGS_0, ctx.at));
+      if (!clone) continue;
+      dst->InsertTag(clone, pred);
+      ctx.doc->AddUndo(UNDOTYPE_NEW, clone);
+      matched.insert(clone);
+      pred = clone;
+      ctx.tags++;
+      continue;
+    }
+    matched.insert(match);
+    pred = match;
+
+    ctx.fpOld.AddNode(match);
+    ctx.fpNew.AddNode(tag);
+    Bool changed = ctx.fpOld.GetHash() != ctx.fpNew.GetHash();
+    if (changed || (geometry && (tag->IsInstanceOf(Tpoint) || tag->IsInstanceOf(Tpolygon))))
+    {
+      ctx.doc->AddUndo(UNDOTYPE_CHANGE, match);
+      tag->CopyTo(match, COPYFLAGS_0, ctx.at);
+      ctx.tags++;
+    }
+  }
+
+  BaseTag* tag = dst->GetFirstTag();
+  while (tag)
+  {
+    BaseTag* next = tag->GetNext();
+    if (!matched.count(tag))
+    {
+      RemoveWithUndo(tag, ctx.doc);
+      ctx.tags++;
+    }
+    tag = next;
+  }
+}
+
+/// ***************************************************************************
+/// Patches the hierarchy below \p dst to match the one below \p src.
+/// Objects are matched by type and name. Objects and tags whose content
+/// hash is unchanged are not touched, thus links to them and local
+/// overrides on them are kept.
+/// ***************************************************************************
+static void UpdateHierarchy(BaseObject* dst, BaseObject* src, UpdateContext& ctx)
+{
+  SiblingIndex<BaseObject> index(dst->GetDown());
+  std::unordered_set<BaseObject*> matched;
+  BaseObject* pred = nullptr;
+  for (BaseObject* child = src->GetDown(); child; child = child->GetNext())
+  {
+    BaseObject* match = index.Take(child);
+    if (!match)
+    {
+      BaseObject* clone = static_cast<BaseObject*>(child->GetClone(COPYFLAGS_0, ctx.at));
+      if (!clone) continue;
+      if (pred) clone->InsertAfter(pred);
+      else clone->InsertUnder(dst);
+      ctx.doc->AddUndo(UNDOTYPE_NEW, clone);
+      ctx.inserted.push_back(clone);
+      matched.insert(clone);
+      pred = clone;
+      ctx.added++;
+      continue;
+    }
+    matched.insert(match);
+    pred = match;
+
+    ctx.fpOld.AddNode(match);
+    ctx.fpNew.AddNode(child);
+    Bool changed = ctx.fpOld.GetHash() != ctx.fpNew.GetHash();
+    if (changed)
+    {
+      ctx.doc->AddUndo(UNDOTYPE_CHANGE_NOCHILDREN, match);
+      child->CopyTo(match, COPYFLAGS_NO_HIERARCHY | COPYFLAGS_NO_BRANCHES, ctx.at);
+      ctx.patched++;
+    }
+    UpdateTags(match, child, changed, ctx);
+    UpdateHierarchy(match, child, ctx);
+  }
+
+  // Remove all objects that are not in the new version.
+  BaseObject* op = dst->GetDown();
+  while (op)
+  {
+    BaseObject* next = op->GetNext();
+    if (!matched.count(op))
+    {
+      RemoveWithUndo(op, ctx.doc);
+      ctx.removed++;
+    }
+    op = next;
+  }
+}
+
+/// ***************************************************************************
+/// Returns the material linked by the texture tag \p tag, no matter in
+/// which document it is.
+/// ***************************************************************************
+static BaseList2D* GetTagMaterial(BaseTag* tag)
+{
+  if (tag->GetType() != Ttexture) return nullptr;
+  BaseContainer* bc = tag->GetDataInstance();
+  BaseLink* link = bc ? bc->GetBaseLink(TEXTURETAG_MATERIAL) : nullptr;
+  return link ? link->ForceGetLink() : nullptr;
+}
+
+/// ***************************************************************************
+/// Makes the materials used by the hierarchy below \p src available in
+/// the target document before the source document is freed. A material
+/// of the same type and name that already exists is used instead of a
+/// copy, see #RemapMaterials(). Must be called before the #AliasTrans
+/// of \p ctx is translated.
+/// ***************************************************************************
+static void MergeMaterials(BaseObject* src, UpdateContext& ctx)
+{
+  std::vector<BaseMaterial*> used;
+  for (NodeIterator<BaseObject> it(src->GetDown(), src); it; ++it)
+  {
+    for (BaseTag* tag = it->GetFirstTag(); tag; tag = tag->GetNext())
+    {
+      BaseList2D* mat = GetTagMaterial(tag);
+      if (mat && mat->IsInstanceOf(Mbase) &&
+          std::find(used.begin(), used.end(), mat) == used.end())
+        used.push_back(static_cast<BaseMaterial*>(mat));
+    }
+  }
+
+  for (BaseMaterial* mat : used)
+  {
+    BaseMaterial* existing = ctx.doc->SearchMaterial(mat->GetName());
+    if (existing && existing->GetType() == mat->GetType())
+    {
+      ctx.reuse[mat] = existing;
+      continue;
+    }
+    BaseMaterial* clone = static_cast<BaseMaterial*>(mat->GetClone(COPYFLAGS_0, ctx.at));
+    if (!clone) continue;
+    ctx.doc->InsertMaterial(clone);
+    ctx.doc->AddUndo(UNDOTYPE_NEW, clone);
+    ctx.materials++;
+  }
+}
+
+/// ***************************************************************************
+/// Points the texture tags below \p op that still link a material of the
+/// source document to the existing material found by #MergeMaterials().
+/// Only added or patched tags can link there, their undo is already
+/// recorded.
+/// ***************************************************************************
+static void RemapMaterials(BaseObject* op, UpdateContext& ctx)
+{
+  if (ctx.reuse.empty()) return;
+  for (NodeIterator<BaseObject> it(op->GetDown(), op); it; ++it)
+  {
+    for (BaseTag* tag = it->GetFirstTag(); tag; tag = tag->GetNext())
+    {
+      auto found = ctx.reuse.find(GetTagMaterial(tag));
+      if (found != ctx.reuse.end())
+        tag->GetDataInstance()->SetLink(TEXTURETAG_MATERIAL, found->second);
+    }
+  }
+}
+
+/// ***************************************************************************
+/// Returns the container in \p doc that is a newer version of \p op. That
+/// is the first container with the same name in its Info tab, or the first
+/// container in the document if none has the same name.
+/// ***************************************************************************
+static BaseObject* FindUpdateSource(BaseDocument* doc, BaseObject* op)
+{
+  String name = op->GetDataInstance()->GetString(NRCONTAINER_INFO_NAME);
+  BaseObject* first = nullptr;
+  for (NodeIterator<BaseObject> it(doc->GetFirstObject()); it; ++it)
+  {
+    if (it->GetType() != Ocontainer) continue;
+    if (!first) first = *it;
+    if (it->GetDataInstance()->GetString(NRCONTAINER_INFO_NAME) == name)
+      return *it;
+  }
+  return first;
+}
+
 /// ***************************************************************************
 /// ***************************************************************************
 class Null2ContainerCommand : public CommandData
@@ -241,21 +568,15 @@ public:
   {
     if (!::GetState(this, doc, C4D_APIBRIDGE_COMMANDDATA_GETPARENTMANAGER())) return false;
 
-    BaseObject* op = doc->GetActiveObject();
-    AliasTrans* at = nullptr; // @FUTURE_EXT_OP
-    BaseObject* root = BaseObject::Alloc(Ocontainer);
-    if (!root) return false;
-
-    BaseContainer* bc = op->GetDataInstance();
-    CriticalAssert(bc != nullptr);
-    String hash = bc->GetString(CONTAINEROBJECT_PROTECTIONHASH);
-    if (!IsEmpty(hash))
-    {
-      ContainerProtect(root, "", hash, false);
-    }
-
-    ReplaceObjects(op, root, doc, at);
-    BaseObject::Free(op);
+    // The children of a converted Null-Object are moved to the new
+    // container, so selected Null-Objects nested in it stay valid.
+    std::vector<BaseObject*> objects;
+    GetSelectedObjects(doc, Onull, objects);
+    doc->StartUndo();
+    for (BaseObject* op : objects)
+      ConvertNullToContainer(op, doc);
+    doc->EndUndo();
+    SelectionSummaryInvalidate();
     EventAdd();
     return true;
   }
@@ -263,9 +584,7 @@ public:
   C4D_APIBRIDGE_COMMANDDATA_GETSTATE(doc)
   {
     if (!doc) return 0;
-    BaseObject* op = doc->GetActiveObject();
-    if (!op || !op->IsInstanceOf(Onull)) return 0;
-    return CMD_ENABLED;
+    return GetSelectionSummary(doc).nulls > 0 ? CMD_ENABLED : 0;
   }
 
 };
@@ -296,21 +615,116 @@ public:
   {
     if (!::GetState(this, doc, C4D_APIBRIDGE_COMMANDDATA_GETPARENTMANAGER())) return false;
 
+    std::vector<BaseObject*> objects;
+    GetSelectedObjects(doc, Ocontainer, objects);
+    doc->StartUndo();
+    for (BaseObject* op : objects)
+      ConvertContainerToNull(op, doc);
+    doc->EndUndo();
+    SelectionSummaryInvalidate();
+    EventAdd();
+    return true;
+  }
+
+  C4D_APIBRIDGE_COMMANDDATA_GETSTATE(doc)
+  {
+    if (!doc) return 0;
+    return GetSelectionSummary(doc).containers > 0 ? CMD_ENABLED : 0;
+  }
+
+};
+
+/// ***************************************************************************
+/// ***************************************************************************
+class UpdateContainerCommand : public CommandData
+{
+public:
+
+  static Bool Register()
+  {
+    return RegisterCommandPlugin(
+      ID_COMMAND_UPDATECONTAINER,
+      GeLoadString(IDS_COMMAND_UPDATECONTAINER_TITLE),
+      PLUGINFLAG_COMMAND_HOTKEY,
+      nullptr,
+      GeLoadString(IDS_COMMAND_UPDATECONTAINER_HELP),
+      gNew(UpdateContainerCommand));
+  }
+
+  // CommandData
+
+  C4D_APIBRIDGE_COMMANDDATA_EXECUTE(doc)
+  {
+    if (!::GetState(this, doc, C4D_APIBRIDGE_COMMANDDATA_GETPARENTMANAGER())) return false;
     BaseObject* op = doc->GetActiveObject();
-    AliasTrans* at = nullptr; // @FUTURE_EXT_OP
-    BaseObject* root = BaseObject::Alloc(Onull);
-    if (!root) return false;
 
-    ReplaceObjects(op, root, doc, at);
-    String hash = "";
-    if (ContainerIsProtected(op, &hash))
+    // Updating a protected container requires its password.
+    String hash;
+    if (ContainerIsProtected(op, &hash) && hash != HashString(""))
     {
-      BaseContainer* bc = root->GetDataInstance();
-      CriticalAssert(bc != nullptr);
-      bc->SetString(CONTAINEROBJECT_PROTECTIONHASH, hash);
+      String password;
+      if (!PasswordDialog(&password, true, true)) return true;
+      if (HashString(password) != hash)
+      {
+        MessageDialog(GeLoadString(IDS_PASSWORD_INVALID));
+        return true;
+      }
     }
 
-    BaseObject::Free(op);
+    Filename flname;
+    if (!flname.FileSelect(FILESELECTTYPE_SCENES, FILESELECT_LOAD,
+        GeLoadString(IDS_TITLE_LOADSCENEFILE)))
+      return true;
+
+    BaseDocument* src = LoadDocument(flname, SCENEFILTER_OBJECTS | SCENEFILTER_MATERIALS, nullptr);
+    if (!src)
+    {
+      MessageDialog(GeLoadString(IDS_INFO_INVALIDSCENEFILE));
+      return true;
+    }
+
+    BaseObject* incoming = FindUpdateSource(src, op);
+    AutoAlloc<AliasTrans> at;
+    if (!incoming || !at || !at->Init(doc))
+    {
+      if (!incoming) MessageDialog(GeLoadString(IDS_INFO_NOCONTAINERINFILE));
+      KillDocument(src);
+      return true;
+    }
+
+    doc->StartUndo();
+    UpdateContext ctx(doc, src, at);
+    ctx.fpOld.IndexHierarchy(op);
+    ctx.fpNew.IndexHierarchy(incoming);
+    UpdateHierarchy(op, incoming, ctx);
+    MergeMaterials(incoming, ctx);
+
+    // Take over the Info of the new version. The values are written
+    // to the container directly, as they can't be set on protected
+    // containers through SetParameter().
+    doc->AddUndo(UNDOTYPE_CHANGE_SMALL, op);
+    BaseContainer* bc = op->GetDataInstance();
+    const BaseContainer* bc_src = incoming->GetDataInstance();
+    const LONG infoIds[] = {
+      NRCONTAINER_INFO_NAME, NRCONTAINER_INFO_VERSION, NRCONTAINER_INFO_URL,
+      NRCONTAINER_INFO_AUTHOR, NRCONTAINER_INFO_AUTHOR_EMAIL,
+      NRCONTAINER_INFO_DESCRIPTION };
+    for (LONG id : infoIds)
+      bc->SetString(id, bc_src->GetString(id));
+
+    at->Translate(true);
+    RemapMaterials(op, ctx);
+
+    // New objects in a locked container must be hidden like the rest.
+    ContainerHideInserted(op, ctx.inserted, doc);
+    doc->EndUndo();
+    KillDocument(src);
+
+    GePrint("Container updated: " + LongToString(ctx.patched) + " objects patched, " +
+      LongToString(ctx.tags) + " tags changed, " +
+      LongToString(ctx.added) + " added, " + LongToString(ctx.removed) + " removed, " +
+      LongToString(ctx.materials) + " materials merged");
+    op->Message(MSG_UPDATE);
     EventAdd();
     return true;
   }
@@ -318,8 +732,110 @@ public:
   C4D_APIBRIDGE_COMMANDDATA_GETSTATE(doc)
   {
     if (!doc) return 0;
+    SelectionSummary const& summary = GetSelectionSummary(doc);
+    if (!summary.single || summary.containers != 1) return 0;
+    return CMD_ENABLED;
+  }
+
+};
+
+/// ***************************************************************************
+/// Toggles the solo of the selected containers.
+/// ***************************************************************************
+class SoloContainerCommand : public CommandData
+{
+public:
+
+  static Bool Register()
+  {
+    return RegisterCommandPlugin(
+      ID_COMMAND_SOLOCONTAINER,
+      GeLoadString(IDS_COMMAND_SOLOCONTAINER_TITLE),
+      PLUGINFLAG_COMMAND_HOTKEY,
+      nullptr,
+      GeLoadString(IDS_COMMAND_SOLOCONTAINER_HELP),
+      gNew(SoloContainerCommand));
+  }
+
+  // CommandData
+
+  C4D_APIBRIDGE_COMMANDDATA_EXECUTE(doc)
+  {
+    if (!::GetState(this, doc, C4D_APIBRIDGE_COMMANDDATA_GETPARENTMANAGER())) return false;
+
+    doc->StartUndo();
+    if (SoloIsActive(doc))
+      SoloRestore(doc);
+    else
+    {
+      std::vector<BaseObject*> containers;
+      SoloGetSelection(doc, containers);
+      SoloContainers(doc, containers);
+    }
+    doc->EndUndo();
+    EventAdd();
+    return true;
+  }
+
+  C4D_APIBRIDGE_COMMANDDATA_GETSTATE(doc)
+  {
+    if (!doc) return 0;
+    if (SoloIsActive(doc))
+      return CMD_ENABLED | CMD_VALUE;
+    return GetSelectionSummary(doc).containers > 0 ? CMD_ENABLED : 0;
+  }
+
+};
+
+/// ***************************************************************************
+/// Exports the geometry of the selected container over the frame range
+/// of the document.
+/// ***************************************************************************
+class ExportCacheCommand : public CommandData
+{
+public:
+
+  static Bool Register()
+  {
+    return RegisterCommandPlugin(
+      ID_COMMAND_EXPORTCACHE,
+      GeLoadString(IDS_COMMAND_EXPORTCACHE_TITLE),
+      PLUGINFLAG_COMMAND_HOTKEY,
+      nullptr,
+      GeLoadString(IDS_COMMAND_EXPORTCACHE_HELP),
+      gNew(ExportCacheCommand));
+  }
+
+  // CommandData
+
+  C4D_APIBRIDGE_COMMANDDATA_EXECUTE(doc)
+  {
+    if (!::GetState(this, doc, C4D_APIBRIDGE_COMMANDDATA_GETPARENTMANAGER())) return false;
     BaseObject* op = doc->GetActiveObject();
-    if (!op || !op->IsInstanceOf(Ocontainer)) return 0;
+
+    Filename flname;
+    if (!flname.FileSelect(FILESELECTTYPE_ANYTHING, FILESELECT_SAVE,
+        GeLoadString(IDS_TITLE_EXPORTCACHE), "nrgc"))
+      return true;
+
+    const LONG fps = doc->GetFps();
+    const LONG first = doc->GetMinTime().GetFrame(fps);
+    const LONG last = doc->GetMaxTime().GetFrame(fps);
+    if (!ExportContainerCache(op, doc, flname, first, last))
+    {
+      MessageDialog(GeLoadString(IDS_INFO_EXPORTCACHE_FAILED));
+      return true;
+    }
+    GePrint("Container cache exported: frames " + LongToString(first) + " to " +
+      LongToString(last) + " of " + op->GetName());
+    return true;
+  }
+
+  C4D_APIBRIDGE_COMMANDDATA_GETSTATE(doc)
+  {
+    if (!doc) return 0;
+    SelectionSummary const& summary = GetSelectionSummary(doc);
+    if (!summary.single || summary.containers != 1) return 0;
     return CMD_ENABLED;
   }
 
@@ -339,5 +855,20 @@ Bool RegisterCommands()
     GePrint("Container2Null could not be registered.");
     return false;
   }
+  if (!UpdateContainerCommand::Register())
+  {
+    GePrint("UpdateContainer could not be registered.");
+    return false;
+  }
+  if (!SoloContainerCommand::Register())
+  {
+    GePrint("SoloContainer could not be registered.");
+    return false;
+  }
+  if (!ExportCacheCommand::Register())
+  {
+    GePrint("ExportCache could not be registered.");
+    return false;
+  }
   return true;
 }
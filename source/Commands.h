@@ -0,0 +1,32 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Commands.h
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+
+/// ***************************************************************************
+/// Replaces the Null-Object \p op by a container that takes over its
+/// children, tags, user data and protection hash. Undos are added to \p doc
+/// if it is not \c nullptr, which then owns \p op. Otherwise \p op is
+/// freed. Returns the new container, or \c nullptr if \p op is not a
+/// Null-Object.
+/// ***************************************************************************
+BaseObject* ConvertNullToContainer(BaseObject* op, BaseDocument* doc);
+
+/// ***************************************************************************
+/// Replaces the container \p op by a Null-Object, the reverse of
+/// ConvertNullToContainer(). Returns the new Null-Object, or \c nullptr if
+/// \p op is not a container.
+/// ***************************************************************************
+BaseObject* ConvertContainerToNull(BaseObject* op, BaseDocument* doc);
+
+/// ***************************************************************************
+/// Registers the container commands.
+/// ***************************************************************************
+Bool RegisterCommands();
@@ -0,0 +1,306 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file ContainerApi.cpp
+
+#include "ContainerApi.h"
+#include "CacheExport.h"
+#include "Commands.h"
+#include "ContainerIndex.h"
+#include "ContainerObject.h"
+#include "Dedupe.h"
+#include "Dependencies.h"
+#include "Utils/Misc.h"
+#include "Utils/Stats.h"
+#include "res/c4d_symbols.h"
+#include <c4d_apibridge.h>
+#include <Ocontainer.h>
+#include <vector>
+
+/// ***************************************************************************
+/// Collects the objects of the request. Returns \c false if the request
+/// has no objects and \p all is \c false.
+/// ***************************************************************************
+static Bool GetObjects(BaseContainer const* bc, BaseDocument* doc, Bool all,
+    std::vector<BaseObject*>& objects)
+{
+  BaseContainer const* list = bc->GetContainerInstance(CONTAINERAPI_OBJECTS);
+  if (!list)
+  {
+    if (!all) return false;
+    ContainerIndexGetAll(doc, objects);
+    return true;
+  }
+  for (LONG i=0; ; i++)
+  {
+    LONG id = list->GetIndexId(i);
+    if (id == NOTOK) break;
+    BaseList2D* link = list->GetLink(id, doc);
+    if (link && link->IsInstanceOf(Obase))
+      objects.push_back(static_cast<BaseObject*>(link));
+    else
+      objects.push_back(nullptr);
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// Returns the fingerprint of the hierarchy of the container \p op. The
+/// key of the deduplication is the same fingerprint and reused if it is
+/// still valid.
+/// ***************************************************************************
+static String GetFingerprint(BaseObject* op)
+{
+  DedupeState* dedupe = ContainerGetDedupeState(op);
+  if (dedupe && DedupeVerify(op, *dedupe))
+    return dedupe->key;
+  return DedupeFingerprint(op);
+}
+
+/// ***************************************************************************
+/// Runs \p command on \p op and fills \p item. Returns \c true if the
+/// command succeeded. \p op may be replaced by the converting commands.
+/// ***************************************************************************
+static Bool RunCommand(LONG command, BaseObject*& op, BaseDocument* undoDoc,
+    String const& hash, Bool packup, BaseContainer& item)
+{
+  switch (command)
+  {
+    case CONTAINERAPI_LOCK:
+      if (ContainerIsProtected(op)) return false;
+      if (undoDoc && op->GetType() == Ocontainer)
+        undoDoc->AddUndo(UNDOTYPE_CHANGE_SMALL, op);
+      if (!ContainerProtect(op, "", hash, packup, undoDoc)) return false;
+      op->Message(MSG_CHANGE);
+      op->SetDirty(DIRTYFLAGS_DESCRIPTION);
+      return true;
+    case CONTAINERAPI_UNLOCK:
+      return ContainerUnprotect(op, hash, undoDoc);
+    case CONTAINERAPI_TO_NULL:
+    {
+      // Without undos, the replaced object is freed.
+      BaseObject* result = ConvertContainerToNull(op, undoDoc);
+      if (!result) return false;
+      op = result;
+      return true;
+    }
+    case CONTAINERAPI_TO_CONTAINER:
+    {
+      BaseObject* result = ConvertNullToContainer(op, undoDoc);
+      if (!result) return false;
+      op = result;
+      return true;
+    }
+    case CONTAINERAPI_GET_BOUNDS:
+    {
+      // Measuring walks the caches of the hierarchy, other threads get
+      // the box that was measured last.
+      Vector bbmin, bbmax;
+      if (!ContainerGetBounds(op, &bbmin, &bbmax, GeIsMainThread())) return false;
+      item.SetVector(CONTAINERAPI_ITEM_BBMIN, bbmin);
+      item.SetVector(CONTAINERAPI_ITEM_BBMAX, bbmax);
+      return true;
+    }
+    case CONTAINERAPI_GET_FINGERPRINT:
+      if (op->GetType() != Ocontainer) return false;
+      item.SetString(CONTAINERAPI_ITEM_FINGERPRINT, GetFingerprint(op));
+      return true;
+    case CONTAINERAPI_GET_DEPENDENCIES:
+    {
+      ContainerDependencies deps;
+      if (!ContainerGetDependencies(op, deps)) return false;
+      BaseContainer nodes, files;
+      LONG index = 0;
+      for (BaseObject* node : deps.objects) nodes.SetLink(index++, node);
+      for (BaseMaterial* node : deps.materials) nodes.SetLink(index++, node);
+      for (BaseShader* node : deps.shaders) nodes.SetLink(index++, node);
+      for (BaseList2D* node : deps.others) nodes.SetLink(index++, node);
+      for (size_t i=0; i < deps.files.size(); i++)
+        files.SetFilename((LONG) i, deps.files[i]);
+      item.SetContainer(CONTAINERAPI_ITEM_DEPENDENCIES, nodes);
+      item.SetContainer(CONTAINERAPI_ITEM_FILES, files);
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+/// ***************************************************************************
+/// Fills the statistics of the response.
+/// ***************************************************************************
+static void GetStats(BaseContainer* bc)
+{
+  BaseContainer stats;
+  for (LONG i=0; i < STATCOUNTER_COUNT; i++)
+  {
+    BaseContainer stat;
+    stat.SetString(CONTAINERAPI_STAT_NAME, GetStatName((STATCOUNTER) i));
+    stat.SetLLong(CONTAINERAPI_STAT_VALUE, StatGet((STATCOUNTER) i));
+    stats.SetContainer(i, stat);
+  }
+  bc->SetContainer(CONTAINERAPI_STATS, stats);
+  bc->SetString(CONTAINERAPI_STATS_REPORT, GetStatisticsReport());
+}
+
+/// ***************************************************************************
+/// Exports the geometry of the only object of the request.
+/// ***************************************************************************
+static void ExportCache(BaseContainer* bc, BaseDocument* doc, std::vector<BaseObject*> const& objects)
+{
+  Filename filename = bc->GetFilename(CONTAINERAPI_FILENAME);
+  if (objects.size() != 1 || !objects[0] || !filename.Content())
+  {
+    bc->SetLong(CONTAINERAPI_RESULT, CONTAINERAPI_ERROR_ARGUMENT);
+    return;
+  }
+  const LONG current = doc->GetTime().GetFrame(doc->GetFps());
+  const LONG first = bc->GetLong(CONTAINERAPI_FIRST_FRAME, current);
+  const LONG last = bc->GetLong(CONTAINERAPI_LAST_FRAME, first);
+  const Bool ok = ExportContainerCache(objects[0], doc, filename, first, last);
+
+  BaseContainer item;
+  item.SetLink(CONTAINERAPI_ITEM_OBJECT, objects[0]);
+  item.SetBool(CONTAINERAPI_ITEM_OK, ok);
+  BaseContainer items;
+  items.SetContainer(0, item);
+  bc->SetContainer(CONTAINERAPI_ITEMS, items);
+  bc->SetLong(CONTAINERAPI_COUNT, ok ? 1 : 0);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool ContainerApiMessage(BaseContainer* bc)
+{
+  if (!bc) return false;
+  const LONG command = bc->GetLong(CONTAINERAPI_COMMAND);
+  bc->SetLong(CONTAINERAPI_RESULT, CONTAINERAPI_OK);
+  bc->SetLong(CONTAINERAPI_COUNT, 0);
+
+  if (command == CONTAINERAPI_GET_STATS)
+  {
+    GetStats(bc);
+    return true;
+  }
+  if (command < CONTAINERAPI_LOCK || command > CONTAINERAPI_GET_DEPENDENCIES)
+  {
+    bc->SetLong(CONTAINERAPI_RESULT, CONTAINERAPI_ERROR_COMMAND);
+    return true;
+  }
+
+  // The dependency cache of the container is updated by the query.
+  const Bool modifies = command != CONTAINERAPI_GET_BOUNDS &&
+      command != CONTAINERAPI_GET_FINGERPRINT && command != CONTAINERAPI_GET_DEPENDENCIES;
+  const Bool mainThread = modifies || command == CONTAINERAPI_GET_DEPENDENCIES;
+  if (mainThread && !GeIsMainThread())
+  {
+    bc->SetLong(CONTAINERAPI_RESULT, CONTAINERAPI_ERROR_THREAD);
+    return true;
+  }
+
+  BaseDocument* doc = nullptr;
+  BaseList2D* link = bc->GetLink(CONTAINERAPI_DOCUMENT, nullptr);
+  if (link && link->IsInstanceOf(Tbasedocument))
+    doc = static_cast<BaseDocument*>(link);
+  else if (!bc->GetData(CONTAINERAPI_DOCUMENT).GetType())
+    doc = GetActiveDocument();
+  if (!doc)
+  {
+    bc->SetLong(CONTAINERAPI_RESULT, CONTAINERAPI_ERROR_DOCUMENT);
+    return true;
+  }
+
+  // Null-Objects are only converted if they are passed explicitly.
+  std::vector<BaseObject*> objects;
+  if (!GetObjects(bc, doc, command != CONTAINERAPI_TO_CONTAINER, objects))
+  {
+    bc->SetLong(CONTAINERAPI_RESULT, CONTAINERAPI_ERROR_ARGUMENT);
+    return true;
+  }
+  if (command == CONTAINERAPI_EXPORT_CACHE)
+  {
+    ExportCache(bc, doc, objects);
+    return true;
+  }
+
+  String hash = bc->GetString(CONTAINERAPI_HASH);
+  if (IsEmpty(hash))
+  {
+    String password = bc->GetString(CONTAINERAPI_PASSWORD);
+    if (IsEmpty(password) && (command == CONTAINERAPI_LOCK || command == CONTAINERAPI_UNLOCK))
+    {
+      bc->SetLong(CONTAINERAPI_RESULT, CONTAINERAPI_ERROR_ARGUMENT);
+      return true;
+    }
+    hash = HashString(password);
+  }
+  const Bool packup = bc->GetBool(CONTAINERAPI_PACKUP, true);
+  BaseDocument* undoDoc = (modifies && bc->GetBool(CONTAINERAPI_UNDO, true)) ? doc : nullptr;
+
+  if (undoDoc) undoDoc->StartUndo();
+  BaseContainer items;
+  LONG count = 0;
+  for (size_t i=0; i < objects.size(); i++)
+  {
+    BaseObject* op = objects[i];
+    BaseContainer item;
+    Bool ok = op && RunCommand(command, op, undoDoc, hash, packup, item);
+    if (op)
+    {
+      item.SetLink(CONTAINERAPI_ITEM_OBJECT, op);
+      item.SetBool(CONTAINERAPI_ITEM_PROTECTED, ContainerIsProtected(op));
+    }
+    item.SetBool(CONTAINERAPI_ITEM_OK, ok);
+    items.SetContainer((LONG) i, item);
+    if (ok) count++;
+  }
+  if (undoDoc) undoDoc->EndUndo();
+  if (modifies && count > 0)
+    EventAdd();
+
+  bc->SetContainer(CONTAINERAPI_ITEMS, items);
+  bc->SetLong(CONTAINERAPI_COUNT, count);
+  return true;
+}
+
+/// ***************************************************************************
+/// Runs the request in the world plugin container of #CONTAINERAPI_MESSAGE
+/// and writes the response back to it. Python can't pass a container with
+/// GePluginMessage(), see ContainerApi.h.
+/// ***************************************************************************
+class ContainerApiCommand : public CommandData
+{
+public:
+
+  static Bool Register()
+  {
+    return RegisterCommandPlugin(
+      CONTAINERAPI_PYTHON_COMMAND,
+      GeLoadString(IDS_CONTAINERAPI),
+      PLUGINFLAG_HIDE,
+      nullptr,
+      String(),
+      gNew(ContainerApiCommand));
+  }
+
+  // CommandData
+
+  C4D_APIBRIDGE_COMMANDDATA_EXECUTE(doc)
+  {
+    BaseContainer* world = GetWorldPluginData(CONTAINERAPI_MESSAGE);
+    if (!world) return false;
+    BaseContainer bc = *world;
+    ContainerApiMessage(&bc);
+    return SetWorldPluginData(CONTAINERAPI_MESSAGE, bc, false);
+  }
+
+};
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool RegisterContainerApi()
+{
+  return ContainerApiCommand::Register();
+}
@@ -0,0 +1,114 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file ContainerApi.h
+///
+/// A plugin message for batch operations on many containers in a single
+/// call, for pipeline tools and script bridges. Send it with a request
+/// container and read the results from the same container:
+///
+///     BaseContainer bc;
+///     bc.SetLong(CONTAINERAPI_COMMAND, CONTAINERAPI_LOCK);
+///     bc.SetString(CONTAINERAPI_HASH, hash);
+///     GePluginMessage(CONTAINERAPI_MESSAGE, &bc);
+///     if (bc.GetLong(CONTAINERAPI_RESULT) == CONTAINERAPI_OK) ...
+///
+/// Commands that modify the document or caches must be sent from the main
+/// thread, modifications are combined into one undo step. Bounding boxes
+/// are only measured again on the main thread.
+///
+/// Python can't pass a container with `c4d.GePluginMessage()`. Instead,
+/// store the request as the world plugin data of #CONTAINERAPI_MESSAGE and
+/// run the hidden command #CONTAINERAPI_PYTHON_COMMAND, which runs it
+/// on the main thread and stores the response in its place:
+///
+///     c4d.plugins.SetWorldPluginData(1036114, request, False)
+///     c4d.CallCommand(1036123)
+///     response = c4d.plugins.GetWorldPluginData(1036114)
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+
+enum
+{
+  /// The plugin message. Its data is a `BaseContainer*`.
+  CONTAINERAPI_MESSAGE = 1036114,
+
+  /// The command that runs the request stored in the world plugin data.
+  CONTAINERAPI_PYTHON_COMMAND = 1036123,
+
+  // Request.
+  CONTAINERAPI_COMMAND = 1000,     ///< LONG, one of the commands below.
+  CONTAINERAPI_DOCUMENT = 1001,    ///< Link, the active document if not set.
+  CONTAINERAPI_OBJECTS = 1002,     ///< Container of links, all containers of the document if not set.
+  CONTAINERAPI_HASH = 1003,        ///< String, a hashed password for #CONTAINERAPI_LOCK and #CONTAINERAPI_UNLOCK.
+  CONTAINERAPI_PASSWORD = 1004,    ///< String, the plain password if no hash is set. One of both is required.
+  CONTAINERAPI_PACKUP = 1005,      ///< Bool, hide the contents when locking (default \c true).
+  CONTAINERAPI_UNDO = 1006,        ///< Bool, add undos (default \c true).
+  CONTAINERAPI_FILENAME = 1007,    ///< Filename for #CONTAINERAPI_EXPORT_CACHE.
+  CONTAINERAPI_FIRST_FRAME = 1008, ///< LONG, the current frame if not set.
+  CONTAINERAPI_LAST_FRAME = 1009,  ///< LONG, the first frame if not set.
+
+  // Response.
+  CONTAINERAPI_RESULT = 1100,      ///< LONG, one of the results below.
+  CONTAINERAPI_COUNT = 1101,       ///< LONG, number of objects the command succeeded for.
+  CONTAINERAPI_ITEMS = 1102,       ///< Container with one sub-container per requested object.
+  CONTAINERAPI_STATS = 1103,       ///< Container with one sub-container per counter.
+  CONTAINERAPI_STATS_REPORT = 1104, ///< String, the report of the developer info.
+
+  // Items of #CONTAINERAPI_ITEMS.
+  CONTAINERAPI_ITEM_OBJECT = 1,       ///< Link, the object, or the object that replaced it.
+  CONTAINERAPI_ITEM_OK = 2,           ///< Bool, the command succeeded for the object.
+  CONTAINERAPI_ITEM_BBMIN = 3,        ///< Vector, world space bounding box.
+  CONTAINERAPI_ITEM_BBMAX = 4,        ///< Vector
+  CONTAINERAPI_ITEM_FINGERPRINT = 5,  ///< String, the content fingerprint of the hierarchy.
+  CONTAINERAPI_ITEM_PROTECTED = 6,    ///< Bool
+  CONTAINERAPI_ITEM_DEPENDENCIES = 7, ///< Container of links to the nodes outside of the hierarchy it depends on.
+  CONTAINERAPI_ITEM_FILES = 8,        ///< Container of the Filenames referenced by the hierarchy and its dependencies.
+
+  // Items of #CONTAINERAPI_STATS.
+  CONTAINERAPI_STAT_NAME = 1,      ///< String
+  CONTAINERAPI_STAT_VALUE = 2,     ///< LLONG
+};
+
+/// ***************************************************************************
+/// Commands.
+/// ***************************************************************************
+enum
+{
+  CONTAINERAPI_LOCK = 1,           ///< Locks the containers with the hash or password.
+  CONTAINERAPI_UNLOCK,             ///< Unlocks the containers locked with the hash or password.
+  CONTAINERAPI_TO_NULL,            ///< Converts containers to Null-Objects.
+  CONTAINERAPI_TO_CONTAINER,       ///< Converts Null-Objects to containers.
+  CONTAINERAPI_GET_BOUNDS,         ///< Fills #CONTAINERAPI_ITEM_BBMIN and #CONTAINERAPI_ITEM_BBMAX.
+  CONTAINERAPI_GET_FINGERPRINT,    ///< Fills #CONTAINERAPI_ITEM_FINGERPRINT.
+  CONTAINERAPI_GET_STATS,          ///< Fills #CONTAINERAPI_STATS and #CONTAINERAPI_STATS_REPORT.
+  CONTAINERAPI_EXPORT_CACHE,       ///< Exports the geometry of one container to #CONTAINERAPI_FILENAME.
+  CONTAINERAPI_GET_DEPENDENCIES,   ///< Fills #CONTAINERAPI_ITEM_DEPENDENCIES and #CONTAINERAPI_ITEM_FILES.
+};
+
+/// ***************************************************************************
+/// Results.
+/// ***************************************************************************
+enum
+{
+  CONTAINERAPI_OK = 0,
+  CONTAINERAPI_ERROR_COMMAND,      ///< Unknown command.
+  CONTAINERAPI_ERROR_DOCUMENT,     ///< No document.
+  CONTAINERAPI_ERROR_THREAD,       ///< A modifying command was not sent from the main thread.
+  CONTAINERAPI_ERROR_ARGUMENT,     ///< A required argument is missing.
+};
+
+/// ***************************************************************************
+/// Handles #CONTAINERAPI_MESSAGE. Called from PluginMessage().
+/// ***************************************************************************
+Bool ContainerApiMessage(BaseContainer* bc);
+
+/// ***************************************************************************
+/// Registers the command for #CONTAINERAPI_PYTHON_COMMAND.
+/// ***************************************************************************
+Bool RegisterContainerApi();
@@ -0,0 +1,352 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file ContainerIndex.cpp
+
+#include "ContainerIndex.h"
+#include "ContainerObject.h"
+#include "Utils/Misc.h"
+#include "Utils/OBB.h"
+#include "Utils/Stats.h"
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+/// ***************************************************************************
+/// The BVH over the containers of one document. Items of containers that
+/// left the document are emptied and reused for the next containers that
+/// are added, so that membership changes are refits, too.
+/// ***************************************************************************
+struct DocumentIndex
+{
+  BVH bvh;
+  std::vector<BaseObject*> items;   ///< \c nullptr for free items.
+  std::unordered_map<BaseObject*, LONG> itemIndex;
+  std::vector<LONG> freeItems;
+  std::unordered_set<BaseObject*> added;      ///< Not in the BVH yet.
+  std::unordered_set<BaseObject*> detached;   ///< Removed from the document.
+  LONG stamp;
+
+  DocumentIndex() : stamp(-1) { }
+
+  Bool IsEmpty() const
+  {
+    return itemIndex.empty() && added.empty() && detached.empty();
+  }
+};
+
+// Containers are allocated and freed from render threads, too. The index
+// of a document is dropped when its last container is freed, so indices
+// of closed documents don't stay around.
+static std::mutex g_lock;
+static std::unordered_map<BaseObject*, BaseDocument*> g_members;
+static std::unordered_set<BaseObject*> g_changed;
+static std::unordered_map<BaseDocument*, DocumentIndex> g_indices;
+
+/// ***************************************************************************
+/// Returns the bounds of the container \p op for the BVH.
+/// ***************************************************************************
+static BVHBounds GetBounds(BaseObject* op)
+{
+  Vector bbmin, bbmax;
+  ContainerGetBounds(op, &bbmin, &bbmax, false);
+  return BVHBounds(bbmin, bbmax);
+}
+
+/// ***************************************************************************
+/// Removes \p op from the BVH of \p index and frees its item. Must be
+/// called with #g_lock held.
+/// ***************************************************************************
+static void FreeItem(DocumentIndex& index, BaseObject* op)
+{
+  auto it = index.itemIndex.find(op);
+  if (it == index.itemIndex.end()) return;
+  LONG item = it->second;
+  index.itemIndex.erase(it);
+  index.items[item] = nullptr;
+  index.freeItems.push_back(item);
+  index.bvh.Refit(item, BVHBounds(Vector(1.0e30), Vector(-1.0e30)));
+}
+
+/// ***************************************************************************
+/// Removes \p op from the index of \p doc. Must be called with #g_lock held.
+/// ***************************************************************************
+static void RemoveMember(BaseObject* op, BaseDocument* doc)
+{
+  g_members.erase(op);
+  auto it = g_indices.find(doc);
+  if (it == g_indices.end()) return;
+  DocumentIndex& index = it->second;
+  FreeItem(index, op);
+  index.added.erase(op);
+  index.detached.erase(op);
+  if (index.IsEmpty())
+    g_indices.erase(it);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void ContainerIndexInsert(BaseObject* op, BaseDocument* doc)
+{
+  std::lock_guard<std::mutex> lock(g_lock);
+  auto member = g_members.find(op);
+  if (member != g_members.end())
+  {
+    if (member->second == doc)
+    {
+      DocumentIndex& index = g_indices[doc];
+      if (index.detached.erase(op))
+        index.added.insert(op);
+      return;
+    }
+    RemoveMember(op, member->second);
+  }
+  if (!doc) return;
+  g_members[op] = doc;
+  g_indices[doc].added.insert(op);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void ContainerIndexUnregister(BaseObject* op)
+{
+  std::lock_guard<std::mutex> lock(g_lock);
+  g_changed.erase(op);
+  auto member = g_members.find(op);
+  if (member != g_members.end())
+    RemoveMember(op, member->second);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void ContainerIndexBoundsChanged(BaseObject* op)
+{
+  std::lock_guard<std::mutex> lock(g_lock);
+  g_changed.insert(op);
+}
+
+/// ***************************************************************************
+/// Brings the index of \p doc up to date. Must be called with #g_lock held.
+/// Added containers take free items and containers with changed bounds
+/// are refitted. The BVH is only rebuilt when there are not enough free
+/// items, or when the refits degraded it.
+/// ***************************************************************************
+static DocumentIndex& SyncIndex(BaseDocument* doc)
+{
+  DocumentIndex& index = g_indices[doc];
+
+  // Containers that come back with an undo don't tell the index, as
+  // they are in the document they reported last.
+  LONG stamp = (LONG) doc->GetHDirty(HDIRTYFLAGS_OBJECT_HIERARCHY);
+  if (index.stamp != stamp)
+  {
+    index.stamp = stamp;
+    for (auto it = index.detached.begin(); it != index.detached.end(); )
+    {
+      if ((*it)->GetDocument() == doc)
+      {
+        index.added.insert(*it);
+        it = index.detached.erase(it);
+      }
+      else
+        ++it;
+    }
+  }
+
+  Bool rebuild = index.added.size() > index.freeItems.size();
+  if (!rebuild)
+  {
+    for (BaseObject* op : index.added)
+    {
+      LONG item = index.freeItems.back();
+      index.freeItems.pop_back();
+      index.items[item] = op;
+      index.itemIndex[op] = item;
+      index.bvh.Refit(item, GetBounds(op));
+      g_changed.erase(op);
+      StatIncrement(STATCOUNTER_INDEX_REFITS);
+    }
+    index.added.clear();
+
+    for (auto it = g_changed.begin(); it != g_changed.end(); )
+    {
+      auto item = index.itemIndex.find(*it);
+      if (item == index.itemIndex.end())
+      {
+        ++it;
+        continue;
+      }
+      index.bvh.Refit(item->second, GetBounds(*it));
+      StatIncrement(STATCOUNTER_INDEX_REFITS);
+      it = g_changed.erase(it);
+    }
+    rebuild = index.bvh.GetRefitCount() > index.bvh.GetCount() * 2 + 16;
+  }
+
+  if (rebuild)
+  {
+    std::vector<BaseObject*> members;
+    members.reserve(index.itemIndex.size() + index.added.size());
+    for (BaseObject* op : index.items)
+    {
+      if (op) members.push_back(op);
+    }
+    members.insert(members.end(), index.added.begin(), index.added.end());
+
+    index.items.clear();
+    index.itemIndex.clear();
+    index.freeItems.clear();
+    index.added.clear();
+    std::vector<BVHBounds> bounds;
+    bounds.reserve(members.size());
+    for (BaseObject* op : members)
+    {
+      index.itemIndex[op] = (LONG) index.items.size();
+      index.items.push_back(op);
+      bounds.push_back(GetBounds(op));
+      g_changed.erase(op);
+    }
+    index.bvh.Build(bounds);
+    StatIncrement(STATCOUNTER_INDEX_REBUILDS);
+  }
+  return index;
+}
+
+/// ***************************************************************************
+/// Returns the container of \p item if it is still in \p doc. Containers
+/// that left the document are detached from \p index. Must be called with
+/// #g_lock held.
+/// ***************************************************************************
+static BaseObject* GetItem(DocumentIndex& index, BaseDocument* doc, LONG item)
+{
+  BaseObject* op = index.items[item];
+  if (!op || op->GetDocument() == doc) return op;
+  FreeItem(index, op);
+  index.detached.insert(op);
+  return nullptr;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void ContainerIndexGetAll(BaseDocument* doc, std::vector<BaseObject*>& out)
+{
+  if (!doc) return;
+  std::lock_guard<std::mutex> lock(g_lock);
+  if (g_indices.find(doc) == g_indices.end()) return;
+  DocumentIndex& index = SyncIndex(doc);
+  for (LONG item=0; item < (LONG) index.items.size(); item++)
+  {
+    BaseObject* op = GetItem(index, doc, item);
+    if (op) out.push_back(op);
+  }
+}
+
+/// ***************************************************************************
+/// Validates the bounding box caches of all containers in \p doc. This
+/// must happen without #g_lock held, as changed containers call
+/// ContainerIndexBoundsChanged().
+/// ***************************************************************************
+static void RefreshBounds(BaseDocument* doc)
+{
+  std::vector<BaseObject*> containers;
+  ContainerIndexGetAll(doc, containers);
+  Vector bbmin, bbmax;
+  for (BaseObject* op : containers)
+    ContainerGetBounds(op, &bbmin, &bbmax, true);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void ContainerIndexQueryBox(BaseDocument* doc, BVHBounds const& box,
+    std::vector<BaseObject*>& out, Bool refresh)
+{
+  if (!doc) return;
+  if (refresh) RefreshBounds(doc);
+
+  std::lock_guard<std::mutex> lock(g_lock);
+  if (g_indices.find(doc) == g_indices.end()) return;
+  DocumentIndex& index = SyncIndex(doc);
+  std::vector<LONG> items;
+  index.bvh.QueryBox(box, items);
+  for (LONG item : items)
+  {
+    BaseObject* op = GetItem(index, doc, item);
+    if (op) out.push_back(op);
+  }
+  StatIncrement(STATCOUNTER_INDEX_QUERIES);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void ContainerIndexQueryFrustum(BaseDocument* doc, BaseDraw* bd,
+    std::vector<BaseObject*>& out, Bool refresh)
+{
+  if (!doc || !bd) return;
+  BVHPlane planes[5];
+  LONG count = GetViewFrustum(bd, planes);
+  if (refresh) RefreshBounds(doc);
+
+  std::lock_guard<std::mutex> lock(g_lock);
+  if (g_indices.find(doc) == g_indices.end()) return;
+  DocumentIndex& index = SyncIndex(doc);
+  std::vector<LONG> items;
+  index.bvh.QueryPlanes(planes, count, items);
+  for (LONG item : items)
+  {
+    BaseObject* op = GetItem(index, doc, item);
+    if (!op) continue;
+
+    // Containers with an oriented box are tested against it, too.
+    OBB obb;
+    Bool outside = false;
+    if (ContainerGetOrientedBounds(op, &obb))
+    {
+      for (LONG i=0; i < count && !outside; i++)
+        outside = obb.IsOutside(planes[i]);
+    }
+    if (!outside) out.push_back(op);
+  }
+  StatIncrement(STATCOUNTER_INDEX_QUERIES);
+}
+
+/// ***************************************************************************
+/// Computes the plane through \p a, \p b and \p c that has \p inside on
+/// its inner side.
+/// ***************************************************************************
+static BVHPlane MakePlane(Vector const& a, Vector const& b, Vector const& c, Vector const& inside)
+{
+  BVHPlane plane;
+  plane.normal = Cross(b - a, c - a).GetNormalized();
+  plane.d = -Dot(plane.normal, a);
+  if (Dot(plane.normal, inside) + plane.d < 0)
+  {
+    plane.normal = -plane.normal;
+    plane.d = -plane.d;
+  }
+  return plane;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+LONG GetViewFrustum(BaseDraw* bd, BVHPlane* planes)
+{
+  LONG cl, ct, cr, cb;
+  bd->GetFrame(&cl, &ct, &cr, &cb);
+  const Real znear = 1.0;
+  const Real zfar = 1000.0;
+  Vector center = bd->SW(Vector((cl + cr) * 0.5, (ct + cb) * 0.5, (znear + zfar) * 0.5));
+
+  Vector ltn = bd->SW(Vector(cl, ct, znear)), ltf = bd->SW(Vector(cl, ct, zfar));
+  Vector rtn = bd->SW(Vector(cr, ct, znear)), rtf = bd->SW(Vector(cr, ct, zfar));
+  Vector lbn = bd->SW(Vector(cl, cb, znear)), lbf = bd->SW(Vector(cl, cb, zfar));
+  Vector rbn = bd->SW(Vector(cr, cb, znear));
+
+  planes[0] = MakePlane(ltn, lbn, ltf, center);   // left
+  planes[1] = MakePlane(rtn, rbn, rtf, center);   // right
+  planes[2] = MakePlane(ltn, rtn, ltf, center);   // top
+  planes[3] = MakePlane(lbn, rbn, lbf, center);   // bottom
+  planes[4] = MakePlane(ltn, rtn, lbn, center);   // near
+  return 5;
+}
@@ -0,0 +1,60 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file ContainerIndex.h
+///
+/// Keeps track of all container objects and maintains a bounding volume
+/// hierarchy over the cached bounding boxes of the containers of each
+/// document, so that region queries don't need to measure every container.
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+#include <vector>
+#include "Utils/BVH.h"
+
+/// ***************************************************************************
+/// Called by the container object when it finds itself in a different
+/// document \p doc than the one it reported last, and when it is freed.
+/// Containers removed from their document are dropped from its index by
+/// the next query that finds them, and are taken back in when the object
+/// hierarchy of the document changes (eg. with an undo).
+/// ***************************************************************************
+void ContainerIndexInsert(BaseObject* op, BaseDocument* doc);
+void ContainerIndexUnregister(BaseObject* op);
+
+/// ***************************************************************************
+/// Called by the container object when its cached bounding box changed.
+/// The BVH of its document is refitted on the next query.
+/// ***************************************************************************
+void ContainerIndexBoundsChanged(BaseObject* op);
+
+/// ***************************************************************************
+/// Adds all containers in \p doc to \p out.
+/// ***************************************************************************
+void ContainerIndexGetAll(BaseDocument* doc, std::vector<BaseObject*>& out);
+
+/// ***************************************************************************
+/// Adds all containers in \p doc whose bounding box intersects the world
+/// space box \p box to \p out. If \p refresh is \c true, the bounding box
+/// caches of all containers are validated first. Otherwise the boxes last
+/// measured by Cinema 4D are used.
+/// ***************************************************************************
+void ContainerIndexQueryBox(BaseDocument* doc, BVHBounds const& box,
+    std::vector<BaseObject*>& out, Bool refresh=false);
+
+/// ***************************************************************************
+/// Adds all containers in \p doc whose bounding box is not completely
+/// outside of the view frustum of \p bd to \p out.
+/// ***************************************************************************
+void ContainerIndexQueryFrustum(BaseDocument* doc, BaseDraw* bd,
+    std::vector<BaseObject*>& out, Bool refresh=false);
+
+/// ***************************************************************************
+/// Computes the four side planes and the near plane of the view frustum
+/// of \p bd in world space. Returns the number of planes.
+/// ***************************************************************************
+LONG GetViewFrustum(BaseDraw* bd, BVHPlane* planes);
@@ -17,8 +17,31 @@
 #include <Ocontainer.h>
 #include "res/c4d_symbols.h"
 
+#include <mutex>
+
 #include "Utils/Misc.h"
 #include "Utils/AABB.h"
+#include "Utils/Fingerprint.h"
+#include "Utils/JobSystem.h"
+#include "Utils/Kernels.h"
+#include "Utils/ScratchArena.h"
+#include "Utils/OBB.h"
+#include "Utils/Stats.h"
+#include "Utils/TraceFile.h"
+#include "PromotedParameters.h"
+#include "Catalog.h"
+#include "Checkpoints.h"
+#include "Dedupe.h"
+#include "Dependencies.h"
+#include "EvalProfile.h"
+#include "IconCache.h"
+#include "IconStorage.h"
+#include "Instancing.h"
+#include "PlaybackCache.h"
+#include "Preferences.h"
+#include "Unpack.h"
+#include "Warmup.h"
+#include "ContainerIndex.h"
 
 
 using c4d_apibridge::GetDescriptionID;
@@ -36,6 +59,45 @@ static inline T* GetNodeData(GeListNode* node) {
 }
 
 
+/// ***************************************************************************
+/// Hides or reveals the single node \p node in the object manager and
+/// timeline. Adds an undo to \p doc if it is not \c nullptr.
+/// ***************************************************************************
+void ContainerHideNode(BaseList2D* node, Bool hide, BaseDocument* doc)
+{
+  if (doc)
+    doc->AddUndo(UNDOTYPE_BITS, node);
+  const NBITCONTROL control = (hide ? NBITCONTROL_SET : NBITCONTROL_CLEAR);
+  node->ChangeNBit(NBIT_OHIDE, control);
+  node->ChangeNBit(NBIT_TL1_HIDE, control);
+  node->ChangeNBit(NBIT_TL2_HIDE, control);
+  node->ChangeNBit(NBIT_TL3_HIDE, control);
+  node->ChangeNBit(NBIT_TL4_HIDE, control);
+  node->ChangeNBit(NBIT_THIDE, control);
+  node->DelBit(BIT_ACTIVE);
+}
+
+
+/// ***************************************************************************
+/// Returns \c true if the children of \p node are not hidden or revealed
+/// together with the node.
+/// ***************************************************************************
+Bool ContainerIsSealed(BaseList2D* node)
+{
+  if (!node->IsInstanceOf(Obase))
+    return false;
+  BaseObject* op = static_cast<BaseObject*>(node);
+  BaseContainer* bc = op->GetDataInstance();
+  CriticalAssert(bc);
+
+  // Don't modify the hierarchy of "protected" Null-Objects.
+  if (!IsEmpty(bc->GetString(CONTAINEROBJECT_PROTECTIONHASH)))
+    return true;
+  // Don't modify the hierarchy of protected Containers.
+  return ContainerIsProtected(op);
+}
+
+
 /// ***************************************************************************
 /// This function recursive hides or unhides a node and all its following
 /// nodes in the same hierarchy level and below object manager and timeline.
@@ -47,42 +109,32 @@ static inline T* GetNodeData(GeListNode* node) {
 ///     \c nullptr if no undos should be created.
 /// @param[in] sameLevel If \c true (default), all objects following *root*
 ///     in the hierarchy will also be processed by this function.
+/// @param[in] depth The number of hierarchy levels to process, or
+///     \c NOTOK (default) to process the complete hierarchy.
 /// ***************************************************************************
-static void HideHierarchy(BaseList2D* root, Bool hide, BaseDocument* doc, Bool sameLevel=true)
+static void HideHierarchy(BaseList2D* root, Bool hide, BaseDocument* doc,
+    Bool sameLevel=true, LONG depth=NOTOK)
 {
-  while (root)
+  // An explicit stack instead of recursion, rigs can be very deep. The
+  // next sibling is pushed before the first child, so the nodes are
+  // processed in the same order as by a recursive walk.
+  struct Item { BaseList2D* node; LONG depth; };
+  ScratchScope scope;
+  ScratchVector<Item> stack(scope);
+  if (root) stack.PushBack(Item{root, depth});
+
+  while (!stack.IsEmpty())
   {
-    if (doc)
-      doc->AddUndo(UNDOTYPE_BITS, root);
-    const NBITCONTROL control = (hide ? NBITCONTROL_SET : NBITCONTROL_CLEAR);
-    root->ChangeNBit(NBIT_OHIDE, control);
-    root->ChangeNBit(NBIT_TL1_HIDE, control);
-    root->ChangeNBit(NBIT_TL2_HIDE, control);
-    root->ChangeNBit(NBIT_TL3_HIDE, control);
-    root->ChangeNBit(NBIT_TL4_HIDE, control);
-    root->ChangeNBit(NBIT_THIDE, control);
-    root->DelBit(BIT_ACTIVE);
-
-    Bool hideChildren = true;
-    if (root->IsInstanceOf(Obase))
-    {
-      BaseObject* op = static_cast<BaseObject*>(root);
-      BaseContainer* bc = op->GetDataInstance();
-      CriticalAssert(bc);
-
-      if (!IsEmpty(bc->GetString(CONTAINEROBJECT_PROTECTIONHASH)))
-        // Don't modify the hierarchy of "protected" Null-Objects.
-        hideChildren = false;
-      else if (ContainerIsProtected(op))
-        // Don't modify the hierarchy of protected Containers.
-        hideChildren = false;
-    }
+    Item item = stack.PopBack();
+    ContainerHideNode(item.node, hide, doc);
 
-    if (hideChildren)
-      HideHierarchy(static_cast<BaseList2D*>(root->GetDown()), hide, doc);
+    BaseList2D* next = static_cast<BaseList2D*>(item.node->GetNext());
+    if (next && (sameLevel || item.node != root))
+      stack.PushBack(Item{next, item.depth});
 
-    if (!sameLevel) break;
-    root = root->GetNext();
+    BaseList2D* down = static_cast<BaseList2D*>(item.node->GetDown());
+    if (down && item.depth != 1 && !ContainerIsSealed(item.node))
+      stack.PushBack(Item{down, item.depth == NOTOK ? NOTOK : item.depth - 1});
   }
 }
 
@@ -112,17 +164,254 @@ static void HideMaterials(BaseObject* op, Bool hide, BaseDocument* doc)
 }
 
 
+/// ***************************************************************************
+/// Hides the objects \p nodes that were inserted into the hierarchy of the
+/// container \p op and the materials they use like HideNodes() does, if
+/// \p op is protected. Materials that are already hidden are skipped.
+/// ***************************************************************************
+void ContainerHideInserted(BaseObject* op, std::vector<BaseObject*> const& nodes, BaseDocument* doc)
+{
+  if (!ContainerIsProtected(op)) return;
+  for (BaseObject* node : nodes)
+    HideHierarchy(node, true, doc, false);
+
+  BaseContainer* bc = op->GetDataInstance();
+  if (!bc || !bc->GetBool(NRCONTAINER_HIDE_MATERIALS)) return;
+  BaseDocument* matDoc = op->GetDocument();
+  GeData data;
+  for (NodeIterator<BaseObject> it(op->GetDown(), op); it; ++it)
+  {
+    for (BaseTag* tag = it->GetFirstTag(); tag; tag = tag->GetNext())
+    {
+      if (tag->GetType() != Ttexture || !tag->GetParameter(TEXTURETAG_MATERIAL, data, DESCFLAGS_GET_0))
+        continue;
+      BaseMaterial* mat = static_cast<BaseMaterial*>(data.GetLink(matDoc, Mbase));
+      if (mat && !mat->GetNBit(NBIT_OHIDE))
+        ContainerHideNode(mat, true, doc);
+    }
+  }
+}
+
+
+/// ***************************************************************************
+/// Computes the bounds of \p count > 0 points with the bounds kernel.
+/// Large point sets are split over the job system.
+/// ***************************************************************************
+static void ReducePointBounds(const double* xyz, size_t count, double* bbmin, double* bbmax)
+{
+  static const size_t grain = 32 * 1024;
+  GetKernels().boundsReduce(xyz, count < grain ? count : grain, bbmin, bbmax);
+  if (count <= grain) return;
+
+  std::mutex lock;
+  ParallelFor(count - grain, grain, [&](size_t begin, size_t end) {
+    double lo[3], hi[3];
+    GetKernels().boundsReduce(xyz + (grain + begin) * 3, end - begin, lo, hi);
+    std::lock_guard<std::mutex> guard(lock);
+    for (LONG i=0; i < 3; i++)
+    {
+      if (lo[i] < bbmin[i]) bbmin[i] = lo[i];
+      if (hi[i] > bbmax[i]) bbmax[i] = hi[i];
+    }
+  });
+}
+
+/// ***************************************************************************
+/// Adds the corners of the bounding box of \p op, transformed by \p mg,
+/// to \p points.
+/// ***************************************************************************
+static void CollectBoxCorners(BaseObject* op, Matrix const& mg, ScratchVector<Vector>& points)
+{
+  Vector bbmin = op->GetMp() - op->GetRad();
+  Vector bbmax = op->GetMp() + op->GetRad();
+  for (LONG i=0; i < 8; i++)
+  {
+    Vector corner((i & 1) ? bbmax.x : bbmin.x, (i & 2) ? bbmax.y : bbmin.y, (i & 4) ? bbmax.z : bbmin.z);
+    points.PushBack(mg * corner);
+  }
+}
+
+/// ***************************************************************************
+/// Adds points that bound \p op in world space to \p points. These are
+/// the points of its cache if that is a single small point object,
+/// otherwise the corners of its bounding box.
+/// ***************************************************************************
+static void CollectBoundsPoints(BaseObject* op, ScratchVector<Vector>& points)
+{
+  static const LONG maxCachePoints = 4096;
+  Matrix mg = op->GetMg();
+
+  BaseObject* cache = op->GetDeformCache();
+  if (!cache) cache = op->GetCache();
+  if (cache && cache->IsInstanceOf(Opoint) && !cache->GetNext() && !cache->GetDown())
+  {
+    PointObject* pobj = static_cast<PointObject*>(cache);
+    const Vector* src = pobj->GetPointR();
+    LONG count = pobj->GetPointCount();
+    if (src && count > 0 && count <= maxCachePoints)
+    {
+      Matrix m = mg * cache->GetMl();
+      for (LONG i=0; i < count; i++)
+        points.PushBack(m * src[i]);
+      return;
+    }
+  }
+  CollectBoxCorners(op, mg, points);
+}
+
+/// ***************************************************************************
+/// Returns true if every generator in the hierarchy of \p op that is
+/// measured for the bounding box has its cache built.
+/// ***************************************************************************
+static Bool HierarchyHasCaches(BaseObject* op)
+{
+  for (NodeIterator<BaseObject> it(op->GetDown(), op); it; ++it)
+  {
+    if (it->GetInfo() & OBJECT_GENERATOR && !IsControlledByGenerator(*it) &&
+        !it->GetCache() && it->GetDeformMode())
+      return false;
+  }
+  return true;
+}
+
+
+/// ***************************************************************************
+/// The bounding box of a container's hierarchy, in world space, and the
+/// state it was measured in. #orientedMode is the bounds mode it was
+/// measured in, in which the oriented box #obb is measured as well. It is
+/// #oriented unless there was nothing to measure. #localMp and #localRad
+/// are the bounds of the hierarchy, or of the oriented box, in the
+/// container's coordinate system.
+///
+/// A box read from the document is #pending until the structure of the
+/// hierarchy is found to match #key. It is then used as long as the
+/// data and matrices of the hierarchy and the document time stay the
+/// same, as the dirty counts of the loaded caches are not comparable.
+/// Once all caches are built, their dirty count #restoredCacheDirty is
+/// checked as well, a cache can change without anything in the hierarchy
+/// changing (eg. an Instance whose source is outside of the container).
+///
+/// Duplicates detach their children while the document is saved, so the
+/// structure #saveKey and dirty count #saveDirty are taken by #BeginSave()
+/// before that.
+///
+/// #docDirty and #checkedTime are the state of the document when the box
+/// was last validated. While they stay the same, nothing in the hierarchy
+/// can have changed and it doesn't need to be walked again. This is only
+/// trusted for a #complete box, one that was measured with the caches of
+/// all generators in the hierarchy built.
+/// ***************************************************************************
+struct BoundingBoxCache
+{
+  Bool valid;
+  Bool empty;
+  Bool oriented;
+  Bool orientedMode;
+  Bool complete;
+  ULONG dirty;
+  ULONG docDirty;
+  BaseTime checkedTime;
+  Matrix mg;
+  Vector mp;
+  Vector rad;
+  OBB obb;
+  Vector localMp;
+  Vector localRad;
+
+  Bool pending;
+  Bool restored;
+  String key;
+  ULONG restoredDirty;
+  BaseTime restoredTime;
+  Bool cachesBuilt;
+  ULONG restoredCacheDirty;
+
+  Bool saving;
+  String saveKey;
+  ULONG saveDirty;
+
+  BoundingBoxCache() : valid(false), complete(false), pending(false), restored(false),
+    saving(false) { }
+
+  /// Called before the document is saved, with the hierarchy complete.
+  void BeginSave(BaseObject* op, ULONG dirty)
+  {
+    saving = true;
+    saveDirty = dirty;
+    saveKey = valid ? FingerprintStructure(op) : String();
+  }
+
+  /// Called after the document was saved.
+  void EndSave()
+  {
+    saving = false;
+    saveKey = String();
+  }
+
+  /// Writes the box if it is valid, the hierarchy dirty count \p dirty
+  /// and matrix \p mg being the ones of the current state.
+  Bool Write(HyperFile* hf, BaseObject* op, ULONG dirty, Matrix const& mg) const
+  {
+    if (saving) dirty = saveDirty;
+    Bool current = valid && !pending && (restored || this->dirty == dirty) && this->mg == mg;
+    if (!hf->WriteBool(current)) return false;
+    if (!current) return true;
+    if (!hf->WriteString(saving ? saveKey : FingerprintStructure(op))) return false;
+    if (!hf->WriteBool(empty) || !hf->WriteBool(orientedMode)) return false;
+    if (!hf->WriteMatrix(mg) || !hf->WriteVector(mp) || !hf->WriteVector(rad)) return false;
+    if (!hf->WriteVector(obb.center) || !hf->WriteVector(obb.extent)) return false;
+    for (LONG i=0; i < 3; i++)
+    {
+      if (!hf->WriteVector(obb.axes[i])) return false;
+    }
+    return hf->WriteVector(localMp) && hf->WriteVector(localRad);
+  }
+
+  /// Reads a box written with #Write() as #pending.
+  Bool Read(HyperFile* hf)
+  {
+    valid = complete = pending = restored = false;
+    if (!hf->ReadBool(&pending)) return false;
+    if (!pending) return true;
+    if (!hf->ReadString(&key)) return false;
+    if (!hf->ReadBool(&empty) || !hf->ReadBool(&orientedMode)) return false;
+    oriented = orientedMode && !empty;
+    if (!hf->ReadMatrix(&mg) || !hf->ReadVector(&mp) || !hf->ReadVector(&rad)) return false;
+    if (!hf->ReadVector(&obb.center) || !hf->ReadVector(&obb.extent)) return false;
+    for (LONG i=0; i < 3; i++)
+    {
+      if (!hf->ReadVector(&obb.axes[i])) return false;
+    }
+    return hf->ReadVector(&localMp) && hf->ReadVector(&localRad);
+  }
+};
+
 /// ***************************************************************************
 /// ***************************************************************************
 class ContainerObject : public ObjectData
 {
   typedef ObjectData super;
 
-  BaseBitmap* m_customIcon;
+  CachedIcon m_customIcon;
   Bool m_protected;
   String m_protectionHash;
+  PromotedParameterList m_promoted;
+  DedupeState m_dedupe;
+  DependencyCache m_dependencies;
+  BoundingBoxCache m_bbox;
+  PlaybackCache m_playback;
+  CheckpointList m_checkpoints;
+  BaseDocument* m_indexDoc;
   friend Bool ContainerIsProtected(BaseObject*, String*);
-  friend Bool ContainerProtect(BaseObject*, String const&, String, Bool);
+  friend String ContainerGetIconHash(BaseObject*);
+  friend DedupeState* ContainerGetDedupeState(BaseObject*);
+  friend Bool ContainerGetDependencies(BaseObject*, ContainerDependencies&);
+  friend Bool ContainerGetBounds(BaseObject*, Vector*, Vector*, Bool);
+  friend Bool ContainerGetOrientedBounds(BaseObject*, OBB*);
+  friend Bool ContainerProtect(BaseObject*, String const&, String, Bool, BaseDocument*);
+  friend Bool ContainerUnprotect(BaseObject*, String const&, BaseDocument*);
+  friend Bool ContainerHasPlaybackCache(BaseObject*);
+  friend Bool ContainerRefreshPlaybackCache(BaseObject*);
 public:
 
   static NodeData* Alloc() { return gNew(ContainerObject); }
@@ -151,32 +440,26 @@ public:
 
         if (ok)
         {
-          // Ensure the destination bitmap is allocated.
-          if (!m_customIcon)
-            m_customIcon = BaseBitmap::Alloc();
-          else
-            m_customIcon->FlushAll();
-
-          // If it is still null here, allocation failed.
-          if (!m_customIcon)
+          AutoAlloc<BaseBitmap> bmp;
+          if (!bmp)
             MessageDialog(GeLoadString(IDS_INFO_OUTOFMEMORY));
           else
           {
-            IMAGERESULT res = m_customIcon->Init(flname);
+            IMAGERESULT res = bmp->Init(flname);
             if (res != IMAGERESULT_OK)
             {
               MessageDialog(IDS_INFO_INVALIDIMAGE);
-              BaseBitmap::Free(m_customIcon);
+              m_customIcon.Flush();
             }
             else
             {
               // Scale the bitmap down to 64x64 pixels.
-              BaseBitmap* dest = BaseBitmap::Alloc();
+              AutoAlloc<BaseBitmap> dest;
               const LONG size = CONTAINEROBJECT_ICONSIZE;
-              dest->Init(size, size);
-              m_customIcon->ScaleIt(dest, 256, true, true);
-              BaseBitmap::Free(m_customIcon);
-              m_customIcon = dest;
+              if (dest) dest->Init(size, size);
+              if (dest) bmp->ScaleIt(dest, 256, true, true);
+              if (!dest || !m_customIcon.Set(dest))
+                MessageDialog(GeLoadString(IDS_INFO_OUTOFMEMORY));
             }
           }
         }
@@ -185,13 +468,60 @@ public:
       case NRCONTAINER_ICON_CLEAR:
       {
         if (m_protected) break;
-        if (m_customIcon)
+        // Cinema keeps its own copy of the icon, the decoded bitmap
+        // in the icon cache can be freed right away.
+        m_customIcon.Flush();
+        break;
+      }
+      case NRCONTAINER_PROMOTE_USERDATA:
+      {
+        if (m_protected) break;
+        if (doc) doc->AddUndo(UNDOTYPE_CHANGE, op);
+        if (PromoteActiveUserdata(op, m_promoted) > 0)
+        {
+          op->SetDirty(DIRTYFLAGS_DESCRIPTION);
+          EventAdd();
+        }
+        break;
+      }
+      case NRCONTAINER_CHECKPOINT_SAVE:
+      {
+        if (m_protected) break;
+        BaseContainer const* bc = op->GetDataInstance();
+        String name = bc ? bc->GetString(NRCONTAINER_CHECKPOINT_NAME) : String();
+        if (!name.Content())
+          name = "Checkpoint " + LongToString(m_checkpoints.GetCount() + 1);
+        LONG shared = 0;
+        if (!m_checkpoints.Save(op, name, &shared))
         {
-          // TODO: We possibly require a flag for removing the icon
-          // on the next MSG_GETCUSTOMICON message, because Cinema
-          // still references this bitmap.
-          BaseBitmap::Free(m_customIcon);
+          MessageDialog(GeLoadString(IDS_INFO_CHECKPOINT_FAILED));
+          break;
         }
+        GePrint("Checkpoint " + name + " saved, " + LongToString(shared) +
+          " unchanged branches shared, " + LongToString((LONG) (m_checkpoints.GetMemory() / 1024)) +
+          " KB in all checkpoints");
+        op->SetDirty(DIRTYFLAGS_DESCRIPTION);
+        break;
+      }
+      case NRCONTAINER_CHECKPOINT_RESTORE:
+      {
+        if (m_protected) break;
+        BaseContainer const* bc = op->GetDataInstance();
+        String name = bc ? bc->GetString(NRCONTAINER_CHECKPOINT_NAME) : String();
+        if (!m_checkpoints.Restore(op, name, doc))
+        {
+          MessageDialog(GeLoadString(IDS_INFO_CHECKPOINT_FAILED));
+          break;
+        }
+        op->Message(MSG_UPDATE);
+        EventAdd();
+        break;
+      }
+      case NRCONTAINER_CHECKPOINT_DELETE:
+      {
+        BaseContainer const* bc = op->GetDataInstance();
+        if (m_checkpoints.Remove(bc ? bc->GetString(NRCONTAINER_CHECKPOINT_NAME) : String()))
+          op->SetDirty(DIRTYFLAGS_DESCRIPTION);
         break;
       }
     }
@@ -201,23 +531,29 @@ public:
   void OnGetCustomIcon(BaseObject* op, GetCustomIconData* data)
   {
     IconData* dIcon = data->dat;
-    BaseBitmap* bmp;
+    BaseBitmap* bmp = nullptr;
     LONG xoff, yoff, xdim, ydim;
 
-    if (m_customIcon)
+    // The custom icon is decoded again if it was evicted from the
+    // icon cache.
+    if (!m_customIcon.IsEmpty())
     {
       if (dIcon->bmp)
       {
         // We can not free the previous bitmap, because it leads to a
         // crash. We copy the custom icon bitmap to the already
         // present bitmap.
-        bmp = dIcon->bmp;
-        m_customIcon->CopyTo(bmp);
+        if (m_customIcon.CopyPixelsTo(dIcon->bmp))
+          bmp = dIcon->bmp;
       }
       else
       {
-        bmp = m_customIcon->GetClone();
+        bmp = m_customIcon.GetClone();
       }
+    }
+
+    if (bmp)
+    {
       xoff = 0;
       yoff = 0;
       xdim = bmp->GetBw();
@@ -257,6 +593,47 @@ public:
     }
   }
 
+  /// Called from Message() for MSG_DOCUMENTINFO.
+  void OnDocumentInfo(BaseObject* op, DocumentInfoData* info)
+  {
+    UpdateIndexDocument(op, info->doc);
+    switch (info->type)
+    {
+      case MSG_DOCUMENTINFO_TYPE_SAVE_BEFORE:
+        m_bbox.BeginSave(op, GetHierarchyDirty(op, DIRTYFLAGS_DATA | DIRTYFLAGS_MATRIX | DIRTYFLAGS_CACHE));
+        CatalogBeginSave(info->doc, op, m_dedupe, m_customIcon.GetEncoded());
+        DedupeBeginSave(info->doc, op, m_dedupe, m_customIcon.GetHash());
+        break;
+      case MSG_DOCUMENTINFO_TYPE_SAVE_AFTER:
+        DedupeEndSave(info->doc, op, m_dedupe);
+        CatalogEndSave(info->doc, op, info->filename);
+        m_bbox.EndSave();
+        break;
+      case MSG_DOCUMENTINFO_TYPE_LOAD:
+      case MSG_DOCUMENTINFO_TYPE_MERGE:
+      {
+        BaseObject* master = DedupeExpand(info->doc, op, m_dedupe);
+        if (master && m_dedupe.iconShared)
+        {
+          ContainerObject* data = GetNodeData<ContainerObject>(master);
+          if (data)
+            data->m_customIcon.CopyTo(m_customIcon);
+          else
+            m_customIcon.Flush();
+        }
+        if (!m_dedupe.missing)
+          m_dedupe.iconShared = false;
+
+        // Playback caches are not saved, bring back the hierarchy
+        // that was bypassed for it.
+        if (!m_playback.IsActive())
+          PlaybackCacheBypass(op, nullptr, false);
+        CacheWarmupQueue(op);
+        break;
+      }
+    }
+  }
+
   /// Called from Message() for MSG_EDIT (when a user double-clicks
   /// the object icon). Toggles the protection state of the container.
   void ToggleProtect(BaseObject* op)
@@ -280,6 +657,9 @@ public:
       m_protected = true;
       m_protectionHash = hashed;
 
+      StartPlaybackCache(op, doc);
+      if (bc->GetBool(NRCONTAINER_INSTANCE_ON_LOCK))
+        PromoteInstances(op, doc);
       HideNodes(op, doc, true);
     }
     else
@@ -300,6 +680,8 @@ public:
       if (unlock)
       {
         m_protected = false;
+        StopPlaybackCache(op, doc);
+        RestoreInstances(op, doc);
         HideNodes(op, doc, false);
       }
     }
@@ -309,6 +691,26 @@ public:
     EventAdd();
   }
 
+  /// Records the playback cache and bypasses the hierarchy if the
+  /// container has the "Playback Cache on Lock" option enabled.
+  void StartPlaybackCache(BaseObject* op, BaseDocument* doc)
+  {
+    BaseContainer const* bc = op->GetDataInstance();
+    if (!bc || !bc->GetBool(NRCONTAINER_PLAYBACK_CACHE)) return;
+    if (m_playback.Record(op, op->GetDocument()))
+      PlaybackCacheBypass(op, doc, true);
+    else
+      GePrint("Container Object: could not record the playback cache of " + op->GetName());
+  }
+
+  /// Drops the playback cache and restores the bypassed hierarchy.
+  void StopPlaybackCache(BaseObject* op, BaseDocument* doc)
+  {
+    m_playback.Flush();
+    if (PlaybackCacheBypass(op, doc, false) > 0)
+      op->SetDirty(DIRTYFLAGS_DATA);
+  }
+
   /// Called to hide/unhide the container object contents.
   void HideNodes(BaseObject* op, BaseDocument* doc, Bool hide)
   {
@@ -316,6 +718,7 @@ public:
     {
       BaseContainer* bc = op->GetDataInstance();
       CriticalAssert(bc != nullptr);
+      ProgressiveUnpackCancel(op);
       HideHierarchy(op->GetDown(), true, doc);
       if (bc->GetBool(NRCONTAINER_HIDE_TAGS))
         HideHierarchy(op->GetFirstTag(), true, doc);
@@ -324,29 +727,238 @@ public:
     }
     else
     {
-      HideHierarchy(op->GetDown(), false, doc);
+      // Large hierarchies are revealed level by level in the background,
+      // only the first levels are revealed right away.
+      if (GetPrefBool(PREF_PROGRESSIVE_UNPACK) && ProgressiveUnpackStart(op, PROGRESSIVE_UNPACK_LEVELS))
+        HideHierarchy(op->GetDown(), false, doc, true, PROGRESSIVE_UNPACK_LEVELS);
+      else
+        HideHierarchy(op->GetDown(), false, doc);
       HideHierarchy(op->GetFirstTag(), false, doc);
       HideMaterials(op, false, doc);
     }
   }
 
+  /// Tells the container index when the container is found in another
+  /// document than the one it reported last.
+  void UpdateIndexDocument(BaseObject* op, BaseDocument* doc)
+  {
+    if (doc && doc != m_indexDoc)
+    {
+      m_indexDoc = doc;
+      ContainerIndexInsert(op, doc);
+    }
+  }
+
   // ObjectData Overrides
 
-  virtual void GetDimension(BaseObject* op, Vector* mp, Vector* rad) override
+  /// Measures the bounding box of the hierarchy again if any object in
+  /// it or the container's position changed since it was last measured.
+  /// Returns \c true if the bounding box changed.
+  Bool UpdateBoundingBox(BaseObject* op)
   {
+    Matrix mg = op->GetMg();
+    BaseContainer* bc = op->GetDataInstance();
+    Bool oriented = bc && bc->GetLong(NRCONTAINER_BOUNDS_MODE) == NRCONTAINER_BOUNDS_MODE_OBB;
+    BaseDocument* doc = op->GetDocument();
+    BaseTime time = doc ? doc->GetTime() : BaseTime();
+    UpdateIndexDocument(op, doc);
+
+    // Walking the hierarchy for its dirty count is what makes large rigs
+    // slow to draw. Nothing in it changed if nothing in the document did.
+    ULONG docDirty = doc ? doc->GetHDirty(HDIRTYFLAGS_OBJECT | HDIRTYFLAGS_OBJECT_MATRIX |
+        HDIRTYFLAGS_OBJECT_HIERARCHY | HDIRTYFLAGS_TAG) : 0;
+    if (doc && m_bbox.valid && m_bbox.complete && m_bbox.docDirty == docDirty &&
+        m_bbox.checkedTime == time && m_bbox.mg == mg && m_bbox.orientedMode == oriented)
+    {
+      StatIncrement(STATCOUNTER_BBOX_HITS);
+      return false;
+    }
+    m_bbox.docDirty = docDirty;
+    m_bbox.checkedTime = time;
+
+    ULONG dirty = GetHierarchyDirty(op, DIRTYFLAGS_DATA | DIRTYFLAGS_MATRIX | DIRTYFLAGS_CACHE);
+    if (m_bbox.valid && m_bbox.dirty == dirty && m_bbox.mg == mg && m_bbox.orientedMode == oriented)
+    {
+      StatIncrement(STATCOUNTER_BBOX_HITS);
+      return false;
+    }
+
+    // Generator caches are built after loading, which changes the dirty
+    // count without changing the bounds. A box restored from the document
+    // is kept until the data or matrices change, or time moves on.
+    ULONG dataDirty = GetHierarchyDirty(op, DIRTYFLAGS_DATA | DIRTYFLAGS_MATRIX);
+    if (m_bbox.pending)
+    {
+      m_bbox.pending = false;
+      if (m_bbox.mg == mg && m_bbox.orientedMode == oriented && m_bbox.key == FingerprintStructure(op))
+      {
+        m_bbox.valid = true;
+        m_bbox.complete = false;
+        m_bbox.restored = true;
+        m_bbox.restoredDirty = dataDirty;
+        m_bbox.restoredTime = time;
+        m_bbox.cachesBuilt = false;
+        m_bbox.dirty = dirty;
+        StatIncrement(STATCOUNTER_BBOX_RESTORED);
+        ContainerIndexBoundsChanged(op);
+        return true;
+      }
+    }
+    if (m_bbox.restored)
+    {
+      Bool same = m_bbox.restoredDirty == dataDirty && m_bbox.restoredTime == time &&
+          m_bbox.mg == mg && m_bbox.orientedMode == oriented;
+      if (same)
+      {
+        ULONG cacheDirty = GetHierarchyDirty(op, DIRTYFLAGS_CACHE);
+        if (!m_bbox.cachesBuilt && HierarchyHasCaches(op))
+        {
+          m_bbox.cachesBuilt = true;
+          m_bbox.restoredCacheDirty = cacheDirty;
+        }
+        same = !m_bbox.cachesBuilt || m_bbox.restoredCacheDirty == cacheDirty;
+      }
+      if (same)
+      {
+        m_bbox.dirty = dirty;
+        StatIncrement(STATCOUNTER_BBOX_HITS);
+        return false;
+      }
+      m_bbox.restored = false;
+    }
+    StatIncrement(STATCOUNTER_BBOX_MISSES);
+    TraceScope trace(TRACEEVENT_BBOX_MEASURE, op);
+
     // Find the Minimum/Maximum of the object's bounding
-    // box by all hidden child-objects in its hierarchy.
+    // box by all hidden child-objects in its hierarchy. The points
+    // are reduced by the bounds kernel in both modes. In AABB mode,
+    // the corners are measured in the container's coordinate system,
+    // in OBB mode the points are in world space.
     AABB bbox;
+    ScratchScope scope;
+    ScratchVector<Vector> points(scope, 256);
+    Bool complete = true;
+    Matrix img = ~mg;
     for (NodeIterator<BaseObject> it(op->GetDown(), op); it; ++it)
     {
       // We skip objects that are being controlled by
       // a generator object.
       if (it->GetInfo() & OBJECT_GENERATOR && !IsControlledByGenerator(*it))
-        bbox.Expand(*it, it->GetMg(), false);
+      {
+        if (!it->GetCache() && it->GetDeformMode())
+          complete = false;
+        if (oriented)
+          CollectBoundsPoints(*it, points);
+        else
+          CollectBoxCorners(*it, img * it->GetMg(), points);
+      }
+    }
+    trace.SetArg((uint32_t) points.GetSize());
+    if (!points.IsEmpty())
+    {
+      static_assert(sizeof(Vector) == 3 * sizeof(double), "Vector must be three doubles");
+      double bbmin[3], bbmax[3];
+      ReducePointBounds(reinterpret_cast<const double*>(points.GetData()),
+        points.GetSize(), bbmin, bbmax);
+      bbox.Expand(Vector(bbmin[0], bbmin[1], bbmin[2]));
+      bbox.Expand(Vector(bbmax[0], bbmax[1], bbmax[2]));
+    }
+
+    // GetDimension() expects the bounds in the container's coordinate
+    // system, in both modes. The world box is derived from them in AABB
+    // mode, and from the points in OBB mode.
+    OBB obb;
+    Bool hasObb = oriented && ComputeOBB(points.GetData(), (LONG) points.GetSize(), obb);
+    AABB local, world;
+    if (hasObb)
+    {
+      world = bbox;
+      Matrix m = img * obb.GetMatrix();
+      for (LONG i=0; i < 8; i++)
+        local.Expand(m * Vector((i & 1) ? 1 : -1, (i & 2) ? 1 : -1, (i & 4) ? 1 : -1));
+    }
+    else if (bbox.IsInitialized())
+    {
+      local = bbox;
+      Vector lmp = local.GetMidpoint();
+      Vector lrad = local.GetSize();
+      for (LONG i=0; i < 8; i++)
+        world.Expand(mg * (lmp + Vector((i & 1) ? lrad.x : -lrad.x, (i & 2) ? lrad.y : -lrad.y, (i & 4) ? lrad.z : -lrad.z)));
     }
 
-    *mp = bbox.GetMidpoint();
-    *rad = bbox.GetSize();
+    Vector mp = world.IsInitialized() ? world.GetMidpoint() : Vector();
+    Vector rad = world.IsInitialized() ? world.GetSize() : Vector();
+    Bool changed = !m_bbox.valid || m_bbox.mp != mp || m_bbox.rad != rad ||
+        m_bbox.oriented != hasObb || (hasObb && !(m_bbox.obb == obb));
+    m_bbox.valid = true;
+    m_bbox.complete = complete;
+    m_bbox.empty = !world.IsInitialized();
+    m_bbox.oriented = hasObb;
+    m_bbox.orientedMode = oriented;
+    if (hasObb)
+      m_bbox.obb = obb;
+    m_bbox.dirty = dirty;
+    m_bbox.mg = mg;
+    m_bbox.mp = mp;
+    m_bbox.rad = rad;
+    m_bbox.localMp = local.IsInitialized() ? local.GetMidpoint() : Vector();
+    m_bbox.localRad = local.IsInitialized() ? local.GetSize() : Vector();
+    if (changed)
+      ContainerIndexBoundsChanged(op);
+    return changed;
+  }
+
+  // ObjectData Overrides
+
+  virtual void GetDimension(BaseObject* op, Vector* mp, Vector* rad) override
+  {
+    TraceScope trace(TRACEEVENT_GETDIMENSION, op);
+    UpdateBoundingBox(op);
+    *mp = m_bbox.localMp;
+    *rad = m_bbox.localRad;
+  }
+
+  virtual BaseObject* GetVirtualObjects(BaseObject* op, HierarchyHelp* hh) override
+  {
+    if (!m_playback.IsActive()) return nullptr;
+    BaseDocument* doc = hh->GetDocument();
+    if (m_playback.IsStale())
+      PlaybackCacheRequestRefresh();
+    BaseObject* cache = op->GetCache(hh);
+    Bool rebuild = op->CheckCache(hh) || op->IsDirty(DIRTYFLAGS_DATA);
+    if (!rebuild && !m_playback.IsDirty(doc)) return cache;
+    EvalProfileCacheScope profile(op);
+
+    // Only the frame changed, read its points into the objects that are
+    // already there instead of cloning them again.
+    if (!rebuild && m_playback.Update(doc, cache)) return cache;
+    return m_playback.Build(doc);
+  }
+
+  virtual Bool AddToExecution(BaseObject* op, PriorityList* list) override
+  {
+    return EvalProfileAddToExecution(op, list);
+  }
+
+  virtual EXECUTIONRESULT Execute(BaseObject* op, BaseDocument* doc, BaseThread* bt,
+        LONG priority, EXECUTIONFLAGS flags) override
+  {
+    TraceScope trace(TRACEEVENT_EXECUTE, op, (uint32_t) priority);
+    EvalProfileExecute(op, doc, priority);
+    return EXECUTIONRESULT_OK;
+  }
+
+  virtual DRAWRESULT Draw(BaseObject* op, DRAWPASS drawpass, BaseDraw* bd, BaseDrawHelp* bh) override
+  {
+    TraceScope trace(TRACEEVENT_DRAW, op, (uint32_t) drawpass);
+    UpdateIndexDocument(op, bh->GetDocument());
+    // Display the oriented box of selected containers.
+    if (drawpass == DRAWPASS_OBJECT && m_bbox.valid && m_bbox.oriented && op->GetBit(BIT_ACTIVE))
+    {
+      bd->SetMatrix_Matrix(nullptr, Matrix());
+      bd->DrawBox(m_bbox.obb.GetMatrix(), 1.0, bd->GetObjectColor(bh, op), true);
+    }
+    return super::Draw(op, drawpass, bd, bh);
   }
 
   //  NodeData Overrides
@@ -354,14 +966,22 @@ public:
   virtual Bool Init(GeListNode* node) override
   {
     if (!node || !super::Init(node)) return false;
-    if (m_customIcon) BaseBitmap::Free(m_customIcon);
+    m_customIcon.Flush();
     m_protected = false;
     m_protectionHash = "";
+    m_promoted.Flush();
+    m_bbox.valid = false;
+    m_bbox.complete = false;
+    m_bbox.pending = false;
+    m_bbox.restored = false;
+    m_indexDoc = nullptr;
     BaseContainer* bc = ((BaseList2D*) node)->GetDataInstance();
     if (!bc) return false;
     bc->SetBool(NRCONTAINER_HIDE_TAGS, false);
     bc->SetBool(NRCONTAINER_HIDE_MATERIALS, true);
     bc->SetBool(NRCONTAINER_GENERATOR_CHECKMARK, true);
+    bc->SetBool(NRCONTAINER_INSTANCE_ON_LOCK, false);
+    bc->SetLong(NRCONTAINER_BOUNDS_MODE, NRCONTAINER_BOUNDS_MODE_AABB);
     bc->SetString(NRCONTAINER_INFO_NAME, ""_s);
     bc->SetString(NRCONTAINER_INFO_VERSION, ""_s);
     bc->SetString(NRCONTAINER_INFO_URL, ""_s);
@@ -374,7 +994,16 @@ public:
   virtual void Free(GeListNode* node) override
   {
     super::Free(node);
-    if (m_customIcon) BaseBitmap::Free(m_customIcon);
+    m_customIcon.Flush();
+    m_promoted.Flush();
+    DedupeFree(static_cast<BaseObject*>(node), m_dedupe);
+    m_dependencies.Flush();
+    ContainerIndexUnregister(static_cast<BaseObject*>(node));
+    EvalProfileForget(static_cast<BaseObject*>(node));
+    CatalogForget(static_cast<BaseObject*>(node));
+    TraceForget(node);
+    m_playback.Flush();
+    m_checkpoints.Flush();
   }
 
   virtual Bool Read(GeListNode* node, HyperFile* hf, LONG level) override
@@ -390,14 +1019,12 @@ public:
 
     if (hasImage)
     {
-      if (m_customIcon)
-        m_customIcon->FlushAll();
-      else
-        m_customIcon = BaseBitmap::Alloc();
-      if (!hf->ReadImage(m_customIcon)) return false;
+      AutoAlloc<BaseBitmap> bmp;
+      if (!bmp || !hf->ReadImage(bmp)) return false;
+      m_customIcon.Set(bmp);
     }
-    else if (m_customIcon)
-      BaseBitmap::Free(m_customIcon);
+    else
+      m_customIcon.Flush();
 
     // VERSION 1000
 
@@ -410,6 +1037,48 @@ public:
       }
     }
 
+    // VERSION 1011
+
+    if (level >= 1011)
+    {
+      if (!m_promoted.Read(hf)) return false;
+    }
+    else
+      m_promoted.Flush();
+
+    // VERSION 1012
+
+    m_dedupe.key = "";
+    m_dedupe.ref = "";
+    m_dedupe.iconShared = false;
+    if (level >= 1012)
+    {
+      if (!hf->ReadString(&m_dedupe.key)) return false;
+      if (!hf->ReadString(&m_dedupe.ref)) return false;
+      if (!hf->ReadBool(&m_dedupe.iconShared)) return false;
+    }
+
+    // VERSION 1013
+
+    if (level >= 1013)
+    {
+      Bool compactIcon;
+      if (!hf->ReadBool(&compactIcon)) return false;
+      if (compactIcon)
+      {
+        std::vector<uint8_t> data;
+        if (!ReadCompactIcon(hf, data)) return false;
+        m_customIcon.SetEncoded(data);
+      }
+    }
+
+    // VERSION 1014
+
+    if (level >= 1014)
+    {
+      if (!m_bbox.Read(hf)) return false;
+    }
+
     return result;
   }
 
@@ -420,12 +1089,18 @@ public:
 
     // VERSION 0
 
-    // Write the custom icon to the HyperFile.
-    if (!hf->WriteBool(m_customIcon != NULL)) return false;
-    if (m_customIcon)
+    // Write the custom icon to the HyperFile. A duplicate that shares
+    // the icon of its master doesn't need to store it again. Compact
+    // icons are written at VERSION 1013 instead.
+    Bool writeIcon = !m_customIcon.IsEmpty() && !m_dedupe.iconShared;
+    Bool compactIcon = writeIcon && GetPrefBool(PREF_COMPACT_ICONS);
+    if (!hf->WriteBool(writeIcon && !compactIcon)) return false;
+    if (writeIcon && !compactIcon)
     {
-      if (!hf->WriteImage(m_customIcon, FILTER_PNG, NULL, SAVEBIT_ALPHA))
-        return false;
+      BaseBitmap* bmp = m_customIcon.GetClone();
+      Bool written = bmp && hf->WriteImage(bmp, FILTER_PNG, NULL, SAVEBIT_ALPHA);
+      BaseBitmap::Free(bmp);
+      if (!written) return false;
     }
 
     // VERSION 1000
@@ -436,11 +1111,39 @@ public:
       if (!hf->WriteString(m_protectionHash)) return false;
     }
 
+    // VERSION 1011
+
+    m_promoted.Prune(static_cast<BaseList2D*>(node));
+    if (!m_promoted.Write(hf)) return false;
+
+    // VERSION 1012
+
+    if (!hf->WriteString(m_dedupe.key)) return false;
+    if (!hf->WriteString(m_dedupe.ref)) return false;
+    if (!hf->WriteBool(m_dedupe.iconShared)) return false;
+
+    // VERSION 1013
+
+    if (!hf->WriteBool(compactIcon)) return false;
+    if (compactIcon)
+    {
+      if (!WriteCompactIcon(hf, m_customIcon.GetEncoded())) return false;
+    }
+
+    // VERSION 1014
+
+    // The derived caches, so that they don't need to be computed again
+    // after loading.
+    BaseObject* op = static_cast<BaseObject*>(node);
+    ULONG dirty = GetHierarchyDirty(op, DIRTYFLAGS_DATA | DIRTYFLAGS_MATRIX | DIRTYFLAGS_CACHE);
+    if (!m_bbox.Write(hf, op, dirty, op->GetMg())) return false;
+
     return result;
   }
 
   virtual Bool Message(GeListNode* node, LONG msgType, void* pData) override
   {
+    TraceScope trace(TRACEEVENT_MESSAGE, node, (uint32_t) msgType);
     Bool result = super::Message(node, msgType, pData);
     if (!result) return result;
 
@@ -451,8 +1154,14 @@ public:
         OnDescriptionCommand(op, (DescriptionCommand*) pData);
         break;
       case MSG_GETCUSTOMICON:
+      {
+        TraceScope iconTrace(TRACEEVENT_GETCUSTOMICON, op, (uint32_t) m_customIcon.GetEncoded().size());
         OnGetCustomIcon(op, (GetCustomIconData*) pData);
         break;
+      }
+      case MSG_DOCUMENTINFO:
+        OnDocumentInfo(op, (DocumentInfoData*) pData);
+        break;
       case MSG_EDIT:
         ToggleProtect(op);
         break;
@@ -470,14 +1179,15 @@ public:
     ContainerObject* dest = (ContainerObject*) nDest;
 
     // Copy the custom icon to the new NodeData.
-    if (dest->m_customIcon)
-      BaseBitmap::Free(dest->m_customIcon);
-    if (m_customIcon)
-      dest->m_customIcon = m_customIcon->GetClone();
+    m_customIcon.CopyTo(dest->m_customIcon);
+    m_playback.CopyTo(dest->m_playback);
+    // Checkpoints keep the markers of the original nodes and are not
+    // copied, restoring them in a copy would duplicate the markers.
 
     // And the other stuff.. :-)
     dest->m_protected = m_protected;
     dest->m_protectionHash = m_protectionHash;
+    if (!m_promoted.CopyTo(dest->m_promoted, flags, at)) return false;
 
     return result;
   }
@@ -486,13 +1196,19 @@ public:
         DESCFLAGS_DESC& flags) override
   {
     if (!node || !desc) return false;
+    TraceScope trace(TRACEEVENT_GETDDESCRIPTION, node);
+    StatIncrement(STATCOUNTER_DESCRIPTION_REQUESTS);
     if (!desc->LoadDescription(Ocontainer)) return false;
 
-    // Hide the Objects parameter group.
-    AutoAlloc<AtomArray> t_arr;
-    BaseContainer* bc_group = desc->GetParameterI(ID_OBJECTPROPERTIES, t_arr);
-
-    if (bc_group) bc_group->SetBool(DESC_HIDE, m_protected);
+    // The registered description is already the one of an unprotected
+    // container. Only protected containers need the Objects parameter
+    // group to be hidden, which doesn't need an AtomArray either.
+    if (m_protected)
+    {
+      BaseContainer* bc_group = desc->GetParameterI(DescLevel(ID_OBJECTPROPERTIES), nullptr);
+      if (bc_group) bc_group->SetBool(DESC_HIDE, true);
+      StatIncrement(STATCOUNTER_DESCRIPTION_MODIFIED);
+    }
 
     flags |= DESCFLAGS_DESC_LOADED;
     return true;
@@ -501,9 +1217,19 @@ public:
   virtual Bool GetDParameter(GeListNode* node, const DescID& id, GeData& data,
         DESCFLAGS_GET& flags) override
   {
+    TraceScope trace(TRACEEVENT_GETDPARAMETER, node, (uint32_t) id[0].id);
     switch (id[0].id) {
       case NRCONTAINER_DEV_INFO:
-        data.SetString(""_s);
+      {
+        String info = GetStatisticsSummary();
+        String eval = EvalProfileGetSummary(static_cast<BaseObject*>(node));
+        if (eval.Content()) info += " | " + eval;
+        data.SetString(info);
+        flags |= DESCFLAGS_GET_PARAM_GET;
+        return true;
+      }
+      case NRCONTAINER_CHECKPOINT_INFO:
+        data.SetString(m_checkpoints.GetSummary());
         flags |= DESCFLAGS_GET_PARAM_GET;
         return true;
     }
@@ -513,6 +1239,7 @@ public:
   virtual Bool SetDParameter(GeListNode* node, const DescID& id,
         const GeData& data, DESCFLAGS_SET& flags) override
   {
+    TraceScope trace(TRACEEVENT_SETDPARAMETER, node, (uint32_t) id[0].id);
     switch (id[0].id) {
       case NRCONTAINER_INFO_NAME:
       case NRCONTAINER_INFO_VERSION:
@@ -526,6 +1253,17 @@ public:
           return true;
         }
         break;
+      case ID_USERDATA:
+        // Promoted parameters also set the value of the parameter
+        // they are bound to. The value is still stored in the
+        // container, too.
+        m_promoted.Forward(node->GetDocument(), id, data);
+
+        // The playback cache was recorded with the previous value.
+        // Animated parameters were recorded over time already.
+        if (m_playback.IsActive() && GeIsMainThread() && !((BaseList2D*) node)->FindCTrack(id))
+          StopPlaybackCache((BaseObject*) node, node->GetDocument());
+        break;
     }
     return super::SetDParameter(node, id, data, flags);
   }
@@ -541,6 +1279,8 @@ public:
       case NRCONTAINER_INFO_AUTHOR:
       case NRCONTAINER_INFO_AUTHOR_EMAIL:
       case NRCONTAINER_INFO_DESCRIPTION:
+      case NRCONTAINER_CHECKPOINT_SAVE:
+      case NRCONTAINER_CHECKPOINT_RESTORE:
         return !this->m_protected;
     }
     return super::GetDEnabling(node, id, t_data, flags, itemdesc);
@@ -572,7 +1312,17 @@ Bool ContainerIsProtected(BaseObject* op, String* hash)
 
 /// ***************************************************************************
 /// ***************************************************************************
-Bool ContainerProtect(BaseObject* op, String const& pass, String hash, Bool packup)
+String ContainerGetIconHash(BaseObject* op)
+{
+  if (!op || op->GetType() != Ocontainer) return String();
+  ContainerObject* data = GetNodeData<ContainerObject>(op);
+  if (!data || data->m_customIcon.IsEmpty()) return String();
+  return data->m_customIcon.GetHash();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool ContainerProtect(BaseObject* op, String const& pass, String hash, Bool packup, BaseDocument* doc)
 {
   if (!op || op->GetType() != Ocontainer) return false;
   ContainerObject* data = GetNodeData<ContainerObject>(op);
@@ -584,7 +1334,107 @@ Bool ContainerProtect(BaseObject* op, String const& pass, String hash, Bool pack
   data->m_protected = true;
   data->m_protectionHash = hash;
   if (packup)
-    data->HideNodes(op, nullptr, packup);
+  {
+    BaseContainer* bc = op->GetDataInstance();
+    data->StartPlaybackCache(op, doc);
+    if (bc && bc->GetBool(NRCONTAINER_INSTANCE_ON_LOCK))
+      PromoteInstances(op, doc);
+    data->HideNodes(op, doc, packup);
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool ContainerUnprotect(BaseObject* op, String const& hash, BaseDocument* doc)
+{
+  if (!op || op->GetType() != Ocontainer) return false;
+  ContainerObject* data = GetNodeData<ContainerObject>(op);
+  if (!data || !data->m_protected || data->m_protectionHash != hash)
+    return false;
+  if (doc)
+    doc->AddUndo(UNDOTYPE_CHANGE_SMALL, op);
+  data->m_protected = false;
+  data->StopPlaybackCache(op, doc);
+  RestoreInstances(op, doc);
+  data->HideNodes(op, doc, false);
+  op->Message(MSG_CHANGE);
+  op->SetDirty(DIRTYFLAGS_DESCRIPTION);
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool ContainerHasPlaybackCache(BaseObject* op)
+{
+  if (!op || op->GetType() != Ocontainer) return false;
+  ContainerObject* data = GetNodeData<ContainerObject>(op);
+  return data && data->m_playback.IsActive();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool ContainerRefreshPlaybackCache(BaseObject* op)
+{
+  if (!op || op->GetType() != Ocontainer || !GeIsMainThread()) return false;
+  ContainerObject* data = GetNodeData<ContainerObject>(op);
+  if (!data || !data->m_playback.IsStale()) return false;
+  data->StopPlaybackCache(op, nullptr);
+  data->StartPlaybackCache(op, nullptr);
+  op->SetDirty(DIRTYFLAGS_DATA);
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+DedupeState* ContainerGetDedupeState(BaseObject* op)
+{
+  if (!op || op->GetType() != Ocontainer) return nullptr;
+  ContainerObject* data = GetNodeData<ContainerObject>(op);
+  if (!data) return nullptr;
+  return &data->m_dedupe;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool ContainerGetDependencies(BaseObject* op, ContainerDependencies& deps)
+{
+  if (!op || op->GetType() != Ocontainer) return false;
+  ContainerObject* data = GetNodeData<ContainerObject>(op);
+  if (!data) return false;
+  return data->m_dependencies.Collect(op, deps);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool ContainerGetBounds(BaseObject* op, Vector* bbmin, Vector* bbmax, Bool refresh)
+{
+  if (!op || op->GetType() != Ocontainer) return false;
+  ContainerObject* data = GetNodeData<ContainerObject>(op);
+  if (!data) return false;
+  if (refresh)
+    data->UpdateBoundingBox(op);
+
+  // Containers that were not measured yet or are empty are a point at
+  // their position.
+  if (!data->m_bbox.valid || data->m_bbox.empty)
+  {
+    *bbmin = *bbmax = op->GetMg().off;
+    return true;
+  }
+  *bbmin = data->m_bbox.mp - data->m_bbox.rad;
+  *bbmax = data->m_bbox.mp + data->m_bbox.rad;
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool ContainerGetOrientedBounds(BaseObject* op, OBB* obb)
+{
+  if (!op || op->GetType() != Ocontainer) return false;
+  ContainerObject* data = GetNodeData<ContainerObject>(op);
+  if (!data || !data->m_bbox.valid || !data->m_bbox.oriented) return false;
+  *obb = data->m_bbox.obb;
   return true;
 }
 
@@ -595,12 +1445,16 @@ decltype(C4D_Object::GetInfo) _orig_GetInfo = nullptr;
 static LONG _hook_GetInfo(GeListNode* op)
 {
   if (op && op->GetType() == Ocontainer) {
+    TraceScope trace(TRACEEVENT_GETINFO, op);
+    // AddToExecution() is only needed for the evaluation profile.
+    LONG info = EvalProfileIsEnabled() ? OBJECT_CALL_ADDEXECUTION : 0;
+    if (ContainerHasPlaybackCache(static_cast<BaseObject*>(op)))
+      return info | OBJECT_GENERATOR;
     GeData data;
     op->GetParameter(NRCONTAINER_GENERATOR_CHECKMARK, data, DESCFLAGS_GET_0);
     if (data.GetBool())
-      return OBJECT_GENERATOR;
-    else
-      return 0;
+      info |= OBJECT_GENERATOR;
+    return info;
   }
   return _orig_GetInfo(op);
 }
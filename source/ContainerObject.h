@@ -7,19 +7,35 @@
 
 #include <c4d.h>
 #include <c4d_legacy.h>
+#include <vector>
 
 #ifndef _CONTAINEROBJECT_H
 #define _CONTAINEROBJECT_H
 
 enum
 {
-  CONTAINEROBJECT_DISKLEVEL = 1010,
+  CONTAINEROBJECT_DISKLEVEL = 1014,
   CONTAINEROBJECT_ICONSIZE = 64,
   CONTAINEROBJECT_PROTECTIONHASH = 1036106,
 };
 
+struct DedupeState;
+struct ContainerDependencies;
+struct OBB;
+
 Bool ContainerIsProtected(BaseObject* op, String* hash=nullptr);
-Bool ContainerProtect(BaseObject* op, String const& pass, String hash, Bool packup=true);
+String ContainerGetIconHash(BaseObject* op);
+Bool ContainerProtect(BaseObject* op, String const& pass, String hash, Bool packup=true, BaseDocument* doc=nullptr);
+Bool ContainerUnprotect(BaseObject* op, String const& hash, BaseDocument* doc=nullptr);
+DedupeState* ContainerGetDedupeState(BaseObject* op);
+Bool ContainerGetDependencies(BaseObject* op, ContainerDependencies& deps);
+Bool ContainerGetBounds(BaseObject* op, Vector* bbmin, Vector* bbmax, Bool refresh);
+Bool ContainerGetOrientedBounds(BaseObject* op, OBB* obb);
+Bool ContainerHasPlaybackCache(BaseObject* op);
+Bool ContainerRefreshPlaybackCache(BaseObject* op);
+void ContainerHideNode(BaseList2D* node, Bool hide, BaseDocument* doc=nullptr);
+void ContainerHideInserted(BaseObject* op, std::vector<BaseObject*> const& nodes, BaseDocument* doc=nullptr);
+Bool ContainerIsSealed(BaseList2D* node);
 Bool RegisterContainerObject(Bool menu);
 
 #endif // _CONTAINEROBJECT_H
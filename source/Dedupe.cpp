@@ -0,0 +1,391 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Dedupe.cpp
+
+#include "Dedupe.h"
+#include "ContainerObject.h"
+#include "Preferences.h"
+#include "Utils/Fingerprint.h"
+#include "Utils/Misc.h"
+#include "res/c4d_symbols.h"
+#include <c4d_apibridge.h>
+#include <customgui_inexclude.h>
+#include <Ocontainer.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using c4d_apibridge::IsEmpty;
+
+enum
+{
+  ID_DEDUPE = 1036119,
+};
+
+/// Milliseconds between checks for stale save sessions.
+static const LONG STALE_INTERVAL = 100;
+
+/// ***************************************************************************
+/// The containers of a document that is currently being saved.
+/// ***************************************************************************
+struct DedupeSession
+{
+  std::unordered_map<std::string, BaseObject*> masters;
+  std::unordered_set<BaseObject*> members;
+};
+
+// Only accessed from the main thread.
+static std::unordered_map<BaseDocument*, DedupeSession> g_sessions;
+
+/// ***************************************************************************
+/// Returns \c true if \p op is not inside another container. Only these
+/// take part in the deduplication, so that a master can never be hidden
+/// inside of a duplicate.
+/// ***************************************************************************
+static Bool IsTopLevelContainer(BaseObject* op)
+{
+  for (BaseObject* up = op->GetUp(); up; up = up->GetUp())
+  {
+    if (up->GetType() == Ocontainer) return false;
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// Returns \c true if a link in \p bc points to one of \p nodes.
+/// ***************************************************************************
+static Bool LinksInto(const BaseContainer& bc, BaseDocument* doc,
+    std::unordered_set<BaseList2D*> const& nodes)
+{
+  for (LONG i=0; ; i++)
+  {
+    if (bc.GetIndexId(i) == NOTOK) break;
+    const GeData* data = bc.GetIndexData(i);
+    if (!data) continue;
+    switch (data->GetType())
+    {
+      case DA_ALIASLINK:
+      {
+        BaseLink* link = data->GetBaseLink();
+        if (link && nodes.count(link->GetLink(doc))) return true;
+        break;
+      }
+      case DA_CONTAINER:
+      {
+        BaseContainer* sub = data->GetContainer();
+        if (sub && LinksInto(*sub, doc, nodes)) return true;
+        break;
+      }
+      case CUSTOMDATATYPE_INEXCLUDE_LIST:
+      {
+        InExcludeData* list = static_cast<InExcludeData*>(
+            data->GetCustomDataType(CUSTOMDATATYPE_INEXCLUDE_LIST));
+        LONG count = list ? list->GetObjectCount() : 0;
+        for (LONG j=0; j < count; j++)
+        {
+          if (nodes.count(list->ObjectFromIndex(doc, j))) return true;
+        }
+        break;
+      }
+    }
+  }
+  return false;
+}
+
+/// ***************************************************************************
+/// Returns \c true if an object, tag or material outside of the hierarchy
+/// of \p op links to a node inside of it. Such a hierarchy must be saved
+/// as is, the links can not be restored to the clones of the master.
+/// ***************************************************************************
+static Bool IsReferencedFromOutside(BaseDocument* doc, BaseObject* op)
+{
+  std::unordered_set<BaseList2D*> nodes;
+  for (NodeIterator<BaseObject> it(op->GetDown(), op); it; ++it)
+  {
+    nodes.insert(*it);
+    for (BaseTag* tag = it->GetFirstTag(); tag; tag = tag->GetNext())
+      nodes.insert(tag);
+  }
+
+  BaseObject* other = doc->GetFirstObject();
+  while (other)
+  {
+    Bool inside = other == op;
+    if (!inside)
+    {
+      const BaseContainer* bc = other->GetDataInstance();
+      if (bc && LinksInto(*bc, doc, nodes)) return true;
+      for (BaseTag* tag = other->GetFirstTag(); tag; tag = tag->GetNext())
+      {
+        bc = tag->GetDataInstance();
+        if (bc && LinksInto(*bc, doc, nodes)) return true;
+      }
+    }
+    other = GetNextNode<BaseObject>(other, nullptr, !inside);
+  }
+
+  for (BaseMaterial* mat = doc->GetFirstMaterial(); mat; mat = mat->GetNext())
+  {
+    const BaseContainer* bc = mat->GetDataInstance();
+    if (bc && LinksInto(*bc, doc, nodes)) return true;
+  }
+  return false;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+String DedupeFingerprint(BaseObject* op)
+{
+  if (!op) return String();
+  Fingerprint fp(op->GetDocument());
+  fp.AddHierarchy(op);
+
+  // The protection state and the icon of nested containers are members
+  // of their NodeData, not parameters.
+  LONG index = 0;
+  for (NodeIterator<BaseObject> it(op->GetDown(), op); it; ++it, ++index)
+  {
+    if (it->GetType() != Ocontainer) continue;
+    String hash;
+    Bool isProtected = ContainerIsProtected(*it, &hash);
+    fp.AddLong(index);
+    fp.AddLong(isProtected);
+    fp.AddString(hash);
+    fp.AddString(ContainerGetIconHash(*it));
+  }
+  return fp.GetHash();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void DedupeBeginSave(BaseDocument* doc, BaseObject* op, DedupeState& state,
+    String const& iconHash)
+{
+  // A duplicate whose master was missing when it was loaded still only
+  // has the reference, keep it until the children are back.
+  if (state.missing && !op->GetDown()) return;
+  state.missing = false;
+
+  state.key = "";
+  state.ref = "";
+  state.iconHash = "";
+  state.iconShared = false;
+  if (!doc || state.inSession) return;
+  if (!GetPrefBool(PREF_DEDUPE_ON_SAVE)) return;
+  if (!ContainerIsProtected(op) || !op->GetDown() || !IsTopLevelContainer(op))
+    return;
+
+  Bool created = g_sessions.find(doc) == g_sessions.end();
+  DedupeSession& session = g_sessions[doc];
+  session.members.insert(op);
+  state.inSession = true;
+
+  // Wake up the message plugin so it asks for the timer again.
+  if (created) SpecialEventAdd(ID_DEDUPE);
+
+  String hash = DedupeFingerprint(op);
+  std::string key = ToStdString(hash);
+  auto it = session.masters.find(key);
+  if (it == session.masters.end())
+  {
+    session.masters[key] = op;
+    state.key = hash;
+    state.iconHash = iconHash;
+    return;
+  }
+
+  if (IsReferencedFromOutside(doc, op)) return;
+
+  DedupeState* master = ContainerGetDedupeState(it->second);
+  state.ref = hash;
+  state.iconShared = master && !IsEmpty(iconHash) && master->iconHash == iconHash;
+
+  // Detach the children for the duration of the save. They are put
+  // back in the same order in DedupeEndSave().
+  BaseObject* child = op->GetDown();
+  while (child)
+  {
+    BaseObject* next = child->GetNext();
+    child->Remove();
+    state.stash.push_back(child);
+    child = next;
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void DedupeEndSave(BaseDocument* doc, BaseObject* op, DedupeState& state)
+{
+  for (BaseObject* child : state.stash)
+    child->InsertUnderLast(op);
+  state.stash.clear();
+  if (!state.missing)
+  {
+    state.ref = "";
+    state.iconShared = false;
+  }
+
+  if (!state.inSession) return;
+  state.inSession = false;
+  auto it = g_sessions.find(doc);
+  if (it == g_sessions.end()) return;
+  it->second.members.erase(op);
+  if (it->second.members.empty())
+    g_sessions.erase(it);
+}
+
+/// ***************************************************************************
+/// Ends all open save sessions. The document is saved synchronously on
+/// the main thread, so a session that is still open when the timer fires
+/// never got its MSG_DOCUMENTINFO_TYPE_SAVE_AFTER.
+/// ***************************************************************************
+static void EndStaleSessions()
+{
+  std::vector<std::pair<BaseDocument*, BaseObject*>> members;
+  for (auto const& session : g_sessions)
+  {
+    for (BaseObject* op : session.second.members)
+      members.push_back(std::make_pair(session.first, op));
+  }
+  for (auto const& member : members)
+  {
+    DedupeState* state = ContainerGetDedupeState(member.second);
+    if (state) DedupeEndSave(member.first, member.second, *state);
+  }
+  g_sessions.clear();
+}
+
+/// ***************************************************************************
+/// Searches for the master container with the fingerprint \p key in
+/// \p doc. The hierarchies of containers are not searched.
+/// ***************************************************************************
+static BaseObject* FindMaster(BaseDocument* doc, String const& key)
+{
+  BaseObject* op = doc->GetFirstObject();
+  while (op)
+  {
+    Bool isContainer = op->GetType() == Ocontainer;
+    if (isContainer)
+    {
+      // Make sure the master hasn't been changed since its
+      // key was computed.
+      DedupeState* state = ContainerGetDedupeState(op);
+      if (state && state->key == key && DedupeVerify(op, *state))
+        return op;
+    }
+    op = GetNextNode<BaseObject>(op, nullptr, !isContainer);
+  }
+  return nullptr;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool DedupeVerify(BaseObject* op, DedupeState& state)
+{
+  if (IsEmpty(state.key)) return false;
+  ULONG dirty = GetHierarchyDirty(op, DIRTYFLAGS_DATA | DIRTYFLAGS_MATRIX);
+  if (state.verifiedDirty != dirty)
+  {
+    if (DedupeFingerprint(op) != state.key)
+      state.key = "";
+    state.verifiedDirty = dirty;
+  }
+  return !IsEmpty(state.key);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+BaseObject* DedupeExpand(BaseDocument* doc, BaseObject* op, DedupeState& state)
+{
+  if (!doc || IsEmpty(state.ref)) return nullptr;
+
+  // The container was saved with its children after all, keep them.
+  if (op->GetDown())
+  {
+    state.ref = "";
+    state.iconShared = false;
+    return nullptr;
+  }
+
+  BaseObject* master = FindMaster(doc, state.ref);
+  if (!master)
+  {
+    GePrint("Container Object: the master of " + op->GetName() +
+        " is missing, its contents could not be restored");
+    state.missing = true;
+    return nullptr;
+  }
+
+  AutoAlloc<AliasTrans> at;
+  if (!at || !at->Init(doc)) return nullptr;
+  for (BaseObject* child = master->GetDown(); child; child = child->GetNext())
+  {
+    BaseObject* clone = static_cast<BaseObject*>(child->GetClone(COPYFLAGS_0, at));
+    if (clone) clone->InsertUnderLast(op);
+  }
+  at->Translate(true);
+
+  state.ref = "";
+  state.missing = false;
+  return master;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void DedupeFree(BaseObject* op, DedupeState& state)
+{
+  for (BaseObject* child : state.stash)
+    BaseObject::Free(child);
+  state.stash.clear();
+  if (!state.inSession) return;
+  state.inSession = false;
+  for (auto it = g_sessions.begin(); it != g_sessions.end(); )
+  {
+    it->second.members.erase(op);
+    auto& masters = it->second.masters;
+    for (auto m = masters.begin(); m != masters.end(); )
+    {
+      if (m->second == op) m = masters.erase(m);
+      else ++m;
+    }
+    if (it->second.members.empty())
+      it = g_sessions.erase(it);
+    else
+      ++it;
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+class DedupeMessage : public MessageData
+{
+public:
+
+  virtual LONG GetTimer()
+  {
+    return g_sessions.empty() ? 0 : STALE_INTERVAL;
+  }
+
+  virtual Bool CoreMessage(LONG id, const BaseContainer& bc)
+  {
+    if (id == MSG_TIMER && !g_sessions.empty())
+      EndStaleSessions();
+    return true;
+  }
+
+};
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool RegisterDedupe()
+{
+  return RegisterMessagePlugin(
+    ID_DEDUPE,
+    GeLoadString(IDS_DEDUPE),
+    0,
+    gNew(DedupeMessage));
+}
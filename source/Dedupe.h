@@ -0,0 +1,91 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Dedupe.h
+///
+/// Save-time deduplication of identical container payloads. When the
+/// #PREF_DEDUPE_ON_SAVE preference is enabled, protected top-level
+/// containers are fingerprinted before the document is saved. The first
+/// container with a given fingerprint is the master and is saved as usual.
+/// All other containers with the same fingerprint have their children
+/// detached for the duration of the save and only store a reference to the
+/// master. The children are cloned from the master again after loading.
+///
+/// Containers whose hierarchy is linked from outside are never treated as
+/// duplicates, the links would not survive the round trip. If the master
+/// can not be found after loading, the reference is kept so the next save
+/// doesn't lose it.
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+#include <vector>
+
+/// ***************************************************************************
+/// Deduplication state of a single container.
+/// ***************************************************************************
+struct DedupeState
+{
+  String key;                       ///< Fingerprint if this is a master.
+  String ref;                       ///< Fingerprint of the master if this is a duplicate.
+  String iconHash;                  ///< Fingerprint of the icon of a master.
+  Bool iconShared;                  ///< Duplicate has the same icon as the master.
+  std::vector<BaseObject*> stash;   ///< Detached children during the save.
+  Bool inSession;                   ///< Registered in a save session.
+  Bool missing;                     ///< The master of #ref wasn't found after loading.
+  ULONG verifiedDirty;              ///< Hierarchy dirty count when #key was last verified.
+
+  DedupeState() : iconShared(false), inSession(false), missing(false), verifiedDirty(0) { }
+};
+
+/// ***************************************************************************
+/// Returns the deduplication key of the hierarchy below \p op. Other than
+/// #FingerprintHierarchy(), it also covers the protection state and icons
+/// of nested containers which are not stored in their parameters.
+/// ***************************************************************************
+String DedupeFingerprint(BaseObject* op);
+
+/// ***************************************************************************
+/// Called for MSG_DOCUMENTINFO_TYPE_SAVE_BEFORE. Registers the container
+/// \p op with the save session of \p doc and detaches its children if it
+/// is a duplicate of another container. The duplicate shares the icon of
+/// the master if \p iconHash, the fingerprint of its icon, is the same.
+/// ***************************************************************************
+void DedupeBeginSave(BaseDocument* doc, BaseObject* op, DedupeState& state,
+    String const& iconHash);
+
+/// ***************************************************************************
+/// Called for MSG_DOCUMENTINFO_TYPE_SAVE_AFTER. Restores the children
+/// detached by #DedupeBeginSave(). Sessions that never see the message,
+/// eg. because the save was aborted, are ended by a timer.
+/// ***************************************************************************
+void DedupeEndSave(BaseDocument* doc, BaseObject* op, DedupeState& state);
+
+/// ***************************************************************************
+/// Called after the document was loaded or merged. If the container \p op
+/// references a master, the children of the master are cloned into \p op
+/// and the master is returned. If the master is missing, the failure is
+/// reported and \p op keeps its reference.
+/// ***************************************************************************
+BaseObject* DedupeExpand(BaseDocument* doc, BaseObject* op, DedupeState& state);
+
+/// ***************************************************************************
+/// Checks that the key of the master container \p op still matches its
+/// hierarchy if the hierarchy changed since it was last verified, and
+/// clears the key otherwise. Returns \c true if \p op has a valid key.
+/// ***************************************************************************
+Bool DedupeVerify(BaseObject* op, DedupeState& state);
+
+/// ***************************************************************************
+/// Removes \p op from its save session and frees stashed children, eg.
+/// when the container is freed during a save.
+/// ***************************************************************************
+void DedupeFree(BaseObject* op, DedupeState& state);
+
+/// ***************************************************************************
+/// Registers the message plugin that ends stale save sessions.
+/// ***************************************************************************
+Bool RegisterDedupe();
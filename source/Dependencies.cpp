@@ -0,0 +1,211 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Dependencies.cpp
+
+#include "Dependencies.h"
+#include "Utils/Misc.h"
+#include "Utils/ScratchArena.h"
+#include "Utils/Stats.h"
+#include <customgui_inexclude.h>
+#include <algorithm>
+#include <unordered_set>
+
+/// ***************************************************************************
+/// Collects all links and filenames from \p bc and its sub-containers.
+/// ***************************************************************************
+static void CollectEdges(const BaseContainer& bc, BaseDocument* doc,
+    std::vector<BaseLink*>& links, std::vector<Filename>& files)
+{
+  for (LONG i=0; ; i++)
+  {
+    if (bc.GetIndexId(i) == NOTOK) break;
+    const GeData* data = bc.GetIndexData(i);
+    if (!data) continue;
+
+    BaseList2D* target = nullptr;
+    switch (data->GetType())
+    {
+      case DA_ALIASLINK:
+        target = data->GetLink(doc);
+        if (target)
+        {
+          BaseLink* link = BaseLink::Alloc();
+          if (link)
+          {
+            link->SetLink(target);
+            links.push_back(link);
+          }
+        }
+        break;
+      case DA_FILENAME:
+      {
+        Filename flname = data->GetFilename();
+        if (flname.Content()) files.push_back(flname);
+        break;
+      }
+      case DA_CONTAINER:
+      {
+        BaseContainer* sub = data->GetContainer();
+        if (sub) CollectEdges(*sub, doc, links, files);
+        break;
+      }
+      case CUSTOMDATATYPE_INEXCLUDE_LIST:
+      {
+        InExcludeData* list = static_cast<InExcludeData*>(
+          data->GetCustomDataType(CUSTOMDATATYPE_INEXCLUDE_LIST));
+        if (!list) break;
+        LONG count = list->GetObjectCount();
+        for (LONG j=0; j < count; j++)
+        {
+          target = list->ObjectFromIndex(doc, j);
+          if (!target) continue;
+          BaseLink* link = BaseLink::Alloc();
+          if (link)
+          {
+            link->SetLink(target);
+            links.push_back(link);
+          }
+        }
+        break;
+      }
+    }
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void DependencyCache::FreeEntry(Entry& entry)
+{
+  for (BaseLink* link : entry.links)
+    BaseLink::Free(link);
+  entry.links.clear();
+  entry.files.clear();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void DependencyCache::Flush()
+{
+  for (auto& pair : m_entries)
+    FreeEntry(pair.second);
+  m_entries.clear();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+DependencyCache::Entry& DependencyCache::GetEntry(BaseList2D* node)
+{
+  auto result = m_entries.emplace(node, Entry());
+  Entry& entry = result.first->second;
+  ULONG dirty = node->GetDirty(DIRTYFLAGS_DATA);
+  std::string marker = GetMarkerKey(node);
+  if (result.second || entry.type != node->GetType() || entry.dirty != dirty ||
+      entry.marker != marker)
+  {
+    FreeEntry(entry);
+    const BaseContainer* bc = node->GetDataInstance();
+    if (bc) CollectEdges(*bc, node->GetDocument(), entry.links, entry.files);
+    entry.dirty = dirty;
+    entry.type = node->GetType();
+    entry.marker = std::move(marker);
+    StatIncrement(STATCOUNTER_DEPENDENCY_MISSES);
+  }
+  else
+    StatIncrement(STATCOUNTER_DEPENDENCY_HITS);
+  entry.visit = m_visit;
+  return entry;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool DependencyCache::Collect(BaseObject* op, ContainerDependencies& out)
+{
+  out.Flush();
+  if (!op) return false;
+  BaseDocument* doc = op->GetDocument();
+  m_visit++;
+
+  // Nodes on the stack are paired with a flag whether they are inside
+  // of the container hierarchy. Only outside nodes are dependencies.
+  struct Item { BaseList2D* node; Bool inside; };
+  ScratchScope scope;
+  ScratchVector<Item> stack(scope, 256);
+  std::unordered_set<BaseList2D*> visited;
+  visited.insert(op);
+
+  for (NodeIterator<BaseObject> it(op->GetDown(), op); it; ++it)
+  {
+    visited.insert(*it);
+    stack.PushBack(Item{*it, true});
+    for (BaseTag* tag = it->GetFirstTag(); tag; tag = tag->GetNext())
+    {
+      visited.insert(tag);
+      stack.PushBack(Item{tag, true});
+    }
+  }
+
+  while (!stack.IsEmpty())
+  {
+    Item item = stack.PopBack();
+    BaseList2D* node = item.node;
+    Bool inside = item.inside;
+
+    Entry& entry = GetEntry(node);
+    for (Filename const& flname : entry.files)
+    {
+      if (std::find(out.files.begin(), out.files.end(), flname) == out.files.end())
+        out.files.push_back(flname);
+    }
+
+    // Shaders are owned by the node, they are inside of the hierarchy
+    // if the node is.
+    for (NodeIterator<BaseShader> it(node->GetFirstShader()); it; ++it)
+    {
+      if (!visited.insert(*it).second) continue;
+      stack.PushBack(Item{*it, inside});
+      if (!inside) out.shaders.push_back(*it);
+    }
+
+    for (BaseLink* link : entry.links)
+    {
+      BaseList2D* target = link->GetLink(doc);
+      if (!target || !visited.insert(target).second) continue;
+      stack.PushBack(Item{target, false});
+
+      if (target->IsInstanceOf(Obase))
+      {
+        BaseObject* obj = static_cast<BaseObject*>(target);
+        out.objects.push_back(obj);
+        // The tags of linked objects may link to further nodes.
+        for (BaseTag* tag = obj->GetFirstTag(); tag; tag = tag->GetNext())
+        {
+          if (visited.insert(tag).second)
+            stack.PushBack(Item{tag, false});
+        }
+      }
+      else if (target->IsInstanceOf(Mbase))
+        out.materials.push_back(static_cast<BaseMaterial*>(target));
+      else if (target->IsInstanceOf(Xbase))
+        out.shaders.push_back(static_cast<BaseShader*>(target));
+      else
+        out.others.push_back(target);
+    }
+  }
+
+  // Drop the entries of nodes that are no longer reachable, their
+  // pointers may not be valid anymore.
+  for (auto it = m_entries.begin(); it != m_entries.end(); )
+  {
+    if (it->second.visit != m_visit)
+    {
+      FreeEntry(it->second);
+      it = m_entries.erase(it);
+    }
+    else
+      ++it;
+  }
+  return true;
+}
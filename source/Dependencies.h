@@ -0,0 +1,78 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Dependencies.h
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// ***************************************************************************
+/// The nodes outside of a container's hierarchy that it depends on through
+/// links, and the files referenced by the hierarchy and these nodes.
+/// ***************************************************************************
+struct ContainerDependencies
+{
+  std::vector<BaseObject*> objects;
+  std::vector<BaseMaterial*> materials;
+  std::vector<BaseShader*> shaders;
+  std::vector<BaseList2D*> others;
+  std::vector<Filename> files;
+
+  void Flush()
+  {
+    objects.clear();
+    materials.clear();
+    shaders.clear();
+    others.clear();
+    files.clear();
+  }
+};
+
+/// ***************************************************************************
+/// Caches the outgoing edges of nodes: the nodes they link to, the nodes
+/// they own (tags, shaders) and the files they reference. The edges of a
+/// node are only collected again when its data dirty count changed.
+/// Entries also store the marker of their node, so a node that is
+/// allocated at the address of a freed one doesn't get its edges.
+/// Entries of nodes that were not visited by the last query are dropped.
+/// ***************************************************************************
+class DependencyCache
+{
+  struct Entry
+  {
+    ULONG dirty;
+    LONG type;
+    LONG visit;
+    std::string marker;
+    std::vector<BaseLink*> links;
+    std::vector<Filename> files;
+  };
+
+  std::unordered_map<BaseList2D*, Entry> m_entries;
+  LONG m_visit;
+
+  DependencyCache(DependencyCache const&);
+  DependencyCache& operator = (DependencyCache const&);
+
+  Entry& GetEntry(BaseList2D* node);
+  static void FreeEntry(Entry& entry);
+
+public:
+
+  DependencyCache() : m_visit(0) { }
+  ~DependencyCache() { Flush(); }
+
+  /// Removes all cached edges.
+  void Flush();
+
+  /// Computes the dependency closure of the hierarchy of \p op in one
+  /// pass, reusing the cached edges of unchanged nodes.
+  Bool Collect(BaseObject* op, ContainerDependencies& out);
+};
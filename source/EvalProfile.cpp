@@ -0,0 +1,305 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file EvalProfile.cpp
+
+#include "EvalProfile.h"
+#include "Preferences.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+/// Number of containers listed in the evaluation report.
+static const LONG REPORT_LIMIT = 20;
+
+static const LONG g_phasePriority[EVALPHASE_MARKED] = {
+  EXECUTIONPRIORITY_ANIMATION,
+  EXECUTIONPRIORITY_EXPRESSION,
+  EXECUTIONPRIORITY_GENERATOR,
+};
+
+static const char* const g_phaseNames[EVALPHASE_COUNT] = {
+  "animation",
+  "expressions",
+  "generator priority",
+  "caches",
+};
+
+/// ***************************************************************************
+/// The measurements of one container, in milliseconds.
+/// ***************************************************************************
+struct ProfileEntry
+{
+  Real total[EVALPHASE_COUNT];
+  Real last[EVALPHASE_COUNT];
+  LLONG passes;
+
+  ProfileEntry() : passes(0)
+  {
+    for (LONG i=0; i < EVALPHASE_COUNT; i++)
+      total[i] = last[i] = 0.0;
+  }
+
+  Real GetAverage() const
+  {
+    Real sum = 0.0;
+    for (LONG i=0; i < EVALPHASE_COUNT; i++)
+      sum += total[i];
+    return passes > 0 ? sum / (Real) passes : 0.0;
+  }
+};
+
+/// ***************************************************************************
+/// The container whose interval is open in each pass of a document.
+/// ***************************************************************************
+struct DocumentState
+{
+  BaseObject* open[EVALPHASE_MARKED];
+  Clock::time_point start[EVALPHASE_MARKED];
+
+  DocumentState()
+  {
+    for (LONG i=0; i < EVALPHASE_MARKED; i++)
+      open[i] = nullptr;
+  }
+};
+
+// Documents are executed from render threads, too.
+static std::mutex g_lock;
+static std::unordered_map<BaseObject*, ProfileEntry> g_entries;
+static std::unordered_map<BaseDocument*, DocumentState> g_documents;
+
+// The preference, so that evaluations don't look it up.
+static std::atomic<bool> g_enabled(false);
+
+/// ***************************************************************************
+/// Attributes the time since the open interval of \p phase started to
+/// its container. Must be called with #g_lock held.
+/// ***************************************************************************
+static void CloseInterval(DocumentState& state, LONG phase, Clock::time_point now)
+{
+  if (!state.open[phase]) return;
+  Real ms = std::chrono::duration<Real, std::milli>(now - state.start[phase]).count();
+  ProfileEntry& entry = g_entries[state.open[phase]];
+  entry.total[phase] += ms;
+  entry.last[phase] += ms;
+  state.open[phase] = nullptr;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void EvalProfileUpdate()
+{
+  Bool enabled = GetPrefBool(PREF_PROFILE_EVALUATION);
+  if (enabled == (Bool) g_enabled) return;
+  g_enabled = enabled;
+
+  // The containers change their info, the priority list is built again.
+  EventAdd();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool EvalProfileIsEnabled()
+{
+  return g_enabled;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool EvalProfileAddToExecution(BaseObject* op, PriorityList* list)
+{
+  if (!op || !list || !g_enabled)
+    return false;
+  for (LONG i=0; i < EVALPHASE_MARKED; i++)
+  {
+    list->Add(op, g_phasePriority[i], EXECUTIONFLAGS_0);
+    list->Add(op, g_phasePriority[i] + 1, EXECUTIONFLAGS_0);
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void EvalProfileExecute(BaseObject* op, BaseDocument* doc, LONG priority)
+{
+  // The priority list may still hold marks added before profiling was
+  // disabled.
+  if (!op || !doc || !g_enabled) return;
+  Clock::time_point now = Clock::now();
+  std::lock_guard<std::mutex> lock(g_lock);
+  DocumentState& state = g_documents[doc];
+
+  for (LONG i=0; i < EVALPHASE_MARKED; i++)
+  {
+    if (priority == g_phasePriority[i])
+    {
+      CloseInterval(state, i, now);
+      state.open[i] = op;
+      state.start[i] = now;
+      if (i == 0)
+      {
+        // The first pass starts a new evaluation.
+        ProfileEntry& entry = g_entries[op];
+        entry.passes++;
+        for (LONG j=0; j < EVALPHASE_COUNT; j++)
+          entry.last[j] = 0.0;
+      }
+      break;
+    }
+    else if (priority == g_phasePriority[i] + 1)
+    {
+      CloseInterval(state, i, now);
+      break;
+    }
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void EvalProfileExecutePasses(BaseObject* op, BaseDocument* doc)
+{
+  if (!op || !doc || !g_enabled)
+  {
+    if (doc) doc->ExecutePasses(nullptr, true, true, true, BUILDFLAGS_0);
+    return;
+  }
+
+  // The marks of the container are hit during the passes, their time is
+  // not part of the caches.
+  Real marked = 0.0;
+  {
+    std::lock_guard<std::mutex> lock(g_lock);
+    ProfileEntry const& entry = g_entries[op];
+    for (LONG i=0; i < EVALPHASE_MARKED; i++)
+      marked -= entry.total[i];
+  }
+
+  Clock::time_point start = Clock::now();
+  doc->ExecutePasses(nullptr, true, true, true, BUILDFLAGS_0);
+  Real ms = std::chrono::duration<Real, std::milli>(Clock::now() - start).count();
+
+  std::lock_guard<std::mutex> lock(g_lock);
+  ProfileEntry& entry = g_entries[op];
+  for (LONG i=0; i < EVALPHASE_MARKED; i++)
+    marked += entry.total[i];
+  ms = std::max<Real>(ms - marked, 0.0);
+  entry.total[EVALPHASE_CACHE] += ms;
+  entry.last[EVALPHASE_CACHE] += ms;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void EvalProfileAddCacheTime(BaseObject* op, Real ms)
+{
+  if (!op) return;
+  std::lock_guard<std::mutex> lock(g_lock);
+  ProfileEntry& entry = g_entries[op];
+  entry.total[EVALPHASE_CACHE] += ms;
+  entry.last[EVALPHASE_CACHE] += ms;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+uint64_t EvalProfileNow()
+{
+  return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+    Clock::now().time_since_epoch()).count();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+EvalProfileCacheScope::EvalProfileCacheScope(BaseObject* op)
+  : m_op(op), m_start(0), m_active(op && g_enabled)
+{
+  if (m_active) m_start = EvalProfileNow();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void EvalProfileForget(BaseObject* op)
+{
+  std::lock_guard<std::mutex> lock(g_lock);
+  g_entries.erase(op);
+  for (auto it = g_documents.begin(); it != g_documents.end(); )
+  {
+    Bool empty = true;
+    for (LONG i=0; i < EVALPHASE_MARKED; i++)
+    {
+      if (it->second.open[i] == op) it->second.open[i] = nullptr;
+      if (it->second.open[i]) empty = false;
+    }
+    // Also drops the states of documents that are gone.
+    if (empty)
+      it = g_documents.erase(it);
+    else
+      ++it;
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+static String FormatMs(Real ms)
+{
+  return RealToString(ms, -1, 2) + " ms";
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+String EvalProfileGetSummary(BaseObject* op)
+{
+  std::lock_guard<std::mutex> lock(g_lock);
+  auto it = g_entries.find(op);
+  if (it == g_entries.end() || it->second.passes <= 0)
+    return String();
+  Real last = 0.0;
+  for (LONG i=0; i < EVALPHASE_COUNT; i++)
+    last += it->second.last[i];
+  return "Evaluation: " + FormatMs(it->second.GetAverage()) + " average, " +
+    FormatMs(last) + " last pass";
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+String GetEvaluationReport()
+{
+  std::lock_guard<std::mutex> lock(g_lock);
+  String report = "Container Evaluation Time (average per pass)\n";
+
+  std::vector<std::pair<BaseObject*, ProfileEntry const*>> entries;
+  for (auto const& pair : g_entries)
+  {
+    if (pair.second.passes > 0)
+      entries.push_back(std::make_pair(pair.first, &pair.second));
+  }
+  if (entries.empty())
+    return report + "  Nothing measured, enable profiling in the Container Preferences\n";
+
+  std::sort(entries.begin(), entries.end(), [](
+      std::pair<BaseObject*, ProfileEntry const*> const& a,
+      std::pair<BaseObject*, ProfileEntry const*> const& b) {
+    return a.second->GetAverage() > b.second->GetAverage();
+  });
+  if ((LONG) entries.size() > REPORT_LIMIT)
+    entries.resize(REPORT_LIMIT);
+
+  for (auto const& pair : entries)
+  {
+    ProfileEntry const& entry = *pair.second;
+    report += "  " + pair.first->GetName() + ": " + FormatMs(entry.GetAverage()) + " (";
+    for (LONG i=0; i < EVALPHASE_COUNT; i++)
+    {
+      if (i != 0) report += ", ";
+      report += String(g_phaseNames[i]) + " " + FormatMs(entry.total[i] / (Real) entry.passes);
+    }
+    report += ")\n";
+  }
+  return report;
+}
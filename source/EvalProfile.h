@@ -0,0 +1,123 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file EvalProfile.h
+///
+/// Attributes the evaluation time of a document to its containers. Every
+/// container adds itself to the priority list at the default priority of
+/// each pass and once more right after it. Nodes of the same priority are
+/// executed in hierarchy order, so the time between the mark of one
+/// container and the next mark is spent in the subtree of the first.
+/// Nodes that follow a container in the hierarchy without being inside
+/// of it, and nodes with a custom priority, are not attributed correctly.
+///
+/// Caches are built after the priority list, so they are timed directly:
+/// the cache of the container itself with an #EvalProfileCacheScope, and
+/// the evaluations the plugin runs on behalf of a container (recording
+/// and exporting caches) with #EvalProfileExecutePasses().
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+#include <cstdint>
+
+/// ***************************************************************************
+/// The passes of the scene evaluation that are measured.
+/// ***************************************************************************
+enum EVALPHASE
+{
+  EVALPHASE_ANIMATION,          ///< Tracks
+  EVALPHASE_EXPRESSION,         ///< Tags
+  EVALPHASE_GENERATORPRIORITY,  ///< Tags at generator priority
+  EVALPHASE_CACHE,              ///< Cache builds, timed directly
+
+  EVALPHASE_COUNT,
+  EVALPHASE_MARKED = EVALPHASE_CACHE  ///< Number of passes timed with marks
+};
+
+/// ***************************************************************************
+/// Reads the profiling preference again. Called when the plugin starts
+/// and from the preferences dialog, evaluations only read the result.
+/// ***************************************************************************
+void EvalProfileUpdate();
+
+/// ***************************************************************************
+/// Returns \c true if profiling is enabled in the preferences. Containers
+/// only ask for AddToExecution() while it is.
+/// ***************************************************************************
+Bool EvalProfileIsEnabled();
+
+/// ***************************************************************************
+/// Called from AddToExecution() of the container \p op. Adds the marks of
+/// the container to \p list if profiling is enabled in the preferences
+/// and returns \c true in that case.
+/// ***************************************************************************
+Bool EvalProfileAddToExecution(BaseObject* op, PriorityList* list);
+
+/// ***************************************************************************
+/// Called from Execute() of the container \p op with the \p priority of
+/// the mark that is being executed. Does nothing if profiling is disabled.
+/// ***************************************************************************
+void EvalProfileExecute(BaseObject* op, BaseDocument* doc, LONG priority);
+
+/// ***************************************************************************
+/// Runs all passes of \p doc on behalf of the container \p op. The time
+/// that is not spent between the marks of \p op is added to its
+/// #EVALPHASE_CACHE, which includes the caches of everything else in the
+/// document.
+/// ***************************************************************************
+void EvalProfileExecutePasses(BaseObject* op, BaseDocument* doc);
+
+/// ***************************************************************************
+/// Adds \p ms milliseconds to the #EVALPHASE_CACHE of \p op.
+/// ***************************************************************************
+void EvalProfileAddCacheTime(BaseObject* op, Real ms);
+
+/// ***************************************************************************
+/// Returns the current time in nanoseconds, for #EvalProfileCacheScope.
+/// ***************************************************************************
+uint64_t EvalProfileNow();
+
+/// ***************************************************************************
+/// Adds the lifetime of the scope to the #EVALPHASE_CACHE of a container
+/// if profiling is enabled.
+/// ***************************************************************************
+class EvalProfileCacheScope
+{
+  BaseObject* m_op;
+  uint64_t m_start;
+  bool m_active;
+
+  EvalProfileCacheScope(EvalProfileCacheScope const&);
+  EvalProfileCacheScope& operator = (EvalProfileCacheScope const&);
+
+public:
+
+  EvalProfileCacheScope(BaseObject* op);
+
+  ~EvalProfileCacheScope()
+  {
+    if (m_active)
+      EvalProfileAddCacheTime(m_op, (Real) (EvalProfileNow() - m_start) / 1000000.0);
+  }
+};
+
+/// ***************************************************************************
+/// Drops the measurements of \p op. Called when the container is freed.
+/// ***************************************************************************
+void EvalProfileForget(BaseObject* op);
+
+/// ***************************************************************************
+/// Returns a single line with the average time per pass of \p op, or an
+/// empty string if it was not measured.
+/// ***************************************************************************
+String EvalProfileGetSummary(BaseObject* op);
+
+/// ***************************************************************************
+/// Returns a multi-line report of the measured containers, the slowest
+/// first.
+/// ***************************************************************************
+String GetEvaluationReport();
@@ -0,0 +1,198 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file IconCache.cpp
+
+#include "IconCache.h"
+#include "IconStorage.h"
+#include "Preferences.h"
+#include "Utils/Sha256.h"
+#include "Utils/Stats.h"
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+/// ***************************************************************************
+/// A decoded bitmap in the cache.
+/// ***************************************************************************
+struct IconCacheEntry
+{
+  ULONG id;
+  BaseBitmap* bmp;
+  size_t bytes;
+};
+
+// Icons are requested from the main thread, but render documents copy
+// and free containers from other threads.
+static std::mutex g_lock;
+static std::list<IconCacheEntry> g_lru;   ///< Most recently used first.
+static std::unordered_map<ULONG, std::list<IconCacheEntry>::iterator> g_lookup;
+static size_t g_bytes = 0;
+static size_t g_budget = 0;
+static Bool g_budgetRead = false;
+static std::atomic<ULONG> g_nextId(1);
+
+/// ***************************************************************************
+/// Frees the least recently used bitmaps until the cache fits into the
+/// budget. The most recently used bitmap is always kept, it may still be
+/// in use by the caller. Must be called with #g_lock held.
+/// ***************************************************************************
+static void Trim()
+{
+  if (!g_budgetRead)
+  {
+    g_budget = (size_t) GetPrefLong(PREF_ICON_CACHE_BUDGET) * 1024 * 1024;
+    g_budgetRead = true;
+  }
+  while (g_bytes > g_budget && g_lru.size() > 1)
+  {
+    IconCacheEntry& entry = g_lru.back();
+    g_bytes -= entry.bytes;
+    g_lookup.erase(entry.id);
+    BaseBitmap::Free(entry.bmp);
+    g_lru.pop_back();
+  }
+}
+
+/// ***************************************************************************
+/// Removes the bitmap with the key \p id. Must be called with #g_lock held.
+/// ***************************************************************************
+static void Evict(ULONG id)
+{
+  auto it = g_lookup.find(id);
+  if (it == g_lookup.end()) return;
+  g_bytes -= it->second->bytes;
+  BaseBitmap::Free(it->second->bmp);
+  g_lru.erase(it->second);
+  g_lookup.erase(it);
+}
+
+/// ***************************************************************************
+/// Returns the decoded bitmap for \p id, decoding \p data if it is not in
+/// the cache. Must be called with #g_lock held, the bitmap is only valid
+/// until the lock is released.
+/// ***************************************************************************
+static BaseBitmap* Acquire(ULONG id, std::vector<uint8_t> const& data)
+{
+  auto it = g_lookup.find(id);
+  if (it != g_lookup.end())
+  {
+    g_lru.splice(g_lru.begin(), g_lru, it->second);
+    StatIncrement(STATCOUNTER_ICON_HITS);
+    return g_lru.front().bmp;
+  }
+
+  StatIncrement(STATCOUNTER_ICON_MISSES);
+  BaseBitmap* bmp = DecodeCompactIcon(data.data(), data.size());
+  if (!bmp) return nullptr;
+
+  IconCacheEntry entry;
+  entry.id = id;
+  entry.bmp = bmp;
+  entry.bytes = (size_t) bmp->GetBw() * bmp->GetBh() * 4;
+  g_lru.push_front(entry);
+  g_lookup[id] = g_lru.begin();
+  g_bytes += entry.bytes;
+  Trim();
+  return bmp;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void CachedIcon::Flush()
+{
+  if (m_id)
+  {
+    std::lock_guard<std::mutex> lock(g_lock);
+    Evict(m_id);
+  }
+  m_data.clear();
+  m_id = 0;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool CachedIcon::Set(BaseBitmap* bmp)
+{
+  Flush();
+  if (!bmp || !EncodeCompactIcon(bmp, m_data))
+  {
+    m_data.clear();
+    return false;
+  }
+  m_id = g_nextId++;
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void CachedIcon::SetEncoded(std::vector<uint8_t>& data)
+{
+  Flush();
+  m_data.swap(data);
+  data.clear();
+  if (!m_data.empty())
+    m_id = g_nextId++;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void CachedIcon::CopyTo(CachedIcon& dest) const
+{
+  std::vector<uint8_t> data(m_data);
+  dest.SetEncoded(data);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+String CachedIcon::GetHash() const
+{
+  if (m_data.empty()) return String();
+  Sha256Hasher sha;
+  sha.Add(m_data.data(), m_data.size());
+  return String(sha.GetHash().c_str());
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+BaseBitmap* CachedIcon::GetClone()
+{
+  if (m_data.empty()) return nullptr;
+  std::lock_guard<std::mutex> lock(g_lock);
+  BaseBitmap* bmp = Acquire(m_id, m_data);
+  return bmp ? bmp->GetClone() : nullptr;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool CachedIcon::CopyPixelsTo(BaseBitmap* dest)
+{
+  if (m_data.empty() || !dest) return false;
+  std::lock_guard<std::mutex> lock(g_lock);
+  BaseBitmap* bmp = Acquire(m_id, m_data);
+  return bmp && bmp->CopyTo(dest);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void IconCacheUpdateBudget()
+{
+  std::lock_guard<std::mutex> lock(g_lock);
+  g_budgetRead = false;
+  Trim();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void IconCacheFlush()
+{
+  std::lock_guard<std::mutex> lock(g_lock);
+  for (IconCacheEntry& entry : g_lru)
+    BaseBitmap::Free(entry.bmp);
+  g_lru.clear();
+  g_lookup.clear();
+  g_bytes = 0;
+}
@@ -0,0 +1,72 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file IconCache.h
+///
+/// Container icons are kept in the compact icon format. Decoded bitmaps
+/// are held in a process-wide least-recently-used cache whose size is
+/// limited by the #PREF_ICON_CACHE_BUDGET preference, and are decoded
+/// again when they were evicted.
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+#include <cstdint>
+#include <vector>
+
+/// ***************************************************************************
+/// The icon of a container, stored as encoded bytes.
+/// ***************************************************************************
+class CachedIcon
+{
+  std::vector<uint8_t> m_data;
+  ULONG m_id;   ///< Key of the decoded bitmap in the cache, new for every change.
+
+  CachedIcon(CachedIcon const&);
+  CachedIcon& operator = (CachedIcon const&);
+
+public:
+
+  CachedIcon() : m_id(0) { }
+  ~CachedIcon() { Flush(); }
+
+  Bool IsEmpty() const { return m_data.empty(); }
+
+  /// Removes the icon.
+  void Flush();
+
+  /// Encodes \p bmp as the icon. Removes the icon if that fails.
+  Bool Set(BaseBitmap* bmp);
+
+  /// Takes the already encoded icon \p data, leaving \p data empty.
+  void SetEncoded(std::vector<uint8_t>& data);
+
+  std::vector<uint8_t> const& GetEncoded() const { return m_data; }
+
+  /// Copies the icon to \p dest without decoding it.
+  void CopyTo(CachedIcon& dest) const;
+
+  /// Returns the fingerprint of the encoded icon.
+  String GetHash() const;
+
+  /// Returns a copy of the decoded icon, or \c nullptr if it can not be
+  /// decoded. The caller owns the bitmap.
+  BaseBitmap* GetClone();
+
+  /// Copies the decoded icon into the existing bitmap \p bmp.
+  Bool CopyPixelsTo(BaseBitmap* bmp);
+};
+
+/// ***************************************************************************
+/// Reads the byte budget from the preferences again and evicts bitmaps
+/// until the cache fits into it.
+/// ***************************************************************************
+void IconCacheUpdateBudget();
+
+/// ***************************************************************************
+/// Frees all decoded bitmaps.
+/// ***************************************************************************
+void IconCacheFlush();
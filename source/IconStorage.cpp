@@ -0,0 +1,126 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file IconStorage.cpp
+
+#include "IconStorage.h"
+#include "ContainerObject.h"
+#include "Utils/IconCodec.h"
+
+static_assert(CONTAINEROBJECT_ICONSIZE == ICON_MAXSIZE, "container icons must fit the icon codec");
+
+/// ***************************************************************************
+/// Copies the pixels of \p bmp into \p pixels, with an alpha channel if
+/// the bitmap has one.
+/// ***************************************************************************
+static void BitmapToPixels(BaseBitmap* bmp, std::vector<uint8_t>& pixels, uint32_t& channels)
+{
+  LONG w = bmp->GetBw();
+  LONG h = bmp->GetBh();
+  BaseBitmap* alpha = bmp->GetInternalChannel();
+  channels = alpha ? 4 : 3;
+  pixels.resize((size_t) w * h * channels);
+
+  std::vector<UCHAR> line((size_t) w * 3);
+  for (LONG y=0; y < h; y++)
+  {
+    bmp->GetPixelCnt(0, y, w, line.data(), 3, COLORMODE_RGB, PIXELCNT_0);
+    uint8_t* row = pixels.data() + (size_t) y * w * channels;
+    for (LONG x=0; x < w; x++)
+    {
+      uint8_t* pixel = row + (size_t) x * channels;
+      pixel[0] = line[x * 3 + 0];
+      pixel[1] = line[x * 3 + 1];
+      pixel[2] = line[x * 3 + 2];
+      if (alpha)
+      {
+        UWORD value;
+        bmp->GetAlphaPixel(alpha, x, y, &value);
+        pixel[3] = (uint8_t) value;
+      }
+    }
+  }
+}
+
+/// ***************************************************************************
+/// Initializes \p bmp with \p pixels.
+/// ***************************************************************************
+static Bool PixelsToBitmap(std::vector<uint8_t> const& pixels, LONG w, LONG h,
+    uint32_t channels, BaseBitmap* bmp)
+{
+  if (channels != 3 && channels != 4) return false;
+  if (bmp->Init(w, h, 24) != IMAGERESULT_OK) return false;
+  BaseBitmap* alpha = nullptr;
+  if (channels == 4)
+  {
+    alpha = bmp->AddChannel(true, false);
+    if (!alpha) return false;
+  }
+
+  std::vector<UCHAR> line((size_t) w * 3);
+  for (LONG y=0; y < h; y++)
+  {
+    const uint8_t* row = pixels.data() + (size_t) y * w * channels;
+    for (LONG x=0; x < w; x++)
+    {
+      const uint8_t* pixel = row + (size_t) x * channels;
+      line[x * 3 + 0] = pixel[0];
+      line[x * 3 + 1] = pixel[1];
+      line[x * 3 + 2] = pixel[2];
+      if (alpha)
+        bmp->SetAlphaPixel(alpha, x, y, pixel[3]);
+    }
+    bmp->SetPixelCnt(0, y, w, line.data(), 3, COLORMODE_RGB, PIXELCNT_0);
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool EncodeCompactIcon(BaseBitmap* bmp, std::vector<uint8_t>& data)
+{
+  std::vector<uint8_t> pixels;
+  uint32_t channels;
+  BitmapToPixels(bmp, pixels, channels);
+  data.clear();
+  return IconEncode(pixels.data(), bmp->GetBw(), bmp->GetBh(), channels, data);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+BaseBitmap* DecodeCompactIcon(const uint8_t* data, size_t size)
+{
+  std::vector<uint8_t> pixels;
+  uint32_t w, h, channels;
+  if (!data || !IconDecode(data, size, pixels, w, h, channels))
+    return nullptr;
+  BaseBitmap* bmp = BaseBitmap::Alloc();
+  if (bmp && !PixelsToBitmap(pixels, (LONG) w, (LONG) h, channels, bmp))
+    BaseBitmap::Free(bmp);
+  return bmp;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool WriteCompactIcon(HyperFile* hf, std::vector<uint8_t> const& data)
+{
+  return hf->WriteMemory(data.data(), (VLONG) data.size());
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool ReadCompactIcon(HyperFile* hf, std::vector<uint8_t>& data)
+{
+  void* mem = nullptr;
+  VLONG size = 0;
+  if (!hf->ReadMemory(&mem, &size)) return false;
+  const uint8_t* bytes = static_cast<const uint8_t*>(mem);
+  if (bytes)
+    data.assign(bytes, bytes + size);
+  else
+    data.clear();
+  DeleteMem(mem);
+  return true;
+}
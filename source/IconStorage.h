@@ -0,0 +1,38 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file IconStorage.h
+///
+/// Stores container icons in a HyperFile with the codec in Utils/IconCodec.h
+/// instead of PNG.
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+#include <cstdint>
+#include <vector>
+
+/// ***************************************************************************
+/// Encodes \p bmp in the compact icon format into \p data.
+/// ***************************************************************************
+Bool EncodeCompactIcon(BaseBitmap* bmp, std::vector<uint8_t>& data);
+
+/// ***************************************************************************
+/// Decodes an icon encoded with EncodeCompactIcon(). Returns \c nullptr
+/// if the data is not a valid icon.
+/// ***************************************************************************
+BaseBitmap* DecodeCompactIcon(const uint8_t* data, size_t size);
+
+/// ***************************************************************************
+/// Writes the encoded icon \p data to \p hf.
+/// ***************************************************************************
+Bool WriteCompactIcon(HyperFile* hf, std::vector<uint8_t> const& data);
+
+/// ***************************************************************************
+/// Reads an icon written with WriteCompactIcon() into \p data without
+/// decoding it. Returns \c false if reading from \p hf failed.
+/// ***************************************************************************
+Bool ReadCompactIcon(HyperFile* hf, std::vector<uint8_t>& data);
@@ -0,0 +1,165 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Instancing.cpp
+
+#include "Instancing.h"
+#include "Utils/Fingerprint.h"
+#include "Utils/Misc.h"
+#include <Ocontainer.h>
+#include <unordered_map>
+#include <vector>
+
+static const LONG PARK_EDITORMODE = 1000;
+static const LONG PARK_RENDERMODE = 1001;
+
+/// ***************************************************************************
+/// Returns \c true if \p op may be replaced by an instance. Only visible
+/// polygon objects without children qualify that are not the input of a
+/// generator or inside of a nested container.
+/// ***************************************************************************
+static Bool IsCandidate(BaseObject* op, BaseObject* root)
+{
+  if (!op->IsInstanceOf(Opolygon) || op->GetDown()) return false;
+  if (op->GetRenderMode() == MODE_OFF) return false;
+  if (IsControlledByGenerator(op)) return false;
+  if (static_cast<PolygonObject*>(op)->GetPolygonCount() <= 0) return false;
+
+  for (BaseObject* parent = op->GetUp(); parent && parent != root; parent = parent->GetUp())
+  {
+    if (parent->GetType() == Ocontainer || (parent->GetInfo() & OBJECT_GENERATOR))
+      return false;
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// Hashes everything of \p op that affects how it renders, except for its
+/// name and position.
+/// ***************************************************************************
+static String GeometryHash(PolygonObject* op)
+{
+  Fingerprint fp(op->GetDocument());
+  fp.AddLong(op->GetType());
+  const BaseContainer* bc = op->GetDataInstance();
+  if (bc)
+  {
+    // The name and layer don't change how the object renders.
+    BaseContainer data = *bc;
+    data.RemoveData(ID_BASELIST_NAME);
+    data.RemoveData(ID_LAYER_LINK);
+    fp.AddContainer(data);
+  }
+
+  LONG pointCount = op->GetPointCount();
+  LONG polyCount = op->GetPolygonCount();
+  fp.AddLong(pointCount);
+  fp.AddLong(polyCount);
+  const Vector* points = op->GetPointR();
+  const CPolygon* polys = op->GetPolygonR();
+  if (points && pointCount > 0) fp.Add(points, sizeof(Vector) * pointCount);
+  if (polys && polyCount > 0) fp.Add(polys, sizeof(CPolygon) * polyCount);
+
+  for (BaseTag* tag = op->GetFirstTag(); tag; tag = tag->GetNext())
+    fp.AddNode(tag);
+  return fp.GetHash();
+}
+
+/// ***************************************************************************
+/// Replaces \p op by a render instance of \p master and parks \p op
+/// invisibly under the instance.
+/// ***************************************************************************
+static Bool ReplaceByInstance(BaseObject* op, BaseObject* master, BaseDocument* doc)
+{
+  BaseObject* inst = BaseObject::Alloc(Oinstance);
+  if (!inst) return false;
+  inst->SetName(op->GetName());
+  inst->SetMl(op->GetMl());
+  inst->SetParameter(DescID(INSTANCEOBJECT_LINK), GeData(master), DESCFLAGS_SET_0);
+  #if API_VERSION >= 20000
+    inst->SetParameter(DescID(INSTANCEOBJECT_RENDERINSTANCE_MODE),
+      GeData(INSTANCEOBJECT_RENDERINSTANCE_MODE_SINGLEINSTANCE), DESCFLAGS_SET_0);
+  #else
+    inst->SetParameter(DescID(INSTANCEOBJECT_RENDERINSTANCE), GeData(true), DESCFLAGS_SET_0);
+  #endif
+
+  BaseContainer park;
+  park.SetLong(PARK_EDITORMODE, op->GetEditorMode());
+  park.SetLong(PARK_RENDERMODE, op->GetRenderMode());
+  inst->GetDataInstance()->SetContainer(CONTAINEROBJECT_INSTANCEPROMOTION, park);
+
+  inst->InsertBefore(op);
+  if (doc)
+  {
+    doc->AddUndo(UNDOTYPE_NEW, inst);
+    doc->AddUndo(UNDOTYPE_CHANGE, op);
+  }
+  op->Remove();
+  op->InsertUnder(inst);
+  op->SetMl(Matrix());
+  op->SetEditorMode(MODE_OFF);
+  op->SetRenderMode(MODE_OFF);
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+LONG PromoteInstances(BaseObject* root, BaseDocument* doc)
+{
+  if (!root) return 0;
+  std::vector<BaseObject*> candidates;
+  for (NodeIterator<BaseObject> it(root->GetDown(), root); it; ++it)
+  {
+    if (IsCandidate(*it, root))
+      candidates.push_back(*it);
+  }
+
+  // The first object of every group of identical objects is the master.
+  std::unordered_map<std::string, BaseObject*> masters;
+  LONG count = 0;
+  for (BaseObject* op : candidates)
+  {
+    std::string hash = ToStdString(GeometryHash(static_cast<PolygonObject*>(op)));
+    auto result = masters.emplace(hash, op);
+    if (result.second) continue;
+    if (ReplaceByInstance(op, result.first->second, doc))
+      count++;
+  }
+  return count;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+LONG RestoreInstances(BaseObject* root, BaseDocument* doc)
+{
+  if (!root) return 0;
+  std::vector<BaseObject*> instances;
+  for (NodeIterator<BaseObject> it(root->GetDown(), root); it; ++it)
+  {
+    if (it->GetType() != Oinstance) continue;
+    const BaseContainer* bc = it->GetDataInstance();
+    if (bc && bc->GetContainerInstance(CONTAINEROBJECT_INSTANCEPROMOTION))
+      instances.push_back(*it);
+  }
+
+  LONG count = 0;
+  for (BaseObject* inst : instances)
+  {
+    BaseContainer park = inst->GetDataInstance()->GetContainer(CONTAINEROBJECT_INSTANCEPROMOTION);
+    BaseObject* op = inst->GetDown();
+    if (op)
+    {
+      if (doc) doc->AddUndo(UNDOTYPE_CHANGE, op);
+      op->Remove();
+      op->InsertBefore(inst);
+      op->SetMl(inst->GetMl());
+      op->SetEditorMode(park.GetLong(PARK_EDITORMODE, MODE_UNDEF));
+      op->SetRenderMode(park.GetLong(PARK_RENDERMODE, MODE_UNDEF));
+      count++;
+    }
+    RemoveWithUndo(inst, doc);
+  }
+  return count;
+}
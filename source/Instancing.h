@@ -0,0 +1,36 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Instancing.h
+///
+/// Replaces geometrically identical polygon objects in a container by
+/// render instances of one of them when the container is locked. The
+/// replaced objects are parked invisibly under their instance so that
+/// the original hierarchy can be restored when the container is unlocked.
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+
+enum
+{
+  /// Sub-container on instance objects created by PromoteInstances(). It
+  /// stores the visibility of the parked object.
+  CONTAINEROBJECT_INSTANCEPROMOTION = 1036110,
+};
+
+/// ***************************************************************************
+/// Replaces all but one of every group of identical polygon objects in
+/// the hierarchy of \p root by render instances. Undos are added to \p doc
+/// if it is not \c nullptr. Returns the number of replaced objects.
+/// ***************************************************************************
+LONG PromoteInstances(BaseObject* root, BaseDocument* doc);
+
+/// ***************************************************************************
+/// Restores the objects replaced by PromoteInstances() in the hierarchy
+/// of \p root. Returns the number of restored objects.
+/// ***************************************************************************
+LONG RestoreInstances(BaseObject* root, BaseDocument* doc);
@@ -0,0 +1,556 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file PlaybackCache.cpp
+
+#include "PlaybackCache.h"
+#include "ContainerIndex.h"
+#include "ContainerObject.h"
+#include "Dependencies.h"
+#include "EvalProfile.h"
+#include "Utils/Misc.h"
+#include "Utils/PointCache.h"
+#include "res/c4d_symbols.h"
+#include <texpression.h>
+#include <cstring>
+#include <vector>
+
+enum
+{
+  ID_PLAYBACKCACHE = 1036122,
+};
+
+static const LONG BYPASS_DEFORMMODE = 1000;
+static const LONG BYPASS_EDITORMODE = 1001;
+static const LONG BYPASS_RENDERMODE = 1002;
+static const LONG BYPASS_EXPRESSION = 1003;
+
+/// ***************************************************************************
+/// The recorded data, shared by the copies of a container.
+/// ***************************************************************************
+struct PlaybackCacheData
+{
+  Filename filename;
+  PointCacheReader reader;
+  std::vector<PolygonObject*> templates;   ///< Objects of the first frame, in the space of the container.
+  std::vector<BaseLink*> dependencies;     ///< Nodes outside of the container without tracks.
+  ULONG dependencyDirty;
+  LONG fps;
+
+  PlaybackCacheData() : dependencyDirty(0), fps(0) { }
+
+  ~PlaybackCacheData()
+  {
+    for (PolygonObject* poly : templates)
+      PolygonObject::Free(poly);
+    for (BaseLink* link : dependencies)
+      BaseLink::Free(link);
+    reader.Close();
+    if (filename.Content())
+      GeFKill(filename);
+  }
+};
+
+/// ***************************************************************************
+/// Returns \c true if \p op has a tag of the type and name of \p tag.
+/// ***************************************************************************
+static Bool HasMatchingTag(BaseObject* op, BaseTag* tag)
+{
+  for (BaseTag* other = op->GetFirstTag(); other; other = other->GetNext())
+  {
+    if (other->GetType() == tag->GetType() && other->GetName() == tag->GetName())
+      return true;
+  }
+  return false;
+}
+
+/// ***************************************************************************
+/// Returns \c true for the tags that are carried over to the polygon
+/// objects of a deformed object.
+/// ***************************************************************************
+static Bool IsSurfaceTag(BaseTag* tag)
+{
+  switch (tag->GetType())
+  {
+    case Ttexture:
+    case Tpolygonselection:
+    case Tpointselection:
+    case Tedgeselection:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/// ***************************************************************************
+/// Implements CollectEvaluatedPolygons(), \p textures are the texture tags
+/// of the objects above \p op. \p origin is the generator whose cache
+/// \p op is in, \c nullptr outside of caches.
+/// ***************************************************************************
+static void CollectEvaluatedPolygons(BaseObject* op, Matrix const& up, BaseObject* origin,
+    std::vector<BaseTag*>& textures, std::vector<EvaluatedPolygon>& sources)
+{
+  for (; op; op = op->GetNext())
+  {
+    if (op->GetEditorMode() == MODE_OFF && op->GetRenderMode() == MODE_OFF)
+      continue;
+    Matrix mg = up * op->GetMl();
+    const size_t inherited = textures.size();
+    BaseObject* cache = op->GetCache();
+    if (cache)
+    {
+      // The children of a generator are its input objects.
+      for (BaseTag* tag = op->GetFirstTag(); tag; tag = tag->GetNext())
+      {
+        if (tag->GetType() == Ttexture) textures.push_back(tag);
+      }
+      CollectEvaluatedPolygons(cache, mg, origin ? origin : op, textures, sources);
+      textures.resize(inherited);
+      continue;
+    }
+    BaseObject* deformed = op->GetDeformCache();
+    BaseObject* geometry = deformed ? deformed : op;
+    if (geometry->IsInstanceOf(Opolygon) && !IsControlledByGenerator(op))
+    {
+      EvaluatedPolygon source;
+      source.poly = static_cast<PolygonObject*>(geometry);
+      source.mg = mg;
+      source.origin = origin ? origin : op;
+      source.tags = textures;
+      for (BaseTag* tag = op->GetFirstTag(); tag && deformed; tag = tag->GetNext())
+      {
+        if (IsSurfaceTag(tag) && !HasMatchingTag(deformed, tag))
+          source.tags.push_back(tag);
+      }
+      sources.push_back(std::move(source));
+    }
+    for (BaseTag* tag = op->GetFirstTag(); tag; tag = tag->GetNext())
+    {
+      if (tag->GetType() == Ttexture) textures.push_back(tag);
+    }
+    CollectEvaluatedPolygons(op->GetDown(), mg, origin, textures, sources);
+    textures.resize(inherited);
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void CollectEvaluatedPolygons(BaseObject* op, Matrix const& up, std::vector<EvaluatedPolygon>& sources)
+{
+  std::vector<BaseTag*> textures;
+  CollectEvaluatedPolygons(op, up, nullptr, textures, sources);
+}
+
+/// ***************************************************************************
+/// Returns the sum of the dirty counts of the nodes in \p links.
+/// ***************************************************************************
+static ULONG GetDependencyDirty(std::vector<BaseLink*> const& links)
+{
+  ULONG dirty = 0;
+  for (BaseLink* link : links)
+  {
+    BaseList2D* node = link->ForceGetLink();
+    if (node)
+      dirty = dirty * 31 + node->GetDirty(DIRTYFLAGS_DATA | DIRTYFLAGS_MATRIX);
+    else
+      dirty = dirty * 31 + 1;
+  }
+  return dirty;
+}
+
+/// ***************************************************************************
+/// Returns \c true if \p node changes over time, through tracks or the
+/// expressions of an object.
+/// ***************************************************************************
+static Bool IsAnimated(BaseList2D* node)
+{
+  if (node->GetFirstCTrack()) return true;
+  if (!node->IsInstanceOf(Obase)) return false;
+  for (BaseTag* tag = static_cast<BaseObject*>(node)->GetFirstTag(); tag; tag = tag->GetNext())
+  {
+    if (tag->GetInfo() & TAG_EXPRESSION) return true;
+  }
+  return false;
+}
+
+/// ***************************************************************************
+/// Links the nodes outside of \p op that it depends on, except for those
+/// that are animated, into \p data.
+/// ***************************************************************************
+static void LinkDependencies(BaseObject* op, PlaybackCacheData& data)
+{
+  ContainerDependencies deps;
+  if (!ContainerGetDependencies(op, deps)) return;
+  std::vector<BaseList2D*> nodes(deps.objects.begin(), deps.objects.end());
+  nodes.insert(nodes.end(), deps.materials.begin(), deps.materials.end());
+  nodes.insert(nodes.end(), deps.shaders.begin(), deps.shaders.end());
+  nodes.insert(nodes.end(), deps.others.begin(), deps.others.end());
+  for (BaseList2D* node : nodes)
+  {
+    if (IsAnimated(node)) continue;
+    BaseLink* link = BaseLink::Alloc();
+    if (!link) continue;
+    link->SetLink(node);
+    data.dependencies.push_back(link);
+  }
+  data.dependencyDirty = GetDependencyDirty(data.dependencies);
+}
+
+/// ***************************************************************************
+/// Returns a new file for a point cache.
+/// ***************************************************************************
+static Filename GetCacheFilename()
+{
+  static ULONG counter = 0;
+  Filename dir = GeGetC4DPath(C4D_PATH_PREFS) + Filename("playbackcache");
+  if (!GeFExist(dir, true))
+    GeFCreateDir(dir);
+  String name = "cache-" + LongToString(GeGetTimer()) + "-" + LongToString(counter++) + ".pointcache";
+  return dir + Filename(name);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool PlaybackCache::Record(BaseObject* op, BaseDocument* doc)
+{
+  Flush();
+  if (!op || !doc) return false;
+  const LONG fps = doc->GetFps();
+  const LONG first = doc->GetMinTime().GetFrame(fps);
+  const LONG last = doc->GetMaxTime().GetFrame(fps);
+  if (last < first) return false;
+
+  std::shared_ptr<PlaybackCacheData> data = std::make_shared<PlaybackCacheData>();
+  data->fps = fps;
+  data->filename = GetCacheFilename();
+  std::string filename = ToStdString(data->filename.GetString());
+
+  const BaseTime time = doc->GetTime();
+  PointCacheWriter writer;
+  std::vector<EvaluatedPolygon> sources;
+  std::vector<std::vector<double>> points;
+  std::vector<const double*> objects;
+  Bool ok = true;
+  for (LONG frame = first; frame <= last && ok; frame++)
+  {
+    StatusSetText(GeLoadString(IDS_STATUS_RECORDING_CACHE));
+    StatusSetBar(100 * (frame - first) / (last - first + 1));
+    doc->SetTime(BaseTime(frame, fps));
+    EvalProfileExecutePasses(op, doc);
+
+    sources.clear();
+    CollectEvaluatedPolygons(op->GetDown(), op->GetMg(), sources);
+    if (frame == first)
+    {
+      std::vector<uint32_t> counts;
+      for (EvaluatedPolygon const& source : sources)
+      {
+        PolygonObject* poly = static_cast<PolygonObject*>(source.poly->GetClone(COPYFLAGS_0, nullptr));
+        if (!poly)
+        {
+          ok = false;
+          break;
+        }
+        poly->SetMl(Matrix());
+
+        // Inherited tags go first, the tags of the object override them.
+        BaseTag* pred = nullptr;
+        for (BaseTag* tag : source.tags)
+        {
+          BaseTag* clone = static_cast<BaseTag*>(tag->GetClone(COPYFLAGS_0, nullptr));
+          if (!clone) continue;
+          poly->InsertTag(clone, pred);
+          pred = clone;
+        }
+        data->templates.push_back(poly);
+        counts.push_back((uint32_t) source.poly->GetPointCount());
+      }
+      points.resize(counts.size());
+      for (size_t i=0; i < counts.size(); i++)
+        points[i].resize((size_t) counts[i] * 3);
+      ok = ok && !sources.empty() && writer.Open(filename, first, counts);
+    }
+    else if (sources.size() != data->templates.size())
+      ok = false;
+    if (!ok) break;
+
+    // Store the points in the space of the container.
+    const Matrix local = ~op->GetMg();
+    objects.clear();
+    for (size_t i=0; i < sources.size(); i++)
+    {
+      PolygonObject* poly = sources[i].poly;
+      PolygonObject* recorded = data->templates[i];
+      LONG count = poly->GetPointCount();
+      LONG polygons = poly->GetPolygonCount();
+      if ((size_t) count * 3 != points[i].size() || polygons != recorded->GetPolygonCount() ||
+          memcmp(poly->GetPolygonR(), recorded->GetPolygonR(), (size_t) polygons * sizeof(CPolygon)) != 0)
+      {
+        ok = false;
+        break;
+      }
+      const Vector* padr = poly->GetPointR();
+      const Matrix m = local * sources[i].mg;
+      for (LONG j=0; j < count; j++)
+      {
+        Vector p = m * padr[j];
+        points[i][j * 3 + 0] = p.x;
+        points[i][j * 3 + 1] = p.y;
+        points[i][j * 3 + 2] = p.z;
+      }
+      objects.push_back(points[i].data());
+    }
+    ok = ok && writer.AddFrame(objects.data());
+  }
+  ok = writer.Close() && ok;
+
+  doc->SetTime(time);
+  EvalProfileExecutePasses(op, doc);
+  StatusClear();
+
+  if (!ok || !data->reader.Open(filename))
+    return false;
+  LinkDependencies(op, *data);
+  m_data = data;
+  m_builtFrame = NOTOK;
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void PlaybackCache::Flush()
+{
+  m_data.reset();
+  m_builtFrame = NOTOK;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void PlaybackCache::CopyTo(PlaybackCache& dest) const
+{
+  dest.m_data = m_data;
+  dest.m_builtFrame = NOTOK;
+}
+
+/// ***************************************************************************
+/// Returns the frame of \p doc in the recorded range of \p data.
+/// ***************************************************************************
+static uint32_t GetCacheFrame(PlaybackCacheData const& data, BaseDocument* doc)
+{
+  LONG frame = doc ? doc->GetTime().GetFrame(data.fps) : 0;
+  LONG index = frame - data.reader.GetFirstFrame();
+  LONG count = (LONG) data.reader.GetFrameCount();
+  return (uint32_t) (index < 0 ? 0 : (index >= count ? count - 1 : index));
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool PlaybackCache::IsDirty(BaseDocument* doc) const
+{
+  return m_data && (LONG) GetCacheFrame(*m_data, doc) != m_builtFrame;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool PlaybackCache::IsStale() const
+{
+  return m_data && GetDependencyDirty(m_data->dependencies) != m_data->dependencyDirty;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+BaseObject* PlaybackCache::Build(BaseDocument* doc)
+{
+  if (!m_data) return nullptr;
+  BaseObject* root = BaseObject::Alloc(Onull);
+  if (!root) return nullptr;
+
+  static_assert(sizeof(Vector) == 3 * sizeof(double), "Vector must be three doubles");
+  uint32_t frame = GetCacheFrame(*m_data, doc);
+  for (size_t i=0; i < m_data->templates.size(); i++)
+  {
+    PolygonObject* poly = static_cast<PolygonObject*>(m_data->templates[i]->GetClone(COPYFLAGS_0, nullptr));
+    if (!poly) continue;
+    m_data->reader.ReadPoints(frame, (uint32_t) i, reinterpret_cast<double*>(poly->GetPointW()));
+    poly->Message(MSG_UPDATE);
+    poly->InsertUnderLast(root);
+  }
+  m_builtFrame = (LONG) frame;
+  return root;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool PlaybackCache::Update(BaseDocument* doc, BaseObject* cache)
+{
+  if (!m_data || !cache) return false;
+  std::vector<PolygonObject*> objects;
+  for (BaseObject* child = cache->GetDown(); child; child = child->GetNext())
+  {
+    size_t i = objects.size();
+    if (i >= m_data->templates.size() || !child->IsInstanceOf(Opolygon)) return false;
+    PolygonObject* poly = static_cast<PolygonObject*>(child);
+    if (poly->GetPointCount() != m_data->templates[i]->GetPointCount()) return false;
+    objects.push_back(poly);
+  }
+  if (objects.size() != m_data->templates.size()) return false;
+
+  uint32_t frame = GetCacheFrame(*m_data, doc);
+  for (size_t i=0; i < objects.size(); i++)
+  {
+    m_data->reader.ReadPoints(frame, (uint32_t) i, reinterpret_cast<double*>(objects[i]->GetPointW()));
+    objects[i]->Message(MSG_UPDATE);
+  }
+  m_builtFrame = (LONG) frame;
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+static Bool BypassNode(BaseList2D* node, BaseDocument* doc)
+{
+  BaseContainer* bc = node->GetDataInstance();
+  if (!bc || bc->GetContainerInstance(CONTAINEROBJECT_PLAYBACKBYPASS)) return false;
+
+  BaseContainer state;
+  if (node->IsInstanceOf(Obase))
+  {
+    BaseObject* op = static_cast<BaseObject*>(node);
+    if (doc) doc->AddUndo(UNDOTYPE_CHANGE_SMALL, op);
+    state.SetBool(BYPASS_DEFORMMODE, op->GetDeformMode());
+    state.SetLong(BYPASS_EDITORMODE, op->GetEditorMode());
+    state.SetLong(BYPASS_RENDERMODE, op->GetRenderMode());
+    bc->SetContainer(CONTAINEROBJECT_PLAYBACKBYPASS, state);
+    if (op->GetInfo() & (OBJECT_GENERATOR | OBJECT_MODIFIER))
+      op->SetDeformMode(false);
+    op->SetEditorMode(MODE_OFF);
+    op->SetRenderMode(MODE_OFF);
+    return true;
+  }
+
+  BaseTag* tag = static_cast<BaseTag*>(node);
+  if (!(tag->GetInfo() & TAG_EXPRESSION)) return false;
+  GeData enabled;
+  if (!tag->GetParameter(DescID(EXPRESSION_ENABLE), enabled, DESCFLAGS_GET_0)) return false;
+  if (doc) doc->AddUndo(UNDOTYPE_CHANGE_SMALL, tag);
+  state.SetBool(BYPASS_EXPRESSION, enabled.GetBool());
+  bc->SetContainer(CONTAINEROBJECT_PLAYBACKBYPASS, state);
+  tag->SetParameter(DescID(EXPRESSION_ENABLE), GeData(false), DESCFLAGS_SET_0);
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+static Bool RestoreNode(BaseList2D* node, BaseDocument* doc)
+{
+  BaseContainer* bc = node->GetDataInstance();
+  if (!bc || !bc->GetContainerInstance(CONTAINEROBJECT_PLAYBACKBYPASS)) return false;
+  if (doc) doc->AddUndo(UNDOTYPE_CHANGE_SMALL, node);
+
+  BaseContainer state = bc->GetContainer(CONTAINEROBJECT_PLAYBACKBYPASS);
+  bc->RemoveData(CONTAINEROBJECT_PLAYBACKBYPASS);
+  if (node->IsInstanceOf(Obase))
+  {
+    BaseObject* op = static_cast<BaseObject*>(node);
+    op->SetDeformMode(state.GetBool(BYPASS_DEFORMMODE, true));
+    op->SetEditorMode(state.GetLong(BYPASS_EDITORMODE, MODE_UNDEF));
+    op->SetRenderMode(state.GetLong(BYPASS_RENDERMODE, MODE_UNDEF));
+  }
+  else
+  {
+    GeData enabled(state.GetBool(BYPASS_EXPRESSION, true));
+    node->SetParameter(DescID(EXPRESSION_ENABLE), enabled, DESCFLAGS_SET_0);
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+LONG PlaybackCacheBypass(BaseObject* root, BaseDocument* doc, Bool bypass)
+{
+  if (!root) return 0;
+  LONG count = 0;
+  for (NodeIterator<BaseObject> it(root->GetDown(), root); it; ++it)
+  {
+    if (bypass ? BypassNode(*it, doc) : RestoreNode(*it, doc))
+      count++;
+    for (BaseTag* tag = it->GetFirstTag(); tag; tag = tag->GetNext())
+    {
+      if (bypass ? BypassNode(tag, doc) : RestoreNode(tag, doc))
+        count++;
+    }
+  }
+  return count;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void PlaybackCacheCleanup()
+{
+  // Files that are still used by another instance of Cinema are mapped,
+  // they can't be removed or stay valid until they are unmapped.
+  Filename dir = GeGetC4DPath(C4D_PATH_PREFS) + Filename("playbackcache");
+  if (!GeFExist(dir, true)) return;
+  BrowseFiles* bf = BrowseFiles::Alloc();
+  if (!bf) return;
+  bf->Init(dir, BROWSEFILES_0);
+  while (bf->GetNext())
+  {
+    Filename name = bf->GetFilename();
+    if (!bf->IsDir() && name.CheckSuffix("pointcache"))
+      GeFKill(dir + name);
+  }
+  BrowseFiles::Free(bf);
+}
+
+/// ***************************************************************************
+/// Records the caches again whose dependencies changed. Containers detect
+/// this while their cache is built, which happens outside of the main
+/// thread, and wake up the plugin.
+/// ***************************************************************************
+class PlaybackCacheMessage : public MessageData
+{
+public:
+
+  virtual Bool CoreMessage(LONG id, const BaseContainer& bc)
+  {
+    // Recording changes the time of the document.
+    if (id != ID_PLAYBACKCACHE || CheckIsRunning(CHECKISRUNNING_ANIMATIONRUNNING))
+      return true;
+    Bool changed = false;
+    std::vector<BaseObject*> containers;
+    for (BaseDocument* doc = GetFirstDocument(); doc; doc = doc->GetNext())
+    {
+      containers.clear();
+      ContainerIndexGetAll(doc, containers);
+      for (BaseObject* op : containers)
+      {
+        if (ContainerRefreshPlaybackCache(op))
+          changed = true;
+      }
+    }
+    if (changed) EventAdd();
+    return true;
+  }
+
+};
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool RegisterPlaybackCache()
+{
+  return RegisterMessagePlugin(
+    ID_PLAYBACKCACHE,
+    GeLoadString(IDS_PLAYBACKCACHE),
+    0,
+    gNew(PlaybackCacheMessage));
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void PlaybackCacheRequestRefresh()
+{
+  SpecialEventAdd(ID_PLAYBACKCACHE);
+}
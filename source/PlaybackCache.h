@@ -0,0 +1,123 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file PlaybackCache.h
+///
+/// Records the evaluated geometry of a container over the frame range of
+/// the document into a point cache (see Utils/PointCache.h) when it is
+/// locked with the "Playback Cache on Lock" option. While the cache is
+/// active, the generators, deformers and expressions in the container are
+/// bypassed and the container generates the cached geometry instead. The
+/// cache is dropped when the container is unlocked or its promoted
+/// parameters change, and recorded again when a node outside of the
+/// container that it depends on is changed. It is not saved with the
+/// document, files left behind by a crash are removed on startup.
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+#include <memory>
+#include <vector>
+
+enum
+{
+  /// Sub-container on the nodes bypassed by PlaybackCacheBypass(). It
+  /// stores their state before they were bypassed.
+  CONTAINEROBJECT_PLAYBACKBYPASS = 1036113,
+};
+
+struct PlaybackCacheData;
+
+/// ***************************************************************************
+/// The playback cache of a container. Copies of the container share the
+/// recorded data, the file is deleted when the last copy drops it.
+/// ***************************************************************************
+class PlaybackCache
+{
+  std::shared_ptr<PlaybackCacheData> m_data;
+  LONG m_builtFrame;   ///< Frame of the geometry returned by Build().
+
+public:
+
+  PlaybackCache() : m_builtFrame(NOTOK) { }
+
+  Bool IsActive() const { return m_data != nullptr; }
+
+  /// Evaluates \p doc at every frame of its frame range and records the
+  /// polygon objects generated by the hierarchy of \p op, in the space of
+  /// \p op. Returns \c false if the hierarchy generates no polygons or its
+  /// topology changes over time. Must be called from the main thread.
+  Bool Record(BaseObject* op, BaseDocument* doc);
+
+  /// Drops the cache.
+  void Flush();
+
+  /// Shares the cache with \p dest.
+  void CopyTo(PlaybackCache& dest) const;
+
+  /// Returns \c true if the current frame of \p doc is not the frame
+  /// that was last built.
+  Bool IsDirty(BaseDocument* doc) const;
+
+  /// Returns \c true if a node outside of the container that it depends
+  /// on changed since the cache was recorded. Nodes with tracks or
+  /// expressions were recorded over time and are not checked.
+  Bool IsStale() const;
+
+  /// Returns the cached geometry at the current frame of \p doc below a
+  /// Null object. Frames outside of the recorded range are clamped.
+  BaseObject* Build(BaseDocument* doc);
+
+  /// Reads the points of the current frame of \p doc into \p cache, a
+  /// hierarchy returned by Build() before. Returns \c false if \p cache
+  /// doesn't match the recorded objects.
+  Bool Update(BaseDocument* doc, BaseObject* cache);
+};
+
+/// ***************************************************************************
+/// A polygon object generated by a hierarchy and its global matrix.
+/// ***************************************************************************
+struct EvaluatedPolygon
+{
+  PolygonObject* poly;
+  Matrix mg;
+  BaseObject* origin;           ///< The object in the hierarchy that generated #poly, or #poly.
+  std::vector<BaseTag*> tags;   ///< Tags that apply to #poly without being on it.
+};
+
+/// ***************************************************************************
+/// Collects the polygon objects in the evaluated hierarchy starting at
+/// \p op, whose parent has the global matrix \p up. Generators are
+/// replaced by their caches and deformed objects by their deform caches.
+/// The texture tags inherited from the objects above, and the texture and
+/// selection tags of a deformed object that its deform cache lacks, are
+/// collected with every polygon object.
+/// ***************************************************************************
+void CollectEvaluatedPolygons(BaseObject* op, Matrix const& up, std::vector<EvaluatedPolygon>& sources);
+
+/// ***************************************************************************
+/// Disables the generators, deformers and expressions in the hierarchy of
+/// \p root and hides its objects if \p bypass is \c true, or restores them
+/// if it is \c false. Undos are added to \p doc if it is not \c nullptr.
+/// Returns the number of changed nodes.
+/// ***************************************************************************
+LONG PlaybackCacheBypass(BaseObject* root, BaseDocument* doc, Bool bypass);
+
+/// ***************************************************************************
+/// Removes the point caches left behind by a crash. Called on startup.
+/// ***************************************************************************
+void PlaybackCacheCleanup();
+
+/// ***************************************************************************
+/// Asks the main thread to record the stale caches again (see
+/// PlaybackCache::IsStale()). Can be called from any thread.
+/// ***************************************************************************
+void PlaybackCacheRequestRefresh();
+
+/// ***************************************************************************
+/// Registers the message plugin that records stale caches again.
+/// ***************************************************************************
+Bool RegisterPlaybackCache();
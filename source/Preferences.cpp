@@ -0,0 +1,191 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Preferences.cpp
+
+#include "Preferences.h"
+#include <c4d_apibridge.h>
+#include "res/c4d_symbols.h"
+#include "EvalProfile.h"
+#include "IconCache.h"
+#include "TraceRecording.h"
+
+enum
+{
+  ID_COMMAND_PREFERENCES = 1036108,
+};
+
+/// ***************************************************************************
+/// Returns the default value for the preference \p id.
+/// ***************************************************************************
+static GeData GetPrefDefault(LONG id)
+{
+  switch (id)
+  {
+    case PREF_DEDUPE_ON_SAVE:
+    case PREF_PROGRESSIVE_UNPACK:
+    case PREF_COMPACT_ICONS:
+    case PREF_PROFILE_EVALUATION:
+    case PREF_WRITE_CATALOG:
+    case PREF_RECORD_TRACE:
+      return GeData(false);
+    case PREF_ICON_CACHE_BUDGET:
+      return GeData(16);
+  }
+  return GeData();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool GetPrefBool(LONG id)
+{
+  BaseContainer* bc = GetWorldPluginData(CONTAINEROBJECT_PREFERENCES);
+  if (!bc) return GetPrefDefault(id).GetBool();
+  return bc->GetBool(id, GetPrefDefault(id).GetBool());
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void SetPrefBool(LONG id, Bool value)
+{
+  BaseContainer bc;
+  bc.SetBool(id, value);
+  SetWorldPluginData(CONTAINEROBJECT_PREFERENCES, bc, true);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+LONG GetPrefLong(LONG id)
+{
+  BaseContainer* bc = GetWorldPluginData(CONTAINEROBJECT_PREFERENCES);
+  if (!bc) return GetPrefDefault(id).GetLong();
+  return bc->GetLong(id, GetPrefDefault(id).GetLong());
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void SetPrefLong(LONG id, LONG value)
+{
+  BaseContainer bc;
+  bc.SetLong(id, value);
+  SetWorldPluginData(CONTAINEROBJECT_PREFERENCES, bc, true);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+class _PreferencesDialog : public GeDialog
+{
+  enum {
+    CHK_DEDUPE_ON_SAVE = 2000,
+    CHK_PROGRESSIVE_UNPACK = 2001,
+    CHK_COMPACT_ICONS = 2002,
+    CHK_PROFILE_EVALUATION = 2003,
+    EDT_ICON_CACHE_BUDGET = 2004,
+    CHK_WRITE_CATALOG = 2005,
+    CHK_RECORD_TRACE = 2006,
+  };
+
+public:
+
+  virtual Bool CreateLayout()
+  {
+    SetTitle(GeLoadString(IDS_COMMAND_PREFERENCES_TITLE));
+    GroupBegin(0, BFH_SCALEFIT | BFV_SCALEFIT, 1, 0, ""_s, 0);
+    {
+      GroupBorderSpace(4, 4, 4, 4);
+      AddCheckbox(CHK_DEDUPE_ON_SAVE, BFH_LEFT, 0, 0, GeLoadString(IDS_PREFS_DEDUPE_ON_SAVE));
+      AddCheckbox(CHK_PROGRESSIVE_UNPACK, BFH_LEFT, 0, 0, GeLoadString(IDS_PREFS_PROGRESSIVE_UNPACK));
+      AddCheckbox(CHK_COMPACT_ICONS, BFH_LEFT, 0, 0, GeLoadString(IDS_PREFS_COMPACT_ICONS));
+      AddCheckbox(CHK_PROFILE_EVALUATION, BFH_LEFT, 0, 0, GeLoadString(IDS_PREFS_PROFILE_EVALUATION));
+      AddCheckbox(CHK_WRITE_CATALOG, BFH_LEFT, 0, 0, GeLoadString(IDS_PREFS_WRITE_CATALOG));
+      AddCheckbox(CHK_RECORD_TRACE, BFH_LEFT, 0, 0, GeLoadString(IDS_PREFS_RECORD_TRACE));
+      GroupBegin(0, BFH_LEFT, 2, 0, ""_s, 0);
+      {
+        AddStaticText(0, BFH_LEFT, 0, 0, GeLoadString(IDS_PREFS_ICON_CACHE_BUDGET), 0);
+        AddEditNumberArrows(EDT_ICON_CACHE_BUDGET, BFH_LEFT, 70, 0);
+        GroupEnd();
+      }
+      GroupEnd();
+    }
+    AddDlgGroup(DLG_OK | DLG_CANCEL);
+    return true;
+  }
+
+  virtual Bool InitValues()
+  {
+    SetBool(CHK_DEDUPE_ON_SAVE, GetPrefBool(PREF_DEDUPE_ON_SAVE));
+    SetBool(CHK_PROGRESSIVE_UNPACK, GetPrefBool(PREF_PROGRESSIVE_UNPACK));
+    SetBool(CHK_COMPACT_ICONS, GetPrefBool(PREF_COMPACT_ICONS));
+    SetBool(CHK_PROFILE_EVALUATION, GetPrefBool(PREF_PROFILE_EVALUATION));
+    SetBool(CHK_WRITE_CATALOG, GetPrefBool(PREF_WRITE_CATALOG));
+    SetBool(CHK_RECORD_TRACE, GetPrefBool(PREF_RECORD_TRACE));
+    SetLong(EDT_ICON_CACHE_BUDGET, GetPrefLong(PREF_ICON_CACHE_BUDGET), 0, 4096);
+    return true;
+  }
+
+  virtual Bool Command(LONG id, const BaseContainer& msg)
+  {
+    switch (id)
+    {
+      case DLG_OK:
+      {
+        Bool value;
+        GetBool(CHK_DEDUPE_ON_SAVE, value);
+        SetPrefBool(PREF_DEDUPE_ON_SAVE, value);
+        GetBool(CHK_PROGRESSIVE_UNPACK, value);
+        SetPrefBool(PREF_PROGRESSIVE_UNPACK, value);
+        GetBool(CHK_COMPACT_ICONS, value);
+        SetPrefBool(PREF_COMPACT_ICONS, value);
+        GetBool(CHK_PROFILE_EVALUATION, value);
+        SetPrefBool(PREF_PROFILE_EVALUATION, value);
+        GetBool(CHK_WRITE_CATALOG, value);
+        SetPrefBool(PREF_WRITE_CATALOG, value);
+        GetBool(CHK_RECORD_TRACE, value);
+        SetPrefBool(PREF_RECORD_TRACE, value);
+        LONG budget;
+        GetLong(EDT_ICON_CACHE_BUDGET, budget);
+        SetPrefLong(PREF_ICON_CACHE_BUDGET, budget);
+        IconCacheUpdateBudget();
+        TraceRecordingUpdate();
+        EvalProfileUpdate();
+        Close();
+        break;
+      }
+      case DLG_CANCEL:
+        Close();
+        break;
+    }
+    return true;
+  }
+
+};
+
+/// ***************************************************************************
+/// ***************************************************************************
+class PreferencesCommand : public CommandData
+{
+public:
+
+  C4D_APIBRIDGE_COMMANDDATA_EXECUTE(doc)
+  {
+    _PreferencesDialog dlg;
+    dlg.Open(DLG_TYPE_MODAL, 0);
+    return true;
+  }
+
+};
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool RegisterPreferences()
+{
+  return RegisterCommandPlugin(
+    ID_COMMAND_PREFERENCES,
+    GeLoadString(IDS_COMMAND_PREFERENCES_TITLE),
+    0,
+    nullptr,
+    GeLoadString(IDS_COMMAND_PREFERENCES_HELP),
+    gNew(PreferencesCommand));
+}
@@ -0,0 +1,43 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Preferences.h
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+
+/// ***************************************************************************
+/// Plugin-wide settings, stored in the world container of Cinema 4D and
+/// edited with the "Container Preferences" command.
+/// ***************************************************************************
+enum
+{
+  CONTAINEROBJECT_PREFERENCES = 1036107,
+
+  PREF_DEDUPE_ON_SAVE = 1000,   // BOOL
+  PREF_PROGRESSIVE_UNPACK = 1001, // BOOL
+  PREF_COMPACT_ICONS = 1002,    // BOOL
+  PREF_PROFILE_EVALUATION = 1003, // BOOL
+  PREF_ICON_CACHE_BUDGET = 1004, // LONG, megabytes of decoded icons
+  PREF_WRITE_CATALOG = 1005,    // BOOL
+  PREF_RECORD_TRACE = 1006,     // BOOL
+};
+
+/// Returns the value of the Boolean preference \p id.
+Bool GetPrefBool(LONG id);
+
+/// Changes the value of the Boolean preference \p id.
+void SetPrefBool(LONG id, Bool value);
+
+/// Returns the value of the integer preference \p id.
+LONG GetPrefLong(LONG id);
+
+/// Changes the value of the integer preference \p id.
+void SetPrefLong(LONG id, LONG value);
+
+/// Registers the "Container Preferences" command.
+Bool RegisterPreferences();
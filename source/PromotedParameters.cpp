@@ -0,0 +1,301 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file PromotedParameters.cpp
+
+#include "PromotedParameters.h"
+
+/// ***************************************************************************
+/// Returns a stamp that changes whenever a node could have been removed
+/// from \p doc, thus invalidating cached node pointers.
+/// ***************************************************************************
+static LLONG GetHierarchyStamp(BaseDocument* doc)
+{
+  if (!doc) return -1;
+  LLONG objects = (LLONG) doc->GetHDirty(HDIRTYFLAGS_OBJECT_HIERARCHY);
+  LLONG tags = (LLONG) doc->GetHDirty(HDIRTYFLAGS_TAG);
+  return (objects << 32) ^ tags;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+static Bool WriteDescID(HyperFile* hf, DescID const& id)
+{
+  LONG depth = id.GetDepth();
+  if (!hf->WriteLong(depth)) return false;
+  for (LONG i=0; i < depth; i++)
+  {
+    if (!hf->WriteLong(id[i].id)) return false;
+    if (!hf->WriteLong(id[i].dtype)) return false;
+    if (!hf->WriteLong(id[i].creator)) return false;
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+static Bool ReadDescID(HyperFile* hf, DescID* id)
+{
+  LONG depth;
+  if (!hf->ReadLong(&depth)) return false;
+  *id = DescID();
+  for (LONG i=0; i < depth; i++)
+  {
+    LONG lid, dtype, creator;
+    if (!hf->ReadLong(&lid)) return false;
+    if (!hf->ReadLong(&dtype)) return false;
+    if (!hf->ReadLong(&creator)) return false;
+    id->PushId(DescLevel(lid, dtype, creator));
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void PromotedParameterList::Flush()
+{
+  for (PromotedParameter& param : m_params)
+    BaseLink::Free(param.link);
+  m_params.clear();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool PromotedParameterList::Add(BaseList2D* node, DescID const& target, DescID const& local)
+{
+  if (!node) return false;
+  PromotedParameter* param = Find(local);
+  if (!param)
+  {
+    PromotedParameter entry;
+    entry.link = BaseLink::Alloc();
+    if (!entry.link) return false;
+    m_params.push_back(entry);
+    param = &m_params.back();
+  }
+  param->link->SetLink(node);
+  param->target = target;
+  param->local = local;
+  param->cachedNode = nullptr;
+  param->cachedStamp = -1;
+  param->cachedDescDirty = 0;
+  param->cachedValid = false;
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+PromotedParameter* PromotedParameterList::Find(DescID const& local)
+{
+  for (PromotedParameter& param : m_params)
+  {
+    if (param.local == local)
+      return &param;
+  }
+  return nullptr;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+BaseList2D* PromotedParameterList::Resolve(PromotedParameter& param, BaseDocument* doc)
+{
+  LLONG stamp = GetHierarchyStamp(doc);
+  if (stamp == -1 || stamp != param.cachedStamp)
+  {
+    param.cachedNode = doc ? param.link->GetLink(doc) : param.link->ForceGetLink();
+    param.cachedStamp = stamp;
+    param.cachedDescDirty = 0;
+    param.cachedValid = false;
+  }
+
+  BaseList2D* node = param.cachedNode;
+  if (!node) return nullptr;
+
+  // Re-validate the target parameter only when the description of the
+  // node changed, eg. when user-data was removed from it.
+  ULONG descDirty = node->GetDirty(DIRTYFLAGS_DESCRIPTION);
+  if (!param.cachedValid || descDirty != param.cachedDescDirty)
+  {
+    param.cachedValid = true;
+    if (param.target[0].id == ID_USERDATA)
+    {
+      DynamicDescription* dyn = node->GetDynamicDescription();
+      param.cachedValid = dyn && dyn->Find(param.target) != nullptr;
+    }
+    param.cachedDescDirty = descDirty;
+  }
+  return param.cachedValid ? node : nullptr;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool PromotedParameterList::Forward(BaseDocument* doc, DescID const& local, GeData const& data)
+{
+  PromotedParameter* param = Find(local);
+  if (!param) return false;
+  BaseList2D* node = Resolve(*param, doc);
+  if (!node) return false;
+  return node->SetParameter(param->target, data, DESCFLAGS_SET_0);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void PromotedParameterList::Prune(BaseList2D* op)
+{
+  DynamicDescription* dyn = op->GetDynamicDescription();
+  for (auto it = m_params.begin(); it != m_params.end(); )
+  {
+    if (!dyn || !dyn->Find(it->local))
+    {
+      BaseLink::Free(it->link);
+      it = m_params.erase(it);
+    }
+    else
+      ++it;
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool PromotedParameterList::Read(HyperFile* hf)
+{
+  Flush();
+  LONG count;
+  if (!hf->ReadLong(&count)) return false;
+  for (LONG i=0; i < count; i++)
+  {
+    PromotedParameter param;
+    param.link = BaseLink::Alloc();
+    if (!param.link) return false;
+    param.cachedNode = nullptr;
+    param.cachedStamp = -1;
+    param.cachedDescDirty = 0;
+    param.cachedValid = false;
+    m_params.push_back(param);
+    PromotedParameter& entry = m_params.back();
+    if (!entry.link->Read(hf)) return false;
+    if (!ReadDescID(hf, &entry.target)) return false;
+    if (!ReadDescID(hf, &entry.local)) return false;
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool PromotedParameterList::Write(HyperFile* hf) const
+{
+  if (!hf->WriteLong((LONG) m_params.size())) return false;
+  for (PromotedParameter const& param : m_params)
+  {
+    if (!param.link->Write(hf)) return false;
+    if (!WriteDescID(hf, param.target)) return false;
+    if (!WriteDescID(hf, param.local)) return false;
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool PromotedParameterList::CopyTo(PromotedParameterList& dest, COPYFLAGS flags, AliasTrans* at) const
+{
+  dest.Flush();
+  for (PromotedParameter const& param : m_params)
+  {
+    PromotedParameter entry = param;
+    entry.link = BaseLink::Alloc();
+    if (!entry.link) return false;
+    entry.cachedNode = nullptr;
+    entry.cachedStamp = -1;
+    entry.cachedValid = false;
+    dest.m_params.push_back(entry);
+    if (!param.link->CopyTo(entry.link, flags, at)) return false;
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// Returns \c true if \p node is \p op or in the hierarchy of \p op.
+/// Tags are checked by their host object.
+/// ***************************************************************************
+static Bool IsInHierarchy(BaseObject* op, BaseList2D* node)
+{
+  BaseObject* obj = nullptr;
+  if (node->IsInstanceOf(Obase))
+    obj = static_cast<BaseObject*>(node);
+  else if (node->IsInstanceOf(Tbase))
+    obj = static_cast<BaseTag*>(node)->GetObject();
+  for (; obj; obj = obj->GetUp())
+  {
+    if (obj == op) return true;
+  }
+  return false;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+static LONG PromoteUserdata(BaseObject* op, BaseList2D* node, PromotedParameterList& list)
+{
+  DynamicDescription* src = node->GetDynamicDescription();
+  DynamicDescription* dst = op->GetDynamicDescription();
+  if (!src || !dst) return 0;
+
+  // Collect the parameters first, we can't modify the description of
+  // the container while browsing the one of the node if they are
+  // the same.
+  std::vector<std::pair<DescID, BaseContainer>> entries;
+  DescID id;
+  const BaseContainer* bc = nullptr;
+  void* handle = src->BrowseInit();
+  while (src->BrowseGetNext(handle, &id, &bc))
+  {
+    LONG dtype = id[id.GetDepth() - 1].dtype;
+    if (dtype == DTYPE_GROUP || dtype == DTYPE_SEPARATOR || dtype == DTYPE_BUTTON)
+      continue;
+    entries.push_back(std::make_pair(id, *bc));
+  }
+  src->BrowseFree(handle);
+
+  LONG count = 0;
+  for (auto& entry : entries)
+  {
+    BaseContainer& desc = entry.second;
+    String name = node->GetName() + ": " + desc.GetString(DESC_NAME);
+    desc.SetString(DESC_NAME, name);
+    desc.SetString(DESC_SHORT_NAME, name);
+    desc.RemoveData(DESC_PARENTGROUP);
+
+    DescID local = dst->Alloc(desc);
+    if (local.GetDepth() == 0) continue;
+
+    GeData value;
+    if (node->GetParameter(entry.first, value, DESCFLAGS_GET_0))
+      op->SetParameter(local, value, DESCFLAGS_SET_0);
+    if (list.Add(node, entry.first, local))
+      count++;
+  }
+  return count;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+LONG PromoteActiveUserdata(BaseObject* op, PromotedParameterList& list)
+{
+  BaseDocument* doc = op->GetDocument();
+  if (!doc) return 0;
+
+  AutoAlloc<AtomArray> arr;
+  if (!arr) return 0;
+  doc->GetActiveObjects(arr, GETACTIVEOBJECTFLAGS_CHILDREN);
+  doc->GetActiveTags(arr);
+
+  LONG count = 0;
+  for (LONG i=0; i < arr->GetCount(); i++)
+  {
+    BaseList2D* node = static_cast<BaseList2D*>(arr->GetIndex(i));
+    if (!node || node == op || !IsInHierarchy(op, node)) continue;
+    count += PromoteUserdata(op, node, list);
+  }
+  return count;
+}
@@ -0,0 +1,90 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file PromotedParameters.h
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+#include <vector>
+
+/// ***************************************************************************
+/// A user-data parameter of a container that is bound to a parameter of
+/// a node in the container's hierarchy. Setting the user-data value on the
+/// container forwards the value to the bound parameter, so locked rigs can
+/// still be controlled from the container.
+///
+/// The target node is stored as a #BaseLink, but it is only looked up when
+/// the document hierarchy changed since the last resolve. Until then, the
+/// resolved pointer is reused as is.
+/// ***************************************************************************
+struct PromotedParameter
+{
+  BaseLink* link;         ///< The node that owns the target parameter.
+  DescID target;          ///< The parameter on the target node.
+  DescID local;           ///< The user-data parameter on the container.
+
+  BaseList2D* cachedNode; ///< Resolved target node, see #cachedStamp.
+  LLONG cachedStamp;      ///< Document hierarchy stamp at resolve time.
+  ULONG cachedDescDirty;  ///< Description dirty count of #cachedNode.
+  Bool cachedValid;       ///< \c true if #target exists on #cachedNode.
+};
+
+/// ***************************************************************************
+/// The list of promoted parameters of a container.
+/// ***************************************************************************
+class PromotedParameterList
+{
+  std::vector<PromotedParameter> m_params;
+
+  PromotedParameterList(PromotedParameterList const&);
+  PromotedParameterList& operator = (PromotedParameterList const&);
+
+public:
+
+  PromotedParameterList() { }
+  ~PromotedParameterList() { Flush(); }
+
+  /// Removes all bindings.
+  void Flush();
+
+  /// Returns the number of bindings.
+  LONG GetCount() const { return (LONG) m_params.size(); }
+
+  /// Binds the user-data parameter \p local of the container to the
+  /// parameter \p target of \p node. An existing binding for \p local
+  /// is replaced.
+  Bool Add(BaseList2D* node, DescID const& target, DescID const& local);
+
+  /// Returns the binding for the container parameter \p local or
+  /// \c nullptr if there is none.
+  PromotedParameter* Find(DescID const& local);
+
+  /// Returns the target node of \p param or \c nullptr if it can not be
+  /// resolved. The result is cached until the hierarchy of \p doc changes.
+  BaseList2D* Resolve(PromotedParameter& param, BaseDocument* doc);
+
+  /// Forwards \p data to the target of the binding for \p local.
+  /// Returns \c false if there is no such binding or it can not be
+  /// resolved.
+  Bool Forward(BaseDocument* doc, DescID const& local, GeData const& data);
+
+  /// Removes all bindings whose user-data parameter no longer exists
+  /// on the container \p op.
+  void Prune(BaseList2D* op);
+
+  Bool Read(HyperFile* hf);
+  Bool Write(HyperFile* hf) const;
+  Bool CopyTo(PromotedParameterList& dest, COPYFLAGS flags, AliasTrans* at) const;
+};
+
+/// ***************************************************************************
+/// Promotes all user-data parameters of the active objects and tags that
+/// are in the hierarchy of \p op. For each parameter, a matching user-data
+/// parameter is created on \p op and bound to the original parameter.
+/// Returns the number of promoted parameters.
+/// ***************************************************************************
+LONG PromoteActiveUserdata(BaseObject* op, PromotedParameterList& list);
@@ -0,0 +1,88 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file SelectionSummary.cpp
+
+#include "SelectionSummary.h"
+#include "res/c4d_symbols.h"
+#include <Ocontainer.h>
+
+enum
+{
+  ID_SELECTIONSUMMARY = 1036117,
+};
+
+// Only accessed from the main thread.
+static SelectionSummary g_summary;
+static BaseDocument* g_document = nullptr;
+static BaseObject* g_active = nullptr;
+static Bool g_valid = false;
+
+/// ***************************************************************************
+/// ***************************************************************************
+SelectionSummary const& GetSelectionSummary(BaseDocument* doc)
+{
+  // The active object is compared as well, in case the state is asked
+  // for before the change was delivered to the message plugin.
+  BaseObject* active = doc ? doc->GetActiveObject() : nullptr;
+  if (g_valid && g_document == doc && g_active == active)
+    return g_summary;
+
+  g_summary = SelectionSummary();
+  g_document = doc;
+  g_active = active;
+  g_valid = true;
+
+  AutoAlloc<AtomArray> selection;
+  if (!doc || !selection) return g_summary;
+  doc->GetActiveObjects(selection, GETACTIVEOBJECTFLAGS_0);
+  const LONG count = selection->GetCount();
+  for (LONG i=0; i < count; i++)
+  {
+    BaseObject* op = static_cast<BaseObject*>(selection->GetIndex(i));
+    if (!op) continue;
+    g_summary.objects++;
+    if (op->IsInstanceOf(Ocontainer))
+      g_summary.containers++;
+    else if (op->IsInstanceOf(Onull))
+      g_summary.nulls++;
+  }
+  if (g_summary.objects == 1)
+    g_summary.single = static_cast<BaseObject*>(selection->GetIndex(0));
+  return g_summary;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void SelectionSummaryInvalidate()
+{
+  g_valid = false;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+class SelectionSummaryMessage : public MessageData
+{
+public:
+
+  virtual Bool CoreMessage(LONG id, const BaseContainer& bc)
+  {
+    if (id == EVMSG_CHANGE)
+      SelectionSummaryInvalidate();
+    return true;
+  }
+
+};
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool RegisterSelectionSummary()
+{
+  return RegisterMessagePlugin(
+    ID_SELECTIONSUMMARY,
+    GeLoadString(IDS_SELECTIONSUMMARY),
+    0,
+    gNew(SelectionSummaryMessage));
+}
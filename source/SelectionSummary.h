@@ -0,0 +1,43 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file SelectionSummary.h
+///
+/// The commands are asked for their state on every menu and toolbar
+/// refresh. Instead of inspecting the selection each time, they read a
+/// summary of it that is only computed again after the selection could
+/// have changed.
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+
+/// ***************************************************************************
+/// ***************************************************************************
+struct SelectionSummary
+{
+  LONG objects;               ///< Number of selected objects.
+  LONG nulls;                 ///< Selected Null-Objects.
+  LONG containers;            ///< Selected containers.
+  BaseObject* single;         ///< The selected object if only one is selected.
+};
+
+/// ***************************************************************************
+/// Returns the summary of the object selection of \p doc. Must be called
+/// from the main thread.
+/// ***************************************************************************
+SelectionSummary const& GetSelectionSummary(BaseDocument* doc);
+
+/// ***************************************************************************
+/// Marks the summary as outdated. Called on EVMSG_CHANGE and by commands
+/// that change the selection.
+/// ***************************************************************************
+void SelectionSummaryInvalidate();
+
+/// ***************************************************************************
+/// Registers the message plugin that invalidates the summary.
+/// ***************************************************************************
+Bool RegisterSelectionSummary();
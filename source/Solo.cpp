@@ -0,0 +1,161 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Solo.cpp
+
+#include "Solo.h"
+#include "ContainerIndex.h"
+#include <unordered_set>
+
+static const LONG SOLO_EDITORMODE = 1000;
+static const LONG SOLO_PATH = 1001;   ///< The object leads to a soloed container.
+
+/// ***************************************************************************
+/// ***************************************************************************
+void SoloGetSelection(BaseDocument* doc, std::vector<BaseObject*>& out)
+{
+  std::vector<BaseObject*> containers;
+  ContainerIndexGetAll(doc, containers);
+  for (BaseObject* op : containers)
+  {
+    if (op->GetBit(BIT_ACTIVE))
+      out.push_back(op);
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool SoloIsActive(BaseDocument* doc)
+{
+  BaseContainer const* bc = doc ? doc->GetDataInstance() : nullptr;
+  return bc && bc->GetBool(CONTAINEROBJECT_SOLO);
+}
+
+/// ***************************************************************************
+/// Stores the solo state of \p op.
+/// ***************************************************************************
+static void MarkObject(BaseObject* op, BaseDocument* doc, Bool path)
+{
+  BaseContainer* bc = op->GetDataInstance();
+  if (!bc || bc->GetContainerInstance(CONTAINEROBJECT_SOLO)) return;
+  doc->AddUndo(UNDOTYPE_CHANGE_SMALL, op);
+  BaseContainer state;
+  if (path)
+    state.SetBool(SOLO_PATH, true);
+  else
+  {
+    state.SetLong(SOLO_EDITORMODE, op->GetEditorMode());
+    op->SetEditorMode(MODE_OFF);
+  }
+  bc->SetContainer(CONTAINEROBJECT_SOLO, state);
+}
+
+/// ***************************************************************************
+/// Sets the solo flag of \p doc.
+/// ***************************************************************************
+static void SetDocumentSolo(BaseDocument* doc, Bool solo)
+{
+  BaseContainer* bc = doc->GetDataInstance();
+  if (!bc || bc->GetBool(CONTAINEROBJECT_SOLO) == solo) return;
+  doc->AddUndo(UNDOTYPE_CHANGE_SMALL, doc);
+  if (solo)
+    bc->SetBool(CONTAINEROBJECT_SOLO, true);
+  else
+    bc->RemoveData(CONTAINEROBJECT_SOLO);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+LONG SoloContainers(BaseDocument* doc, std::vector<BaseObject*> const& containers)
+{
+  if (!doc || containers.empty()) return 0;
+  SoloRestore(doc);
+
+  // The containers and all of their parents stay visible. Containers
+  // inside of another soloed container are visible with it.
+  std::unordered_set<BaseObject*> selected(containers.begin(), containers.end());
+  std::unordered_set<BaseObject*> keep;
+  for (BaseObject* op : containers)
+  {
+    Bool nested = false;
+    for (BaseObject* up = op->GetUp(); up && !nested; up = up->GetUp())
+      nested = selected.count(up) != 0;
+    if (nested) continue;
+    for (BaseObject* up = op; up; up = up->GetUp())
+    {
+      if (!keep.insert(up).second) break;
+    }
+  }
+
+  // Switch off the other objects on the levels of the kept objects,
+  // nullptr is the top level of the document.
+  std::unordered_set<BaseObject*> levels;
+  for (BaseObject* op : keep)
+    levels.insert(op->GetUp());
+
+  LONG count = 0;
+  for (BaseObject* parent : levels)
+  {
+    if (parent)
+      MarkObject(parent, doc, true);
+    BaseObject* op = parent ? parent->GetDown() : doc->GetFirstObject();
+    for (; op; op = op->GetNext())
+    {
+      if (keep.count(op)) continue;
+      MarkObject(op, doc, false);
+      count++;
+    }
+  }
+  SetDocumentSolo(doc, true);
+  return count;
+}
+
+/// ***************************************************************************
+/// Restores the solo state of \p op. Returns \c false if it has none,
+/// \p path is set if it leads to a soloed container.
+/// ***************************************************************************
+static Bool RestoreObject(BaseObject* op, BaseDocument* doc, Bool& path)
+{
+  BaseContainer* bc = op->GetDataInstance();
+  BaseContainer const* state = bc ? bc->GetContainerInstance(CONTAINEROBJECT_SOLO) : nullptr;
+  if (!state) return false;
+  doc->AddUndo(UNDOTYPE_CHANGE_SMALL, op);
+  path = state->GetBool(SOLO_PATH);
+  if (!path)
+    op->SetEditorMode(state->GetLong(SOLO_EDITORMODE, MODE_UNDEF));
+  bc->RemoveData(CONTAINEROBJECT_SOLO);
+  return true;
+}
+
+/// ***************************************************************************
+/// Restores the objects in the list starting at \p op and below the
+/// objects that lead to soloed containers.
+/// ***************************************************************************
+static LONG RestoreLevel(BaseObject* op, BaseDocument* doc)
+{
+  LONG count = 0;
+  for (; op; op = op->GetNext())
+  {
+    Bool path = false;
+    if (!RestoreObject(op, doc, path)) continue;
+    if (path)
+    {
+      count += RestoreLevel(op->GetDown(), doc);
+      continue;
+    }
+    count++;
+  }
+  return count;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+LONG SoloRestore(BaseDocument* doc)
+{
+  if (!SoloIsActive(doc)) return 0;
+  LONG count = RestoreLevel(doc->GetFirstObject(), doc);
+  SetDocumentSolo(doc, false);
+  return count;
+}
@@ -0,0 +1,53 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Solo.h
+///
+/// Isolates containers in the viewport. Instead of flagging every object
+/// of the document, only the siblings of the containers and of their
+/// parents are switched off in the editor. Their children inherit the
+/// editor mode, so whole branches are hidden with a single change and the
+/// undo step only holds the switched objects. Children that are switched
+/// on explicitly don't inherit it and stay visible, finding them would
+/// take a walk over the hidden branches on every toggle.
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+#include <vector>
+
+enum
+{
+  /// Sub-container on the objects switched by SoloContainers(). It stores
+  /// their editor mode. Also set on the document while it is soloed.
+  CONTAINEROBJECT_SOLO = 1036116,
+};
+
+/// ***************************************************************************
+/// Adds the selected containers of \p doc to \p out. The containers are
+/// taken from the container index, the document is not traversed.
+/// ***************************************************************************
+void SoloGetSelection(BaseDocument* doc, std::vector<BaseObject*>& out);
+
+/// ***************************************************************************
+/// Returns \c true if \p doc has soloed containers.
+/// ***************************************************************************
+Bool SoloIsActive(BaseDocument* doc);
+
+/// ***************************************************************************
+/// Hides everything in \p doc except for \p containers and their parents,
+/// replacing a previous solo. Undos are added to \p doc. Returns the
+/// number of hidden objects.
+/// ***************************************************************************
+LONG SoloContainers(BaseDocument* doc, std::vector<BaseObject*> const& containers);
+
+/// ***************************************************************************
+/// Restores the objects hidden by SoloContainers(). Only the branches
+/// that lead to the soloed containers are visited, objects that were moved
+/// out of them keep their solo state. Returns the number of restored
+/// objects.
+/// ***************************************************************************
+LONG SoloRestore(BaseDocument* doc);
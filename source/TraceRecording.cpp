@@ -0,0 +1,36 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file TraceRecording.cpp
+
+#include "TraceRecording.h"
+#include "Preferences.h"
+#include "Utils/Misc.h"
+#include "Utils/TraceFile.h"
+
+/// ***************************************************************************
+/// ***************************************************************************
+Filename GetTraceFilename()
+{
+  return GeGetC4DPath(C4D_PATH_PREFS) + Filename("container-object.trace");
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void TraceRecordingUpdate()
+{
+  Bool record = GetPrefBool(PREF_RECORD_TRACE);
+  if (record == (Bool) TraceIsActive()) return;
+  if (!record)
+  {
+    TraceStop();
+    return;
+  }
+  String filename = GetTraceFilename().GetString();
+  if (TraceStart(ToStdString(filename)))
+    GePrint("Container Object: recording trace to " + filename);
+  else
+    GePrint("Container Object: could not create " + filename);
+}
@@ -0,0 +1,27 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file TraceRecording.h
+///
+/// While the #PREF_RECORD_TRACE preference is enabled, the calls Cinema 4D
+/// makes into the container object are recorded to a trace file in the
+/// preferences folder (see Utils/TraceFile.h). Analyse it with the
+/// `replay` tool.
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+
+/// ***************************************************************************
+/// Returns the file that traces are recorded to.
+/// ***************************************************************************
+Filename GetTraceFilename();
+
+/// ***************************************************************************
+/// Starts or stops recording to match the preference. A recording that
+/// is started replaces the previous trace.
+/// ***************************************************************************
+void TraceRecordingUpdate();
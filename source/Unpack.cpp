@@ -0,0 +1,194 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Unpack.cpp
+
+#include "Unpack.h"
+#include "ContainerObject.h"
+#include "Utils/Misc.h"
+#include "res/c4d_symbols.h"
+#include <vector>
+
+enum
+{
+  ID_PROGRESSIVEUNPACK = 1036111,
+};
+
+/// Hierarchies with less objects are revealed at once.
+static const LONG MIN_OBJECTS = 2000;
+
+/// Milliseconds spent per time slice, and between slices.
+static const LONG SLICE_TIME = 15;
+static const LONG SLICE_INTERVAL = 10;
+
+/// ***************************************************************************
+/// A container whose hierarchy is being revealed. The cursor is only valid
+/// as long as the object hierarchy of the document did not change, the
+/// traversal starts over otherwise.
+/// ***************************************************************************
+struct UnpackJob
+{
+  BaseLink* link;
+  LONG levels;
+  BaseObject* cursor;
+  LONG stamp;
+  LONG done;
+  LONG total;
+};
+
+// Only accessed from the main thread.
+static std::vector<UnpackJob> g_jobs;
+
+/// ***************************************************************************
+/// Returns the level of \p op below \p root, starting at 1 for children.
+/// ***************************************************************************
+static LONG GetLevel(BaseObject* op, BaseObject* root)
+{
+  LONG level = 0;
+  for (; op && op != root; op = op->GetUp())
+    level++;
+  return level;
+}
+
+/// ***************************************************************************
+/// Continues revealing the hierarchy of \p job until \p deadline is
+/// reached. Returns \c true when the job is finished.
+/// ***************************************************************************
+static Bool ProcessJob(UnpackJob& job, LONG deadline)
+{
+  BaseObject* root = static_cast<BaseObject*>(job.link->ForceGetLink());
+  if (!root || ContainerIsProtected(root)) return true;
+  BaseDocument* doc = root->GetDocument();
+  if (!doc) return true;
+
+  if ((LONG) doc->GetHDirty(HDIRTYFLAGS_OBJECT_HIERARCHY) != job.stamp)
+    job.cursor = root->GetDown();
+
+  BaseObject* op = job.cursor;
+  LONG count = 0;
+  while (op)
+  {
+    if (GetLevel(op, root) > job.levels)
+    {
+      ContainerHideNode(op, false);
+      job.done++;
+    }
+    op = GetNextNode(op, root, !ContainerIsSealed(op));
+    if ((++count & 255) == 0 && GeGetTimer() >= deadline)
+      break;
+  }
+
+  job.cursor = op;
+  job.stamp = (LONG) doc->GetHDirty(HDIRTYFLAGS_OBJECT_HIERARCHY);
+  return op == nullptr;
+}
+
+/// ***************************************************************************
+/// Processes one time slice of all jobs and updates the progress bar.
+/// ***************************************************************************
+static void ProcessSlice()
+{
+  LONG deadline = GeGetTimer() + SLICE_TIME;
+  LONG done = 0, total = 0;
+  for (auto it = g_jobs.begin(); it != g_jobs.end(); )
+  {
+    if (GeGetTimer() < deadline && ProcessJob(*it, deadline))
+    {
+      BaseLink::Free(it->link);
+      it = g_jobs.erase(it);
+      continue;
+    }
+    done += it->done;
+    total += it->total;
+    ++it;
+  }
+
+  if (g_jobs.empty())
+    StatusClear();
+  else
+  {
+    StatusSetText(GeLoadString(IDS_STATUS_UNPACKING));
+    // Restarted traversals count objects twice, never show 100% early.
+    LONG percent = total > 0 ? (LONG) (done * 100.0 / total) : 0;
+    StatusSetBar(percent > 99 ? 99 : percent);
+  }
+  EventAdd();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool ProgressiveUnpackStart(BaseObject* op, LONG levels)
+{
+  BaseDocument* doc = op->GetDocument();
+  if (!doc) return false;
+
+  LONG total = 0;
+  for (NodeIterator<BaseObject> it(op->GetDown(), op); it; ++it)
+    total++;
+  if (total < MIN_OBJECTS) return false;
+
+  ProgressiveUnpackCancel(op);
+  UnpackJob job;
+  job.link = BaseLink::Alloc();
+  if (!job.link) return false;
+  job.link->SetLink(op);
+  job.levels = levels;
+  job.cursor = op->GetDown();
+  job.stamp = (LONG) doc->GetHDirty(HDIRTYFLAGS_OBJECT_HIERARCHY);
+  job.done = 0;
+  job.total = total;
+  g_jobs.push_back(job);
+
+  // Wake up the message plugin so it asks for the timer again.
+  SpecialEventAdd(ID_PROGRESSIVEUNPACK);
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void ProgressiveUnpackCancel(BaseObject* op)
+{
+  for (auto it = g_jobs.begin(); it != g_jobs.end(); )
+  {
+    if (!op || it->link->ForceGetLink() == op)
+    {
+      BaseLink::Free(it->link);
+      it = g_jobs.erase(it);
+    }
+    else
+      ++it;
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+class ProgressiveUnpackMessage : public MessageData
+{
+public:
+
+  virtual LONG GetTimer()
+  {
+    return g_jobs.empty() ? 0 : SLICE_INTERVAL;
+  }
+
+  virtual Bool CoreMessage(LONG id, const BaseContainer& bc)
+  {
+    if ((id == MSG_TIMER || id == ID_PROGRESSIVEUNPACK) && !g_jobs.empty())
+      ProcessSlice();
+    return true;
+  }
+
+};
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool RegisterProgressiveUnpack()
+{
+  return RegisterMessagePlugin(
+    ID_PROGRESSIVEUNPACK,
+    GeLoadString(IDS_STATUS_UNPACKING),
+    0,
+    gNew(ProgressiveUnpackMessage));
+}
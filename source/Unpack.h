@@ -0,0 +1,40 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Unpack.h
+///
+/// Reveals the hierarchy of large unlocked containers in time slices from
+/// a timer, so the editor stays responsive while the object manager
+/// catches up with tens of thousands of nodes.
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+
+enum
+{
+  /// Number of hierarchy levels revealed immediately when a container is
+  /// unpacked progressively.
+  PROGRESSIVE_UNPACK_LEVELS = 2,
+};
+
+/// ***************************************************************************
+/// Starts revealing the hierarchy of \p op below the first \p levels
+/// levels in the background. Returns \c false if the hierarchy is small
+/// enough to be revealed at once, in which case nothing happens.
+/// ***************************************************************************
+Bool ProgressiveUnpackStart(BaseObject* op, LONG levels);
+
+/// ***************************************************************************
+/// Stops revealing the hierarchy of \p op, or of all containers if \p op
+/// is \c nullptr.
+/// ***************************************************************************
+void ProgressiveUnpackCancel(BaseObject* op);
+
+/// ***************************************************************************
+/// Registers the message plugin that processes the time slices.
+/// ***************************************************************************
+Bool RegisterProgressiveUnpack();
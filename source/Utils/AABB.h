@@ -48,6 +48,11 @@ class AABB
     detailed_measuring = detailed;
   }
 
+  /// Returns \c true if at least one point was added to the AABB.
+  inline Bool IsInitialized() const {
+    return is_init;
+  }
+
   /// Obtain the results by storing it into the passed references.
   inline void GetResult(Vector& bbmin, Vector& bbmax) const {
     bbmin = mm.GetMax();
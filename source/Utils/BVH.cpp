@@ -0,0 +1,156 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/BVH.cpp
+
+#include "BVH.h"
+#include <algorithm>
+
+/// ***************************************************************************
+/// ***************************************************************************
+static BVHBounds Union(BVHBounds const& a, BVHBounds const& b)
+{
+  BVHBounds result;
+  result.bbmin = Vector(std::min(a.bbmin.x, b.bbmin.x), std::min(a.bbmin.y, b.bbmin.y), std::min(a.bbmin.z, b.bbmin.z));
+  result.bbmax = Vector(std::max(a.bbmax.x, b.bbmax.x), std::max(a.bbmax.y, b.bbmax.y), std::max(a.bbmax.z, b.bbmax.z));
+  return result;
+}
+
+/// ***************************************************************************
+/// Returns \c true if \p box is completely outside of \p plane.
+/// ***************************************************************************
+static Bool IsOutside(BVHPlane const& plane, BVHBounds const& box)
+{
+  // Test the corner that is furthest along the plane normal.
+  Vector p(
+    plane.normal.x >= 0 ? box.bbmax.x : box.bbmin.x,
+    plane.normal.y >= 0 ? box.bbmax.y : box.bbmin.y,
+    plane.normal.z >= 0 ? box.bbmax.z : box.bbmin.z);
+  return plane.normal.x * p.x + plane.normal.y * p.y + plane.normal.z * p.z + plane.d < 0;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+LONG BVH::BuildRecursive(std::vector<BVHBounds> const& items,
+    std::vector<LONG>& indices, LONG begin, LONG end, LONG parent)
+{
+  LONG index = (LONG) m_nodes.size();
+  m_nodes.push_back(Node());
+  m_nodes[index].parent = parent;
+
+  if (end - begin == 1)
+  {
+    LONG item = indices[begin];
+    m_nodes[index].bounds = items[item];
+    m_nodes[index].left = -1;
+    m_nodes[index].right = item;
+    m_leaves[item] = index;
+    return index;
+  }
+
+  // Split at the median of the box centers along the longest axis.
+  Vector first = (items[indices[begin]].bbmin + items[indices[begin]].bbmax) * 0.5;
+  BVHBounds centers(first, first);
+  for (LONG i=begin + 1; i < end; i++)
+  {
+    Vector c = (items[indices[i]].bbmin + items[indices[i]].bbmax) * 0.5;
+    centers = Union(centers, BVHBounds(c, c));
+  }
+  Vector extent = centers.bbmax - centers.bbmin;
+  LONG axis = 0;
+  if (extent.y > extent.x) axis = 1;
+  if (extent.z > (axis == 0 ? extent.x : extent.y)) axis = 2;
+
+  LONG mid = begin + (end - begin) / 2;
+  std::nth_element(indices.begin() + begin, indices.begin() + mid, indices.begin() + end,
+    [&items, axis](LONG a, LONG b) {
+      Vector ca = items[a].bbmin + items[a].bbmax;
+      Vector cb = items[b].bbmin + items[b].bbmax;
+      return (axis == 0 ? ca.x < cb.x : (axis == 1 ? ca.y < cb.y : ca.z < cb.z));
+    });
+
+  LONG left = BuildRecursive(items, indices, begin, mid, index);
+  LONG right = BuildRecursive(items, indices, mid, end, index);
+  m_nodes[index].left = left;
+  m_nodes[index].right = right;
+  m_nodes[index].bounds = Union(m_nodes[left].bounds, m_nodes[right].bounds);
+  return index;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void BVH::Build(std::vector<BVHBounds> const& items)
+{
+  Flush();
+  if (items.empty()) return;
+  std::vector<LONG> indices(items.size());
+  for (size_t i=0; i < items.size(); i++)
+    indices[i] = (LONG) i;
+  m_nodes.reserve(items.size() * 2);
+  m_leaves.resize(items.size());
+  BuildRecursive(items, indices, 0, (LONG) items.size(), -1);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void BVH::Refit(LONG item, BVHBounds const& bounds)
+{
+  if (item < 0 || item >= (LONG) m_leaves.size()) return;
+  LONG index = m_leaves[item];
+  m_nodes[index].bounds = bounds;
+  for (index = m_nodes[index].parent; index >= 0; index = m_nodes[index].parent)
+  {
+    Node& node = m_nodes[index];
+    node.bounds = Union(m_nodes[node.left].bounds, m_nodes[node.right].bounds);
+  }
+  m_refits++;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void BVH::QueryBox(BVHBounds const& box, std::vector<LONG>& out) const
+{
+  if (m_nodes.empty()) return;
+  LONG stack[64];
+  LONG size = 0;
+  stack[size++] = 0;
+  while (size > 0)
+  {
+    Node const& node = m_nodes[stack[--size]];
+    if (!node.bounds.Intersects(box)) continue;
+    if (node.left < 0)
+      out.push_back(node.right);
+    else
+    {
+      stack[size++] = node.left;
+      stack[size++] = node.right;
+    }
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void BVH::QueryPlanes(BVHPlane const* planes, LONG count, std::vector<LONG>& out) const
+{
+  if (m_nodes.empty()) return;
+  LONG stack[64];
+  LONG size = 0;
+  stack[size++] = 0;
+  while (size > 0)
+  {
+    Node const& node = m_nodes[stack[--size]];
+    Bool outside = false;
+    for (LONG i=0; i < count && !outside; i++)
+      outside = IsOutside(planes[i], node.bounds);
+    if (outside) continue;
+    if (node.left < 0)
+      out.push_back(node.right);
+    else
+    {
+      stack[size++] = node.left;
+      stack[size++] = node.right;
+    }
+  }
+}
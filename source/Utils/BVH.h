@@ -0,0 +1,91 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/BVH.h
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+#include <vector>
+
+/// ***************************************************************************
+/// An axis-aligned box given by its minimum and maximum corner.
+/// ***************************************************************************
+struct BVHBounds
+{
+  Vector bbmin;
+  Vector bbmax;
+
+  BVHBounds() { }
+  BVHBounds(Vector const& bbmin, Vector const& bbmax) : bbmin(bbmin), bbmax(bbmax) { }
+
+  Bool Intersects(BVHBounds const& other) const
+  {
+    return bbmin.x <= other.bbmax.x && bbmax.x >= other.bbmin.x &&
+           bbmin.y <= other.bbmax.y && bbmax.y >= other.bbmin.y &&
+           bbmin.z <= other.bbmax.z && bbmax.z >= other.bbmin.z;
+  }
+};
+
+/// ***************************************************************************
+/// A plane, points \c p with `Dot(normal, p) + d >= 0` are on its inner side.
+/// ***************************************************************************
+struct BVHPlane
+{
+  Vector normal;
+  Real d;
+};
+
+/// ***************************************************************************
+/// A bounding volume hierarchy over a set of boxes. Items are identified
+/// by their index in the array passed to #Build(). Changed item bounds
+/// are applied with #Refit(), which only updates the ancestors of the item.
+/// ***************************************************************************
+class BVH
+{
+  struct Node
+  {
+    BVHBounds bounds;
+    LONG parent;
+    LONG left;    ///< Index of the left child, or -1 for leaves.
+    LONG right;   ///< Index of the right child, or the item index for leaves.
+  };
+
+  std::vector<Node> m_nodes;
+  std::vector<LONG> m_leaves;   ///< Leaf node index of every item.
+  LONG m_refits;
+
+  LONG BuildRecursive(std::vector<BVHBounds> const& items,
+      std::vector<LONG>& indices, LONG begin, LONG end, LONG parent);
+
+public:
+
+  BVH() : m_refits(0) { }
+
+  /// Builds the hierarchy over \p items.
+  void Build(std::vector<BVHBounds> const& items);
+
+  /// Removes all items.
+  void Flush() { m_nodes.clear(); m_leaves.clear(); m_refits = 0; }
+
+  /// Returns the number of items.
+  LONG GetCount() const { return (LONG) m_leaves.size(); }
+
+  /// Returns the number of #Refit() calls since the last #Build(). The
+  /// hierarchy gets looser with every refit, callers should rebuild it
+  /// when this gets large compared to #GetCount().
+  LONG GetRefitCount() const { return m_refits; }
+
+  /// Changes the bounds of the item \p item.
+  void Refit(LONG item, BVHBounds const& bounds);
+
+  /// Adds the indices of all items that intersect \p box to \p out.
+  void QueryBox(BVHBounds const& box, std::vector<LONG>& out) const;
+
+  /// Adds the indices of all items that are not completely outside of
+  /// any of the \p count planes to \p out.
+  void QueryPlanes(BVHPlane const* planes, LONG count, std::vector<LONG>& out) const;
+};
@@ -0,0 +1,178 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/CatalogFile.cpp
+
+#include "CatalogFile.h"
+#include <cstdio>
+#include <cstring>
+
+static const char MAGIC[4] = {'N', 'R', 'C', 'C'};
+static const uint32_t VERSION = 2;
+
+/// ***************************************************************************
+/// ***************************************************************************
+static void PutU32(std::vector<uint8_t>& out, uint32_t value)
+{
+  for (int i=0; i < 4; i++)
+    out.push_back((uint8_t) (value >> (8 * i)));
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+static void PutBytes(std::vector<uint8_t>& out, const void* data, size_t size)
+{
+  PutU32(out, (uint32_t) size);
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  out.insert(out.end(), bytes, bytes + size);
+}
+
+/// ***************************************************************************
+/// Reads from a bounds-checked buffer. All reads fail once one failed.
+/// ***************************************************************************
+class Reader
+{
+  const uint8_t* m_data;
+  size_t m_size;
+  size_t m_pos;
+  bool m_ok;
+
+public:
+
+  Reader(const uint8_t* data, size_t size) : m_data(data), m_size(size), m_pos(0), m_ok(true) { }
+
+  bool IsOk() const { return m_ok; }
+
+  const uint8_t* Take(size_t size)
+  {
+    if (!m_ok || m_size - m_pos < size)
+    {
+      m_ok = false;
+      return nullptr;
+    }
+    const uint8_t* p = m_data + m_pos;
+    m_pos += size;
+    return p;
+  }
+
+  uint32_t U32()
+  {
+    const uint8_t* p = Take(4);
+    if (!p) return 0;
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+  }
+
+  void String(std::string& out)
+  {
+    uint32_t size = U32();
+    const uint8_t* p = Take(size);
+    if (p) out.assign(reinterpret_cast<const char*>(p), size);
+  }
+
+  void Bytes(std::vector<uint8_t>& out)
+  {
+    uint32_t size = U32();
+    const uint8_t* p = Take(size);
+    if (p) out.assign(p, p + size);
+  }
+};
+
+/// ***************************************************************************
+/// ***************************************************************************
+void CatalogEncode(std::vector<CatalogEntry> const& entries, std::vector<uint8_t>& out)
+{
+  out.insert(out.end(), MAGIC, MAGIC + 4);
+  PutU32(out, VERSION);
+  PutU32(out, (uint32_t) entries.size());
+  for (CatalogEntry const& entry : entries)
+  {
+    std::string const* strings[] = {
+      &entry.path, &entry.name, &entry.version, &entry.url, &entry.author,
+      &entry.authorEmail, &entry.description, &entry.fingerprint};
+    for (std::string const* str : strings)
+      PutBytes(out, str->data(), str->size());
+    PutU32(out, entry.flags);
+    PutBytes(out, entry.icon.data(), entry.icon.size());
+    PutU32(out, (uint32_t) entry.files.size());
+    for (std::string const& file : entry.files)
+      PutBytes(out, file.data(), file.size());
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool CatalogDecode(const uint8_t* data, size_t size, std::vector<CatalogEntry>& entries)
+{
+  Reader reader(data, size);
+  const uint8_t* magic = reader.Take(4);
+  if (!magic || memcmp(magic, MAGIC, 4) != 0) return false;
+  uint32_t version = reader.U32();
+  if (version < 1 || version > VERSION) return false;
+  uint32_t count = reader.U32();
+
+  entries.clear();
+  for (uint32_t i=0; i < count && reader.IsOk(); i++)
+  {
+    CatalogEntry entry;
+    std::string* strings[] = {
+      &entry.path, &entry.name, &entry.version, &entry.url, &entry.author,
+      &entry.authorEmail, &entry.description, &entry.fingerprint};
+    for (std::string* str : strings)
+      reader.String(*str);
+    entry.flags = reader.U32();
+    reader.Bytes(entry.icon);
+    if (version >= 2)
+    {
+      uint32_t files = reader.U32();
+      for (uint32_t j=0; j < files && reader.IsOk(); j++)
+      {
+        std::string file;
+        reader.String(file);
+        entry.files.push_back(std::move(file));
+      }
+    }
+    if (reader.IsOk())
+      entries.push_back(std::move(entry));
+  }
+  return reader.IsOk();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool CatalogWriteFile(std::string const& filename, std::vector<CatalogEntry> const& entries)
+{
+  std::vector<uint8_t> data;
+  CatalogEncode(entries, data);
+
+  std::string temp = filename + ".tmp";
+  FILE* fp = fopen(temp.c_str(), "wb");
+  if (!fp) return false;
+  bool ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+  ok = fclose(fp) == 0 && ok;
+  if (ok)
+  {
+    // rename() doesn't replace existing files on Windows.
+    remove(filename.c_str());
+    ok = rename(temp.c_str(), filename.c_str()) == 0;
+  }
+  if (!ok) remove(temp.c_str());
+  return ok;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool CatalogReadFile(std::string const& filename, std::vector<CatalogEntry>& entries)
+{
+  FILE* fp = fopen(filename.c_str(), "rb");
+  if (!fp) return false;
+  std::vector<uint8_t> data;
+  uint8_t buffer[64 * 1024];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+    data.insert(data.end(), buffer, buffer + count);
+  bool ok = !ferror(fp);
+  fclose(fp);
+  return ok && CatalogDecode(data.data(), data.size(), entries);
+}
@@ -0,0 +1,80 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/CatalogFile.h
+///
+/// The container catalog is a sidecar file next to a saved document that
+/// lists the metadata, icon and fingerprint of every container in it, so
+/// that tools can search an asset library without loading documents.
+/// Does not depend on the Cinema 4D API.
+///
+/// Layout, all integers little endian:
+///
+///     char[4]  magic "NRCC"
+///     u32      version (2)
+///     u32      number of entries
+///     entry*   entries
+///
+/// Every entry is a sequence of fields. Strings and byte arrays are a u32
+/// length followed by the bytes, strings are UTF-8:
+///
+///     string   path of the container in the document, names joined by '/'
+///     string   name, version, url, author, author email, description
+///     string   fingerprint of the container's contents
+///     u32      flags, see #CATALOGFLAG
+///     bytes    icon in the format of Utils/IconCodec.h, may be empty
+///     u32      number of files (version 2)
+///     string*  files the container and its external dependencies reference
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Extension appended to the document filename for the catalog.
+#define CATALOG_EXTENSION ".containers"
+
+enum CATALOGFLAG
+{
+  CATALOGFLAG_PROTECTED = 1 << 0,
+};
+
+/// ***************************************************************************
+/// ***************************************************************************
+struct CatalogEntry
+{
+  std::string path;
+  std::string name;
+  std::string version;
+  std::string url;
+  std::string author;
+  std::string authorEmail;
+  std::string description;
+  std::string fingerprint;
+  uint32_t flags;
+  std::vector<uint8_t> icon;
+  std::vector<std::string> files;
+
+  CatalogEntry() : flags(0) { }
+};
+
+/// ***************************************************************************
+/// Appends the catalog of \p entries to \p out.
+/// ***************************************************************************
+void CatalogEncode(std::vector<CatalogEntry> const& entries, std::vector<uint8_t>& out);
+
+/// ***************************************************************************
+/// Parses a catalog into \p entries. Returns \c false if the data is not
+/// a valid catalog. Version 1 catalogs are read with empty file lists.
+/// ***************************************************************************
+bool CatalogDecode(const uint8_t* data, size_t size, std::vector<CatalogEntry>& entries);
+
+/// ***************************************************************************
+/// Writes and reads catalog files. Writing goes to a temporary file that
+/// replaces \p filename when complete.
+/// ***************************************************************************
+bool CatalogWriteFile(std::string const& filename, std::vector<CatalogEntry> const& entries);
+bool CatalogReadFile(std::string const& filename, std::vector<CatalogEntry>& entries);
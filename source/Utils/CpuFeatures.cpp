@@ -0,0 +1,84 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/CpuFeatures.cpp
+
+#include "CpuFeatures.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+  #define CPUFEATURES_X86
+  #ifdef _MSC_VER
+    #include <intrin.h>
+  #else
+    #include <cpuid.h>
+  #endif
+#endif
+
+#ifdef CPUFEATURES_X86
+
+/// ***************************************************************************
+/// ***************************************************************************
+static void CpuId(int leaf, int subleaf, unsigned int regs[4])
+{
+  #ifdef _MSC_VER
+    int r[4];
+    __cpuidex(r, leaf, subleaf);
+    for (int i=0; i < 4; i++) regs[i] = (unsigned int) r[i];
+  #else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+  #endif
+}
+
+/// ***************************************************************************
+/// Returns the XCR0 register, which tells which register states the
+/// operating system saves on context switches.
+/// ***************************************************************************
+static unsigned long long GetXCR0()
+{
+  #ifdef _MSC_VER
+    return _xgetbv(0);
+  #else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long) edx << 32) | eax;
+  #endif
+}
+
+#endif
+
+/// ***************************************************************************
+/// ***************************************************************************
+CpuFeatures DetectCpuFeatures()
+{
+  CpuFeatures features = {false, false, false, false};
+  #ifdef CPUFEATURES_X86
+    unsigned int regs[4];
+    CpuId(0, 0, regs);
+    unsigned int maxLeaf = regs[0];
+    if (maxLeaf < 1) return features;
+
+    CpuId(1, 0, regs);
+    bool ssse3 = (regs[2] & (1u << 9)) != 0;
+    features.sse41 = ssse3 && (regs[2] & (1u << 19)) != 0;
+    bool osxsave = (regs[2] & (1u << 27)) != 0;
+    bool avx = (regs[2] & (1u << 28)) != 0;
+
+    unsigned long long xcr0 = osxsave ? GetXCR0() : 0;
+    bool ymmSaved = (xcr0 & 0x6) == 0x6;
+    bool zmmSaved = (xcr0 & 0xe6) == 0xe6;
+
+    if (maxLeaf >= 7)
+    {
+      CpuId(7, 0, regs);
+      features.avx2 = avx && ymmSaved && (regs[1] & (1u << 5)) != 0;
+      features.avx512 = features.avx2 && zmmSaved &&
+        (regs[1] & (1u << 16)) != 0 &&   // F
+        (regs[1] & (1u << 30)) != 0 &&   // BW
+        (regs[1] & (1u << 31)) != 0;     // VL
+      features.sha = features.sse41 && (regs[1] & (1u << 29)) != 0;
+    }
+  #endif
+  return features;
+}
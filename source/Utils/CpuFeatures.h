@@ -0,0 +1,30 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/CpuFeatures.h
+///
+/// Detects the instruction set extensions of the CPU the plugin runs on.
+/// Does not depend on the Cinema 4D API.
+
+#pragma once
+
+/// ***************************************************************************
+/// The instruction set extensions used by the kernels in Utils/Kernels.h.
+/// A feature is only reported if the operating system also saves the
+/// registers it needs.
+/// ***************************************************************************
+struct CpuFeatures
+{
+  bool sse41;
+  bool avx2;
+  bool avx512;   ///< AVX-512 F, BW and VL.
+  bool sha;      ///< SHA extensions (SHA-NI).
+};
+
+/// ***************************************************************************
+/// Queries the features of the current CPU. Returns no features on other
+/// architectures than x86-64.
+/// ***************************************************************************
+CpuFeatures DetectCpuFeatures();
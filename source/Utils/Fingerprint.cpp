@@ -0,0 +1,328 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/Fingerprint.cpp
+
+#include "Fingerprint.h"
+#include "Misc.h"
+
+/// ***************************************************************************
+/// ***************************************************************************
+void Fingerprint::IndexHierarchy(BaseObject* root)
+{
+  m_indices.clear();
+  LONG index = 0;
+  for (NodeIterator<BaseObject> it(root->GetDown(), root); it; ++it)
+  {
+    m_indices[*it] = index++;
+    for (BaseTag* tag = it->GetFirstTag(); tag; tag = tag->GetNext())
+      m_indices[tag] = index++;
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void Fingerprint::AddMatrix(const Matrix& m)
+{
+  AddVector(m.off);
+  AddVector(m.v1);
+  AddVector(m.v2);
+  AddVector(m.v3);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void Fingerprint::AddString(const String& str)
+{
+  LONG length = str.GetCStringLen(STRINGENCODING_UTF8);
+  AddLong(length);
+  if (length > 0)
+  {
+    CHAR* cstr = str.GetCStringCopy(STRINGENCODING_UTF8);
+    if (cstr) Add(cstr, length);
+    DeleteMem(cstr);
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void Fingerprint::AddData(const GeData& data)
+{
+  LONG type = data.GetType();
+  AddLong(type);
+  switch (type)
+  {
+    case DA_NIL:
+    case DA_VOID:
+      break;
+    case DA_LONG:
+      AddLong(data.GetLong());
+      break;
+    case DA_LLONG:
+      AddLLong(data.GetLLong());
+      break;
+    case DA_REAL:
+      AddReal(data.GetReal());
+      break;
+    case DA_TIME:
+      AddReal(data.GetTime().Get());
+      break;
+    case DA_VECTOR:
+      AddVector(data.GetVector());
+      break;
+    case DA_MATRIX:
+      AddMatrix(data.GetMatrix());
+      break;
+    case DA_STRING:
+      AddString(data.GetString());
+      break;
+    case DA_FILENAME:
+      AddString(data.GetFilename().GetString());
+      break;
+    case DA_CONTAINER:
+    {
+      BaseContainer* bc = data.GetContainer();
+      if (bc) AddContainer(*bc);
+      break;
+    }
+    case DA_ALIASLINK:
+    {
+      BaseLink* link = data.GetBaseLink();
+      BaseList2D* node = link ? (m_doc ? link->GetLink(m_doc) : link->ForceGetLink()) : nullptr;
+      if (!node)
+      {
+        AddLong(NOTOK);
+        break;
+      }
+      auto it = m_indices.find(node);
+      if (it != m_indices.end())
+      {
+        AddLong(0);
+        AddLong(it->second);
+      }
+      else
+      {
+        AddLong(1);
+        AddLong(node->GetType());
+        AddMarker(node->GetMarker());
+      }
+      break;
+    }
+    default:
+    {
+      // Custom data types (splines, gradients, ...) are hashed by
+      // their serialized representation.
+      AutoAlloc<MemoryFileStruct> mfs;
+      AutoAlloc<HyperFile> hf;
+      if (!mfs || !hf) break;
+      if (!hf->Open(0, mfs->GetFilename(), FILEOPEN_WRITE, FILEDIALOG_NONE)) break;
+      Bool ok = hf->WriteGeData(data);
+      hf->Close();
+      void* mem = nullptr;
+      VLONG size = 0;
+      if (ok)
+      {
+        mfs->GetData(mem, size, false);
+        if (mem && size > 0) Add(mem, (size_t) size);
+      }
+      break;
+    }
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void Fingerprint::AddMarker(const GeMarker& marker)
+{
+  void* mem = nullptr;
+  LONG size = 0;
+  marker.GetMemory(mem, size);
+  AddLong(size);
+  if (mem && size > 0) Add(mem, (size_t) size);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void Fingerprint::AddDescID(const DescID& id)
+{
+  LONG depth = id.GetDepth();
+  AddLong(depth);
+  for (LONG i=0; i < depth; i++)
+  {
+    AddLong(id[i].id);
+    AddLong(id[i].dtype);
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void Fingerprint::AddTracks(BaseList2D* node)
+{
+  for (CTrack* track = node->GetFirstCTrack(); track; track = track->GetNext())
+  {
+    AddLong(track->GetType());
+    AddDescID(track->GetDescriptionID());
+    const BaseContainer* bc = track->GetDataInstance();
+    if (bc) AddContainer(*bc);
+
+    CCurve* curve = track->GetCurve(CCURVE_CURVE, false);
+    LONG count = curve ? curve->GetKeyCount() : 0;
+    AddLong(count);
+    for (LONG i=0; i < count; i++)
+    {
+      CKey* key = curve->GetKey(i);
+      if (!key) continue;
+      AddReal(key->GetTime().Get());
+      AddReal(key->GetValue());
+      AddData(key->GetGeData());
+      AddLong(key->GetInterpolation());
+      AddReal(key->GetTimeLeft().Get());
+      AddReal(key->GetValueLeft());
+      AddReal(key->GetTimeRight().Get());
+      AddReal(key->GetValueRight());
+      const BaseContainer* kbc = key->GetDataInstance();
+      if (kbc) AddContainer(*kbc);
+    }
+  }
+  AddLong(NOTOK);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void Fingerprint::AddContainer(const BaseContainer& bc)
+{
+  AddLong(bc.GetId());
+  for (LONG i=0; ; i++)
+  {
+    LONG id = bc.GetIndexId(i);
+    if (id == NOTOK) break;
+    const GeData* data = bc.GetIndexData(i);
+    if (!data) continue;
+    AddLong(id);
+    AddData(*data);
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void Fingerprint::AddNode(BaseList2D* node)
+{
+  AddLong(node->GetType());
+  AddString(node->GetName());
+
+  const BaseContainer* bc = node->GetDataInstance();
+  if (bc) AddContainer(*bc);
+  AddTracks(node);
+
+  if (node->IsInstanceOf(Obase))
+  {
+    BaseObject* op = static_cast<BaseObject*>(node);
+    AddMatrix(op->GetMl());
+  }
+
+  if (node->IsInstanceOf(Opoint))
+  {
+    PointObject* op = static_cast<PointObject*>(node);
+    LONG count = op->GetPointCount();
+    AddLong(count);
+    const Vector* points = op->GetPointR();
+    if (points && count > 0) Add(points, sizeof(Vector) * count);
+  }
+
+  if (node->IsInstanceOf(Opolygon))
+  {
+    PolygonObject* op = static_cast<PolygonObject*>(node);
+    LONG count = op->GetPolygonCount();
+    AddLong(count);
+    const CPolygon* polys = op->GetPolygonR();
+    if (polys && count > 0) Add(polys, sizeof(CPolygon) * count);
+  }
+  else if (node->IsInstanceOf(Tvariable) && !node->IsInstanceOf(Tpoint) &&
+      !node->IsInstanceOf(Tpolygon))
+  {
+    // Point and polygon tags are covered by the object above.
+    VariableTag* tag = static_cast<VariableTag*>(node);
+    LONG count = tag->GetDataCount();
+    LONG size = tag->GetDataSize();
+    AddLong(count);
+    AddLong(size);
+    const void* data = tag->GetLowlevelDataAddressR();
+    if (data && count > 0 && size > 0) Add(data, (size_t) count * size);
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void Fingerprint::AddHierarchy(BaseObject* root)
+{
+  IndexHierarchy(root);
+  for (NodeIterator<BaseObject> it(root->GetDown(), root); it; ++it)
+  {
+    // Include the depth so that the same nodes in a different
+    // structure result in a different fingerprint.
+    LONG depth = 0;
+    for (BaseObject* up = it->GetUp(); up && up != root; up = up->GetUp())
+      depth++;
+    AddLong(depth);
+    AddNode(*it);
+    for (BaseTag* tag = it->GetFirstTag(); tag; tag = tag->GetNext())
+      AddNode(tag);
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void Fingerprint::AddStructure(BaseObject* root)
+{
+  for (NodeIterator<BaseObject> it(root->GetDown(), root); it; ++it)
+  {
+    LONG depth = 0;
+    for (BaseObject* up = it->GetUp(); up && up != root; up = up->GetUp())
+      depth++;
+    AddLong(depth);
+    AddLong(it->GetType());
+    AddString(it->GetName());
+    AddMatrix(it->GetMl());
+    AddLong(it->IsInstanceOf(Opoint) ? ToPoint(*it)->GetPointCount() : NOTOK);
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+String Fingerprint::GetHash()
+{
+  return String(m_sha.GetHash().c_str());
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+String FingerprintHierarchy(BaseObject* root)
+{
+  if (!root) return String();
+  Fingerprint fp(root->GetDocument());
+  fp.AddHierarchy(root);
+  return fp.GetHash();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+String FingerprintStructure(BaseObject* root)
+{
+  if (!root) return String();
+  Fingerprint fp(root->GetDocument());
+  fp.AddStructure(root);
+  return fp.GetHash();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+String FingerprintNode(BaseList2D* node, BaseObject* root)
+{
+  if (!node) return String();
+  Fingerprint fp(node->GetDocument());
+  if (root) fp.IndexHierarchy(root);
+  fp.AddNode(node);
+  return fp.GetHash();
+}
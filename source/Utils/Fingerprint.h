@@ -0,0 +1,88 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/Fingerprint.h
+
+#pragma once
+
+#include "Sha256.h"
+#include <c4d.h>
+#include <c4d_legacy.h>
+#include <unordered_map>
+
+/// ***************************************************************************
+/// Computes a SHA256 content fingerprint of nodes in a Cinema 4D
+/// hierarchy. Two hierarchies that have the same fingerprint have the
+/// same objects, tags, parameters, geometry and internal links.
+///
+/// Links between nodes inside the fingerprinted hierarchy are hashed by
+/// the position of the linked node in the hierarchy, links to outside
+/// nodes by their type and marker. Thus, copies of a rig have the same
+/// fingerprint as the original as long as they link the same outside
+/// nodes, and two outside nodes with the same name are told apart.
+/// ***************************************************************************
+class Fingerprint
+{
+  Sha256Hasher m_sha;
+  BaseDocument* m_doc;
+  std::unordered_map<C4DAtom*, LONG> m_indices;
+
+public:
+
+  Fingerprint(BaseDocument* doc=nullptr) : m_doc(doc) { }
+
+  /// Registers all objects and tags in the hierarchy below \p root
+  /// (excluding \p root itself) so links to them are hashed by their
+  /// position. Called by #AddHierarchy().
+  void IndexHierarchy(BaseObject* root);
+
+  void Add(const void* data, size_t size) { m_sha.Add(data, size); }
+  void AddLong(LONG value) { Add(&value, sizeof(value)); }
+  void AddLLong(LLONG value) { Add(&value, sizeof(value)); }
+  void AddReal(Real value) { Add(&value, sizeof(value)); }
+  void AddVector(const Vector& v) { AddReal(v.x); AddReal(v.y); AddReal(v.z); }
+  void AddMatrix(const Matrix& m);
+  void AddString(const String& str);
+  void AddData(const GeData& data);
+  void AddContainer(const BaseContainer& bc);
+  void AddMarker(const GeMarker& marker);
+  void AddDescID(const DescID& id);
+
+  /// Adds the animation tracks of \p node with their curves and keys.
+  void AddTracks(BaseList2D* node);
+
+  /// Adds the data of a single node: its type, name, parameters, tracks
+  /// and, for point objects and variable tags, the geometry data. The hierarchy and
+  /// branches of the node are not included.
+  void AddNode(BaseList2D* node);
+
+  /// Adds all objects and their tags in the hierarchy below \p root,
+  /// excluding \p root itself.
+  void AddHierarchy(BaseObject* root);
+
+  /// Adds the structure of the hierarchy below \p root: the type, name,
+  /// local matrix and point count of every object. Much cheaper than
+  /// #AddHierarchy(), but doesn't see changed parameters or geometry.
+  void AddStructure(BaseObject* root);
+
+  /// Returns the fingerprint as a hex string. Resets the hash state.
+  String GetHash();
+};
+
+/// ***************************************************************************
+/// Returns the fingerprint of the hierarchy below \p root.
+/// ***************************************************************************
+String FingerprintHierarchy(BaseObject* root);
+
+/// ***************************************************************************
+/// Returns the structural fingerprint of the hierarchy below \p root.
+/// ***************************************************************************
+String FingerprintStructure(BaseObject* root);
+
+/// ***************************************************************************
+/// Returns the fingerprint of the node \p node only. Links to nodes in the
+/// hierarchy of \p root are hashed by their position in it.
+/// ***************************************************************************
+String FingerprintNode(BaseList2D* node, BaseObject* root);
@@ -0,0 +1,371 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/GeometryCache.cpp
+
+#include "GeometryCache.h"
+#include <algorithm>
+#include <cstring>
+
+static const char MAGIC[4] = {'N', 'R', 'G', 'C'};
+static const char END_MAGIC[4] = {'N', 'R', 'G', 'E'};
+static const uint32_t VERSION = 1;
+static const size_t HEADER_SIZE = 16;
+static const size_t TRAILER_SIZE = 16;
+static const size_t CHUNK_HEADER_SIZE = 16;
+static const size_t INDEX_ENTRY_SIZE = 24;
+
+/// ***************************************************************************
+/// Returns the tag of a chunk from its four characters.
+/// ***************************************************************************
+static uint32_t MakeTag(const char* name)
+{
+  uint32_t tag;
+  memcpy(&tag, name, 4);
+  return tag;
+}
+
+static const uint32_t TAG_MESH = MakeTag("MESH");
+static const uint32_t TAG_PNTS = MakeTag("PNTS");
+static const uint32_t TAG_INDX = MakeTag("INDX");
+
+/// ***************************************************************************
+/// The format is little endian and read in place, so it can only be
+/// written and read on little endian machines.
+/// ***************************************************************************
+static bool IsLittleEndian()
+{
+  const uint16_t probe = 1;
+  uint8_t first;
+  memcpy(&first, &probe, 1);
+  return first == 1;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+static uint64_t Align8(uint64_t size)
+{
+  return (size + 7) & ~(uint64_t) 7;
+}
+
+/// ***************************************************************************
+/// Returns the key of the points of \p mesh in \p frame.
+/// ***************************************************************************
+static uint64_t PointsKey(int32_t frame, uint32_t mesh)
+{
+  return ((uint64_t) (uint32_t) frame << 32) | mesh;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool GeometryCacheWriter::Write(const void* data, size_t size)
+{
+  if (!m_ok) return false;
+  if (size > 0 && fwrite(data, 1, size, m_fp) != size)
+    m_ok = false;
+  m_offset += size;
+  return m_ok;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool GeometryCacheWriter::BeginChunk(uint32_t tag, uint64_t size, uint32_t mesh, int32_t frame)
+{
+  GeometryCacheChunk chunk = {tag, mesh, frame, m_offset};
+  m_index.push_back(chunk);
+  uint32_t header[2] = {tag, 0};
+  return Write(header, sizeof(header)) && Write(&size, sizeof(size));
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool GeometryCacheWriter::Open(std::string const& filename)
+{
+  Close();
+  if (!IsLittleEndian()) return false;
+  m_fp = fopen(filename.c_str(), "wb");
+  if (!m_fp) return false;
+  m_ok = true;
+  m_offset = 0;
+  m_index.clear();
+  m_meshPoints.clear();
+  m_pending = 0;
+
+  uint32_t header[4] = {0, VERSION, 0, 0};
+  memcpy(header, MAGIC, 4);
+  return Write(header, sizeof(header));
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+uint32_t GeometryCacheWriter::AddMesh(std::string const& name, uint32_t points,
+    uint32_t polygons, const int32_t* indices)
+{
+  const uint32_t mesh = (uint32_t) m_meshPoints.size();
+  if (!m_fp || m_pending)
+  {
+    m_ok = false;
+    return mesh;
+  }
+  m_meshPoints.push_back(points);
+
+  const uint32_t nameLength = (uint32_t) name.size();
+  const uint64_t nameSize = ((uint64_t) nameLength + 3) & ~(uint64_t) 3;
+  const uint64_t size = 16 + nameSize + (uint64_t) polygons * 16;
+  const uint8_t zero[8] = {0};
+  uint32_t fields[4] = {mesh, points, polygons, nameLength};
+  BeginChunk(TAG_MESH, size, mesh, 0);
+  Write(fields, sizeof(fields));
+  Write(name.data(), nameLength);
+  Write(zero, (size_t) (nameSize - nameLength));
+  Write(indices, (size_t) polygons * 16);
+  Write(zero, (size_t) (Align8(size) - size));
+  return mesh;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool GeometryCacheWriter::BeginPoints(int32_t frame, uint32_t mesh)
+{
+  if (!m_fp || m_pending || mesh >= m_meshPoints.size()) return false;
+  const uint32_t points = m_meshPoints[mesh];
+  const uint64_t size = 16 + (uint64_t) points * 12;
+  m_pending = points;
+  m_padding = Align8(size) - size;
+  int32_t fields[4] = {frame, (int32_t) mesh, (int32_t) points, 0};
+  return BeginChunk(TAG_PNTS, size, mesh, frame) && Write(fields, sizeof(fields));
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool GeometryCacheWriter::WritePoints(const float* xyz, uint32_t count)
+{
+  if (!m_fp || count > m_pending) return false;
+  m_pending -= count;
+  return Write(xyz, (size_t) count * 12);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool GeometryCacheWriter::EndPoints()
+{
+  if (!m_fp || m_pending)
+  {
+    m_ok = false;
+    return false;
+  }
+  const uint8_t zero[8] = {0};
+  return Write(zero, (size_t) m_padding);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool GeometryCacheWriter::Close()
+{
+  if (!m_fp) return false;
+  if (m_pending) m_ok = false;
+
+  const uint64_t indexOffset = m_offset;
+  const uint64_t size = 8 + (uint64_t) m_index.size() * INDEX_ENTRY_SIZE;
+  std::vector<GeometryCacheChunk> index;
+  index.swap(m_index);
+  uint32_t count[2] = {(uint32_t) index.size(), 0};
+  BeginChunk(TAG_INDX, size, 0, 0);
+  Write(count, sizeof(count));
+  for (GeometryCacheChunk const& chunk : index)
+  {
+    uint32_t fields[4] = {chunk.tag, chunk.mesh, (uint32_t) chunk.frame, 0};
+    Write(fields, sizeof(fields));
+    Write(&chunk.offset, sizeof(chunk.offset));
+  }
+
+  uint32_t trailer[2] = {0, 0};
+  memcpy(trailer, END_MAGIC, 4);
+  Write(&indexOffset, sizeof(indexOffset));
+  Write(trailer, sizeof(trailer));
+
+  bool ok = fclose(m_fp) == 0 && m_ok;
+  m_fp = nullptr;
+  m_ok = false;
+  m_index.clear();
+  return ok;
+}
+
+/// ***************************************************************************
+/// Reads the INDX chunk at \p offset.
+/// ***************************************************************************
+bool GeometryCacheReader::ReadIndex(uint64_t offset, std::vector<GeometryCacheChunk>& chunks) const
+{
+  const uint8_t* data = m_file.GetData();
+  const uint64_t size = m_file.GetSize() - TRAILER_SIZE;
+  if (offset < HEADER_SIZE || offset + CHUNK_HEADER_SIZE + 8 > size) return false;
+
+  uint32_t tag, count;
+  memcpy(&tag, data + offset, 4);
+  memcpy(&count, data + offset + CHUNK_HEADER_SIZE, 4);
+  if (tag != TAG_INDX) return false;
+  if ((size - offset - CHUNK_HEADER_SIZE - 8) / INDEX_ENTRY_SIZE < count) return false;
+
+  const uint8_t* p = data + offset + CHUNK_HEADER_SIZE + 8;
+  chunks.resize(count);
+  for (uint32_t i=0; i < count; i++, p += INDEX_ENTRY_SIZE)
+  {
+    memcpy(&chunks[i].tag, p, 4);
+    memcpy(&chunks[i].mesh, p + 4, 4);
+    memcpy(&chunks[i].frame, p + 8, 4);
+    memcpy(&chunks[i].offset, p + 16, 8);
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// Collects the chunks of a file without an index, up to the last
+/// complete chunk.
+/// ***************************************************************************
+void GeometryCacheReader::ScanChunks(std::vector<GeometryCacheChunk>& chunks) const
+{
+  const uint8_t* data = m_file.GetData();
+  const uint64_t size = m_file.GetSize();
+  uint64_t offset = HEADER_SIZE;
+  while (offset + CHUNK_HEADER_SIZE + 8 <= size)
+  {
+    GeometryCacheChunk chunk = {0, 0, 0, offset};
+    uint64_t payload;
+    memcpy(&chunk.tag, data + offset, 4);
+    memcpy(&payload, data + offset + 8, 8);
+    if (payload > size - offset - CHUNK_HEADER_SIZE) break;
+    if (chunk.tag == TAG_MESH)
+      memcpy(&chunk.mesh, data + offset + CHUNK_HEADER_SIZE, 4);
+    else if (chunk.tag == TAG_PNTS)
+    {
+      memcpy(&chunk.frame, data + offset + CHUNK_HEADER_SIZE, 4);
+      memcpy(&chunk.mesh, data + offset + CHUNK_HEADER_SIZE + 4, 4);
+    }
+    else if (chunk.tag == TAG_INDX)
+      break;
+    chunks.push_back(chunk);
+    offset += CHUNK_HEADER_SIZE + Align8(payload);
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool GeometryCacheReader::Open(std::string const& filename)
+{
+  Close();
+  if (!IsLittleEndian() || !m_file.Open(filename)) return false;
+  const uint8_t* data = m_file.GetData();
+  const uint64_t size = m_file.GetSize();
+
+  uint32_t header[4];
+  if (size < HEADER_SIZE)
+  {
+    Close();
+    return false;
+  }
+  memcpy(header, data, sizeof(header));
+  if (memcmp(data, MAGIC, 4) != 0 || header[1] != VERSION)
+  {
+    Close();
+    return false;
+  }
+
+  std::vector<GeometryCacheChunk> chunks;
+  uint64_t indexOffset = 0;
+  if (size >= HEADER_SIZE + TRAILER_SIZE && memcmp(data + size - 8, END_MAGIC, 4) == 0)
+  {
+    memcpy(&indexOffset, data + size - TRAILER_SIZE, 8);
+    m_complete = ReadIndex(indexOffset, chunks);
+  }
+  if (!m_complete)
+  {
+    chunks.clear();
+    ScanChunks(chunks);
+  }
+
+  // Validate the chunks against the file before pointers are handed out.
+  for (GeometryCacheChunk const& chunk : chunks)
+  {
+    // Written so that a bogus offset can't wrap around.
+    if (size < CHUNK_HEADER_SIZE + 16 || chunk.offset > size - (CHUNK_HEADER_SIZE + 16)) continue;
+    const uint8_t* p = data + chunk.offset;
+    uint64_t payload;
+    uint32_t fields[4];
+    memcpy(&payload, p + 8, 8);
+    memcpy(fields, p + CHUNK_HEADER_SIZE, sizeof(fields));
+    if (payload > size - chunk.offset - CHUNK_HEADER_SIZE) continue;
+
+    if (chunk.tag == TAG_MESH)
+    {
+      const uint64_t nameSize = ((uint64_t) fields[3] + 3) & ~(uint64_t) 3;
+      if (16 + nameSize + (uint64_t) fields[2] * 16 > payload) continue;
+      GeometryCacheMesh mesh;
+      mesh.id = fields[0];
+      mesh.points = fields[1];
+      mesh.polygons = fields[2];
+      mesh.name.assign(reinterpret_cast<const char*>(p + CHUNK_HEADER_SIZE + 16), fields[3]);
+      mesh.indices = reinterpret_cast<const int32_t*>(p + CHUNK_HEADER_SIZE + 16 + nameSize);
+      m_meshes.push_back(mesh);
+    }
+    else if (chunk.tag == TAG_PNTS)
+    {
+      if (16 + (uint64_t) fields[2] * 12 > payload) continue;
+      GeometryCacheMesh const* mesh = FindMesh(fields[1]);
+      if (!mesh || mesh->points != fields[2]) continue;
+      const int32_t frame = (int32_t) fields[0];
+      if (m_points.emplace(PointsKey(frame, fields[1]), chunk.offset).second)
+        m_frameMeshes[frame].push_back(fields[1]);
+    }
+  }
+
+  for (auto const& frame : m_frameMeshes)
+    m_frames.push_back(frame.first);
+  std::sort(m_frames.begin(), m_frames.end());
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void GeometryCacheReader::Close()
+{
+  m_file.Close();
+  m_meshes.clear();
+  m_frames.clear();
+  m_points.clear();
+  m_frameMeshes.clear();
+  m_complete = false;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+GeometryCacheMesh const* GeometryCacheReader::FindMesh(uint32_t id) const
+{
+  // Meshes are written in the order of their numbers.
+  if (id < m_meshes.size() && m_meshes[id].id == id)
+    return &m_meshes[id];
+  for (GeometryCacheMesh const& mesh : m_meshes)
+  {
+    if (mesh.id == id) return &mesh;
+  }
+  return nullptr;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+std::vector<uint32_t> const& GeometryCacheReader::GetFrameMeshes(int32_t frame) const
+{
+  static const std::vector<uint32_t> empty;
+  auto it = m_frameMeshes.find(frame);
+  return it == m_frameMeshes.end() ? empty : it->second;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+const float* GeometryCacheReader::GetPoints(int32_t frame, uint32_t mesh) const
+{
+  auto it = m_points.find(PointsKey(frame, mesh));
+  if (it == m_points.end()) return nullptr;
+  return reinterpret_cast<const float*>(m_file.GetData() + it->second + CHUNK_HEADER_SIZE + 16);
+}
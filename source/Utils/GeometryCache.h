@@ -0,0 +1,164 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/GeometryCache.h
+///
+/// An interchange format for the evaluated geometry of a container over
+/// a range of frames. The file is written as a stream of chunks, so the
+/// writer only holds the data of the chunk it is writing, and read
+/// through a memory mapping without copying the geometry. Does not depend
+/// on the Cinema 4D API; the reader builds on its own for other tools.
+///
+/// Layout, all integers little endian, chunks aligned to 8 bytes:
+///
+///     char[4]  magic "NRGC"
+///     u32      version (1)
+///     u32      flags (0)
+///     u32      reserved
+///     chunk*   chunks
+///     u64      offset of the INDX chunk
+///     char[4]  end marker "NRGE"
+///     u32      reserved
+///
+/// Every chunk is a u32 tag, a u32 reserved, the u64 size of the payload
+/// and the payload, padded to a multiple of 8 bytes:
+///
+///     MESH     u32 mesh, u32 points, u32 polygons, u32 name length, the
+///              name padded to 4 bytes and i32[4] per polygon (the last
+///              two indices are equal for triangles)
+///     PNTS     i32 frame, u32 mesh, u32 points, u32 reserved and f32[3]
+///              per point in the space of the container
+///     INDX     u32 count, u32 reserved and per chunk a u32 tag, u32 mesh,
+///              i32 frame, u32 reserved and the u64 offset of the chunk
+///
+/// A mesh is written once, before the first frame that uses it. A mesh
+/// whose topology changes is written again as a new mesh. A file without
+/// the end marker, eg. from an interrupted export, is read up to its last
+/// complete chunk.
+
+#pragma once
+
+#include "MappedFile.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define GEOMETRYCACHE_EXTENSION ".nrgc"
+
+/// ***************************************************************************
+/// A chunk in the index of a geometry cache.
+/// ***************************************************************************
+struct GeometryCacheChunk
+{
+  uint32_t tag;
+  uint32_t mesh;
+  int32_t frame;
+  uint64_t offset;
+};
+
+/// ***************************************************************************
+/// Writes a geometry cache chunk by chunk.
+/// ***************************************************************************
+class GeometryCacheWriter
+{
+  FILE* m_fp;
+  uint64_t m_offset;
+  std::vector<GeometryCacheChunk> m_index;
+  std::vector<uint32_t> m_meshPoints;   ///< Number of points of every mesh.
+  uint32_t m_pending;                   ///< Points left in the open PNTS chunk.
+  uint64_t m_padding;                   ///< Padding after the open PNTS chunk.
+  bool m_ok;
+
+  GeometryCacheWriter(GeometryCacheWriter const&);
+  GeometryCacheWriter& operator = (GeometryCacheWriter const&);
+
+  bool Write(const void* data, size_t size);
+  bool BeginChunk(uint32_t tag, uint64_t size, uint32_t mesh, int32_t frame);
+
+public:
+
+  GeometryCacheWriter() : m_fp(nullptr), m_offset(0), m_pending(0), m_padding(0), m_ok(false) { }
+  ~GeometryCacheWriter() { Close(); }
+
+  bool Open(std::string const& filename);
+
+  /// Writes a mesh with \p polygons polygons of four indices each at
+  /// \p indices. Returns the number of the mesh.
+  uint32_t AddMesh(std::string const& name, uint32_t points, uint32_t polygons,
+      const int32_t* indices);
+
+  /// Starts the points of \p mesh in \p frame. The points are passed to
+  /// WritePoints() in any number of blocks.
+  bool BeginPoints(int32_t frame, uint32_t mesh);
+
+  /// Writes \p count points stored as consecutive x, y, z floats.
+  bool WritePoints(const float* xyz, uint32_t count);
+
+  /// Completes the points started with BeginPoints().
+  bool EndPoints();
+
+  /// Writes the index and the end marker. Returns \c false if any write
+  /// failed.
+  bool Close();
+};
+
+/// ***************************************************************************
+/// A mesh of a memory mapped geometry cache.
+/// ***************************************************************************
+struct GeometryCacheMesh
+{
+  uint32_t id;
+  std::string name;
+  uint32_t points;
+  uint32_t polygons;
+  const int32_t* indices;   ///< Four per polygon, points into the mapping.
+};
+
+/// ***************************************************************************
+/// Reads a memory mapped geometry cache. Reading is thread-safe.
+/// ***************************************************************************
+class GeometryCacheReader
+{
+  MappedFile m_file;
+  std::vector<GeometryCacheMesh> m_meshes;
+  std::vector<int32_t> m_frames;
+  std::unordered_map<uint64_t, uint64_t> m_points;   ///< Offset of the PNTS chunk by frame and mesh.
+  std::unordered_map<int32_t, std::vector<uint32_t>> m_frameMeshes;
+  bool m_complete;
+
+  bool ReadIndex(uint64_t offset, std::vector<GeometryCacheChunk>& chunks) const;
+  void ScanChunks(std::vector<GeometryCacheChunk>& chunks) const;
+
+public:
+
+  GeometryCacheReader() : m_complete(false) { }
+
+  bool Open(std::string const& filename);
+  void Close();
+
+  bool IsOpen() const { return m_file.IsOpen(); }
+
+  /// Returns \c false if the file has no end marker and was read up to
+  /// its last complete chunk.
+  bool IsComplete() const { return m_complete; }
+
+  size_t GetMeshCount() const { return m_meshes.size(); }
+  GeometryCacheMesh const& GetMesh(size_t index) const { return m_meshes[index]; }
+
+  /// Returns the mesh with the number \p id, or \c nullptr.
+  GeometryCacheMesh const* FindMesh(uint32_t id) const;
+
+  /// Returns the frames in the file in ascending order.
+  std::vector<int32_t> const& GetFrames() const { return m_frames; }
+
+  /// Returns the numbers of the meshes that have points in \p frame.
+  std::vector<uint32_t> const& GetFrameMeshes(int32_t frame) const;
+
+  /// Returns the points of \p mesh in \p frame as x, y, z floats, or
+  /// \c nullptr if the mesh has no points in the frame.
+  const float* GetPoints(int32_t frame, uint32_t mesh) const;
+};
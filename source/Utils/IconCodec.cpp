@@ -0,0 +1,229 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/IconCodec.cpp
+
+#include "IconCodec.h"
+#include "Kernels.h"
+#include <cstring>
+
+static const uint8_t ICON_MAGIC[4] = {'N', 'R', 'I', 'C'};
+static const uint8_t ICON_VERSION = 1;
+static const size_t ICON_HEADERSIZE = 10;
+
+static const size_t LZ_MINMATCH = 4;
+static const size_t LZ_MAXOFFSET = 65535;
+static const int LZ_HASHBITS = 12;
+
+/// The most bytes a single compressed byte can expand to, a length byte
+/// of 255 in a match.
+static const size_t LZ_MAXRATIO = 255;
+
+/// ***************************************************************************
+/// ***************************************************************************
+static inline uint32_t Read32(const uint8_t* p)
+{
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+static inline uint32_t Hash32(uint32_t value)
+{
+  return (value * 2654435761u) >> (32 - LZ_HASHBITS);
+}
+
+/// ***************************************************************************
+/// Appends a length that did not fit into a token nibble.
+/// ***************************************************************************
+static void WriteLength(size_t length, std::vector<uint8_t>& out)
+{
+  while (length >= 255)
+  {
+    out.push_back(255);
+    length -= 255;
+  }
+  out.push_back((uint8_t) length);
+}
+
+/// ***************************************************************************
+/// Appends a sequence of literals followed by a match. A \p matchLength
+/// of zero ends the block with the literals only.
+/// ***************************************************************************
+static void WriteSequence(const uint8_t* literals, size_t literalLength,
+    size_t offset, size_t matchLength, std::vector<uint8_t>& out)
+{
+  size_t ml = matchLength ? matchLength - LZ_MINMATCH : 0;
+  uint8_t token = (uint8_t) ((literalLength < 15 ? literalLength : 15) << 4);
+  token |= (uint8_t) (ml < 15 ? ml : 15);
+  out.push_back(token);
+  if (literalLength >= 15) WriteLength(literalLength - 15, out);
+  out.insert(out.end(), literals, literals + literalLength);
+  if (!matchLength) return;
+  out.push_back((uint8_t) (offset & 0xff));
+  out.push_back((uint8_t) (offset >> 8));
+  if (ml >= 15) WriteLength(ml - 15, out);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void LZCompress(const uint8_t* src, size_t size, std::vector<uint8_t>& out)
+{
+  int32_t table[1 << LZ_HASHBITS];
+  for (size_t i=0; i < (1 << LZ_HASHBITS); i++)
+    table[i] = -1;
+
+  size_t anchor = 0;
+  size_t pos = 0;
+  // Matches are only searched where at least one full 4 byte word
+  // can be read.
+  size_t limit = size >= LZ_MINMATCH ? size - LZ_MINMATCH : 0;
+  while (pos < limit)
+  {
+    uint32_t word = Read32(src + pos);
+    uint32_t h = Hash32(word);
+    int32_t candidate = table[h];
+    table[h] = (int32_t) pos;
+
+    if (candidate < 0 || pos - candidate > LZ_MAXOFFSET || Read32(src + candidate) != word)
+    {
+      pos++;
+      continue;
+    }
+
+    size_t length = LZ_MINMATCH;
+    while (pos + length < size && src[candidate + length] == src[pos + length])
+      length++;
+
+    WriteSequence(src + anchor, pos - anchor, pos - candidate, length, out);
+    pos += length;
+    anchor = pos;
+  }
+  WriteSequence(src + anchor, size - anchor, 0, 0, out);
+}
+
+/// ***************************************************************************
+/// Reads a length that did not fit into a token nibble.
+/// ***************************************************************************
+static bool ReadLength(const uint8_t*& p, const uint8_t* end, size_t& length)
+{
+  uint8_t byte;
+  do {
+    if (p >= end) return false;
+    byte = *p++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool LZDecompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize)
+{
+  const uint8_t* p = src;
+  const uint8_t* end = src + size;
+  size_t pos = 0;
+
+  while (p < end)
+  {
+    uint8_t token = *p++;
+    size_t literalLength = token >> 4;
+    if (literalLength == 15 && !ReadLength(p, end, literalLength)) return false;
+    if (literalLength > (size_t) (end - p) || literalLength > dstSize - pos) return false;
+    if (literalLength) memcpy(dst + pos, p, literalLength);
+    p += literalLength;
+    pos += literalLength;
+
+    // The last sequence has no match.
+    if (p == end) break;
+
+    if (end - p < 2) return false;
+    size_t offset = p[0] | (p[1] << 8);
+    p += 2;
+    size_t matchLength = token & 15;
+    if (matchLength == 15 && !ReadLength(p, end, matchLength)) return false;
+    matchLength += LZ_MINMATCH;
+    if (offset == 0 || offset > pos || matchLength > dstSize - pos) return false;
+
+    // Matches may overlap their own output, copy byte by byte.
+    const uint8_t* match = dst + pos - offset;
+    for (size_t i=0; i < matchLength; i++)
+      dst[pos + i] = match[i];
+    pos += matchLength;
+  }
+  return pos == dstSize;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool IconEncode(const uint8_t* pixels, uint32_t width, uint32_t height,
+    uint32_t channels, std::vector<uint8_t>& out)
+{
+  if (channels < 1 || channels > 4 || width > ICON_MAXSIZE || height > ICON_MAXSIZE)
+    return false;
+
+  out.insert(out.end(), ICON_MAGIC, ICON_MAGIC + 4);
+  out.push_back(ICON_VERSION);
+  out.push_back((uint8_t) channels);
+  out.push_back((uint8_t) (width & 0xff));
+  out.push_back((uint8_t) (width >> 8));
+  out.push_back((uint8_t) (height & 0xff));
+  out.push_back((uint8_t) (height >> 8));
+
+  // Split the channels into planes and store every byte as the
+  // difference to its left neighbour. Flat areas become zero runs.
+  size_t count = (size_t) width * height;
+  std::vector<uint8_t> planes(count * channels);
+  std::vector<uint8_t> filtered(count * channels);
+  for (uint32_t c=0; c < channels; c++)
+  {
+    uint8_t* plane = planes.data() + c * count;
+    for (size_t i=0; i < count; i++)
+      plane[i] = pixels[i * channels + c];
+  }
+  const KernelTable& kernels = GetKernels();
+  for (size_t row=0; row < (size_t) height * channels; row++)
+    kernels.deltaEncode(planes.data() + row * width, width, filtered.data() + row * width);
+
+  LZCompress(filtered.data(), filtered.size(), out);
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool IconDecode(const uint8_t* data, size_t size, std::vector<uint8_t>& pixels,
+    uint32_t& width, uint32_t& height, uint32_t& channels)
+{
+  if (size < ICON_HEADERSIZE || memcmp(data, ICON_MAGIC, 4) != 0 || data[4] != ICON_VERSION)
+    return false;
+  channels = data[5];
+  width = data[6] | (data[7] << 8);
+  height = data[8] | (data[9] << 8);
+  if (channels < 1 || channels > 4) return false;
+  if (width > ICON_MAXSIZE || height > ICON_MAXSIZE) return false;
+
+  // Corrupt headers would make us allocate far more than the data can
+  // ever decompress to.
+  size_t count = (size_t) width * height;
+  if (count * channels > (size - ICON_HEADERSIZE) * LZ_MAXRATIO) return false;
+  std::vector<uint8_t> planes(count * channels);
+  if (!LZDecompress(data + ICON_HEADERSIZE, size - ICON_HEADERSIZE, planes.data(), planes.size()))
+    return false;
+
+  const KernelTable& kernels = GetKernels();
+  for (size_t row=0; row < (size_t) height * channels; row++)
+    kernels.deltaDecode(planes.data() + row * width, width, planes.data() + row * width);
+
+  pixels.resize(count * channels);
+  for (uint32_t c=0; c < channels; c++)
+  {
+    const uint8_t* plane = planes.data() + c * count;
+    for (size_t i=0; i < count; i++)
+      pixels[i * channels + c] = plane[i];
+  }
+  return true;
+}
@@ -0,0 +1,51 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/IconCodec.h
+///
+/// A small lossless image codec for container icons. The channels are
+/// stored as separate planes with a left-neighbour delta filter and
+/// compressed with a byte-oriented LZ77 compressor in the style of LZ4,
+/// which encodes and decodes a 64x64 icon far faster than PNG.
+///
+/// This file does not depend on the Cinema 4D API so that it can be used
+/// by the tools in the `tools/` directory.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// The largest width and height of an icon. Container icons are scaled to
+/// this size (#CONTAINEROBJECT_ICONSIZE), larger ones are rejected.
+static const uint32_t ICON_MAXSIZE = 64;
+
+/// ***************************************************************************
+/// Compresses \p size bytes from \p src and appends them to \p out.
+/// ***************************************************************************
+void LZCompress(const uint8_t* src, size_t size, std::vector<uint8_t>& out);
+
+/// ***************************************************************************
+/// Decompresses \p size bytes from \p src into exactly \p dstSize bytes
+/// at \p dst. Returns \c false if the data is corrupt.
+/// ***************************************************************************
+bool LZDecompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize);
+
+/// ***************************************************************************
+/// Encodes an image of \p width x \p height pixels with \p channels
+/// interleaved 8 bit channels (1 to 4) and appends it to \p out. The
+/// image may not be larger than #ICON_MAXSIZE.
+/// ***************************************************************************
+bool IconEncode(const uint8_t* pixels, uint32_t width, uint32_t height,
+    uint32_t channels, std::vector<uint8_t>& out);
+
+/// ***************************************************************************
+/// Decodes an image encoded with IconEncode(). Returns \c false if the
+/// data is not a valid icon. The header is validated against the size of
+/// the compressed data before anything is allocated.
+/// ***************************************************************************
+bool IconDecode(const uint8_t* data, size_t size, std::vector<uint8_t>& pixels,
+    uint32_t& width, uint32_t& height, uint32_t& channels);
@@ -0,0 +1,246 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/JobSystem.cpp
+
+#include "JobSystem.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const uint32_t MAX_THREADS = 64;
+
+struct Job
+{
+  std::function<void()> fn;
+  JobGroup* group;
+};
+
+struct JobQueue
+{
+  std::mutex lock;
+  std::deque<Job> jobs;
+};
+
+// The queues of the workers, followed by the queue that threads which
+// are not workers push to.
+static std::vector<std::unique_ptr<JobQueue>> g_queues;
+static std::vector<std::thread> g_workers;
+static std::mutex g_initLock;
+static std::mutex g_sleepLock;
+static std::condition_variable g_wake;
+static std::atomic<bool> g_running(false);
+static std::atomic<int> g_queued(0);
+static std::atomic<long long> g_steals(0);
+
+/// Index of the worker queue of the current thread, or -1.
+static thread_local int t_worker = -1;
+
+/// ***************************************************************************
+/// ***************************************************************************
+struct JobRunner
+{
+  static void Execute(Job& job)
+  {
+    if (!job.group->IsCancelled())
+      job.fn();
+    job.fn = nullptr;
+    job.group->m_pending.fetch_sub(1, std::memory_order_acq_rel);
+  }
+
+  static void Add(JobGroup* group)
+  {
+    group->m_pending.fetch_add(1, std::memory_order_relaxed);
+  }
+};
+
+/// ***************************************************************************
+/// Takes a job for the thread with the worker index \p self. Workers take
+/// the newest job of their own queue first, then the oldest job of the
+/// shared queue and last the oldest job of another worker.
+/// ***************************************************************************
+static bool PopJob(int self, Job& out)
+{
+  if (g_queued.load(std::memory_order_acquire) <= 0)
+    return false;
+  int workers = (int) g_queues.size() - 1;
+  if (self >= 0)
+  {
+    JobQueue& queue = *g_queues[self];
+    std::lock_guard<std::mutex> lock(queue.lock);
+    if (!queue.jobs.empty())
+    {
+      out = std::move(queue.jobs.back());
+      queue.jobs.pop_back();
+      g_queued.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  for (int i=0; i <= workers; i++)
+  {
+    // Start with the shared queue, then the workers after this one.
+    int index = i == 0 ? workers : (self + i) % workers;
+    if (index == self) continue;
+    JobQueue& queue = *g_queues[index];
+    std::lock_guard<std::mutex> lock(queue.lock);
+    if (queue.jobs.empty()) continue;
+    out = std::move(queue.jobs.front());
+    queue.jobs.pop_front();
+    g_queued.fetch_sub(1, std::memory_order_relaxed);
+    if (index != workers)
+      g_steals.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  return false;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+static void WorkerMain(int index)
+{
+  t_worker = index;
+  while (true)
+  {
+    Job job;
+    if (PopJob(index, job))
+    {
+      JobRunner::Execute(job);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(g_sleepLock);
+    g_wake.wait(lock, [] {
+      return !g_running.load() || g_queued.load() > 0;
+    });
+    if (!g_running.load() && g_queued.load() <= 0)
+      break;
+  }
+  t_worker = -1;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void JobSystemInit(uint32_t threads)
+{
+  JobSystemShutdown();
+  std::lock_guard<std::mutex> lock(g_initLock);
+  if (threads > MAX_THREADS) threads = MAX_THREADS;
+  if (threads <= 1) return;
+
+  for (uint32_t i=0; i < threads; i++)
+    g_queues.emplace_back(new JobQueue);
+  g_steals.store(0);
+  g_running.store(true);
+  for (uint32_t i=0; i < threads - 1; i++)
+    g_workers.emplace_back(WorkerMain, (int) i);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void JobSystemShutdown()
+{
+  std::lock_guard<std::mutex> lock(g_initLock);
+  if (g_workers.empty()) return;
+  {
+    std::lock_guard<std::mutex> sleep(g_sleepLock);
+    g_running.store(false);
+  }
+  g_wake.notify_all();
+  for (std::thread& thread : g_workers)
+    thread.join();
+  g_workers.clear();
+
+  // The workers drain the queues before they exit, but a job may have
+  // been pushed from outside after the last one left.
+  Job job;
+  while (PopJob(-1, job))
+    JobRunner::Execute(job);
+  g_queues.clear();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+uint32_t JobSystemGetThreadCount()
+{
+  return (uint32_t) g_workers.size() + 1;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+long long JobSystemGetStealCount()
+{
+  return g_steals.load(std::memory_order_relaxed);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void JobGroup::Run(std::function<void()> fn)
+{
+  Job job;
+  job.fn = std::move(fn);
+  job.group = this;
+  JobRunner::Add(this);
+
+  if (!g_running.load(std::memory_order_acquire))
+  {
+    JobRunner::Execute(job);
+    return;
+  }
+
+  int index = t_worker >= 0 ? t_worker : (int) g_queues.size() - 1;
+  {
+    JobQueue& queue = *g_queues[index];
+    std::lock_guard<std::mutex> lock(queue.lock);
+    queue.jobs.push_back(std::move(job));
+    g_queued.fetch_add(1, std::memory_order_release);
+  }
+  // Taking the lock orders the push before the wait predicate check of
+  // a worker that is about to sleep, so the wakeup can't get lost.
+  { std::lock_guard<std::mutex> lock(g_sleepLock); }
+  g_wake.notify_one();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void JobGroup::Wait()
+{
+  while (m_pending.load(std::memory_order_acquire) > 0)
+  {
+    Job job;
+    if (g_running.load(std::memory_order_acquire) && PopJob(t_worker, job))
+      JobRunner::Execute(job);
+    else
+      std::this_thread::yield();
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void ParallelFor(size_t count, size_t grain, std::function<void(size_t begin, size_t end)> const& fn)
+{
+  if (grain < 1) grain = 1;
+  uint32_t threads = JobSystemGetThreadCount();
+  if (count <= grain || threads <= 1)
+  {
+    if (count) fn(0, count);
+    return;
+  }
+
+  // A few chunks per thread so that stealing can balance uneven work.
+  size_t chunks = count / grain;
+  if (chunks > threads * 4) chunks = threads * 4;
+  size_t size = (count + chunks - 1) / chunks;
+
+  JobGroup group;
+  for (size_t begin=size; begin < count; begin += size)
+  {
+    size_t end = begin + size < count ? begin + size : count;
+    group.Run([&fn, begin, end] { fn(begin, end); });
+  }
+  fn(0, size);
+  group.Wait();
+}
@@ -0,0 +1,83 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/JobSystem.h
+///
+/// The one pool of worker threads of the plugin. Every worker has its own
+/// job queue and steals from the others when it runs dry; threads waiting
+/// for a JobGroup run queued jobs meanwhile. Without workers, jobs run
+/// immediately on the calling thread. Does not depend on the Cinema 4D API.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/// ***************************************************************************
+/// Starts the worker threads. \p threads is the number of threads that
+/// may work in parallel including the thread that waits for the jobs, so
+/// `threads - 1` workers are started. With 0 or 1 all jobs run serially.
+/// Must not be called while jobs are pending. Calling it again restarts
+/// the pool with the new thread count.
+/// ***************************************************************************
+void JobSystemInit(uint32_t threads);
+
+/// ***************************************************************************
+/// Runs the jobs still queued and stops the worker threads.
+/// ***************************************************************************
+void JobSystemShutdown();
+
+/// ***************************************************************************
+/// Returns the number of threads that may work in parallel, at least 1.
+/// ***************************************************************************
+uint32_t JobSystemGetThreadCount();
+
+/// ***************************************************************************
+/// Returns the number of jobs that were taken from the queue of another
+/// worker since the pool was started.
+/// ***************************************************************************
+long long JobSystemGetStealCount();
+
+/// ***************************************************************************
+/// A set of jobs that can be waited for and cancelled together. The
+/// group must outlive its jobs, the destructor waits for them.
+/// ***************************************************************************
+class JobGroup
+{
+public:
+
+  JobGroup() : m_pending(0), m_cancelled(false) { }
+  ~JobGroup() { Wait(); }
+
+  /// Queues \p fn. Runs it right away if there are no workers.
+  void Run(std::function<void()> fn);
+
+  /// Returns when all jobs of the group are done, running queued jobs
+  /// on the calling thread in the meantime.
+  void Wait();
+
+  /// Jobs of the group that didn't start yet are skipped. Running jobs
+  /// may poll #IsCancelled() to stop early.
+  void Cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+  bool IsCancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+
+private:
+
+  friend struct JobRunner;
+  std::atomic<int> m_pending;
+  std::atomic<bool> m_cancelled;
+
+  JobGroup(JobGroup const&);
+  JobGroup& operator = (JobGroup const&);
+};
+
+/// ***************************************************************************
+/// Calls \p fn with the ranges of [0, \p count) split into chunks of at
+/// least \p grain items and waits for all of them. Runs on the calling
+/// thread only if \p count is not larger than \p grain.
+/// ***************************************************************************
+void ParallelFor(size_t count, size_t grain, std::function<void(size_t begin, size_t end)> const& fn);
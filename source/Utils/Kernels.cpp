@@ -0,0 +1,451 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/Kernels.cpp
+
+#include "Kernels.h"
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+  #define KERNELS_X86
+  #include <immintrin.h>
+#endif
+
+// MSVC allows intrinsics of any instruction set in any function, GCC and
+// Clang need the instruction set enabled per function.
+#if defined(_MSC_VER) && !defined(__clang__)
+  #define KERNEL_TARGET(x)
+#else
+  #define KERNEL_TARGET(x) __attribute__((target(x)))
+#endif
+
+/// ***************************************************************************
+/// Scalar reference kernels.
+/// ***************************************************************************
+
+static void BoundsReduceScalar(const double* xyz, size_t count, double* bbmin, double* bbmax)
+{
+  for (int c=0; c < 3; c++)
+    bbmin[c] = bbmax[c] = xyz[c];
+  for (size_t i=1; i < count; i++)
+  {
+    for (int c=0; c < 3; c++)
+    {
+      double v = xyz[i * 3 + c];
+      if (v < bbmin[c]) bbmin[c] = v;
+      if (v > bbmax[c]) bbmax[c] = v;
+    }
+  }
+}
+
+static void DeltaEncodeScalar(const uint8_t* src, size_t count, uint8_t* dst)
+{
+  uint8_t prev = 0;
+  for (size_t i=0; i < count; i++)
+  {
+    dst[i] = (uint8_t) (src[i] - prev);
+    prev = src[i];
+  }
+}
+
+static void DeltaDecodeScalar(const uint8_t* src, size_t count, uint8_t* dst)
+{
+  uint8_t prev = 0;
+  for (size_t i=0; i < count; i++)
+  {
+    prev = (uint8_t) (prev + src[i]);
+    dst[i] = prev;
+  }
+}
+
+static const uint32_t SHA256_K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline uint32_t Rotr(uint32_t x, int n)
+{
+  return (x >> n) | (x << (32 - n));
+}
+
+static void Sha256BlocksScalar(uint32_t state[8], const uint8_t* data, size_t count)
+{
+  for (; count > 0; count--, data += 64)
+  {
+    uint32_t w[64];
+    for (int i=0; i < 16; i++)
+    {
+      w[i] = ((uint32_t) data[i * 4] << 24) | ((uint32_t) data[i * 4 + 1] << 16) |
+             ((uint32_t) data[i * 4 + 2] << 8) | (uint32_t) data[i * 4 + 3];
+    }
+    for (int i=16; i < 64; i++)
+    {
+      uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i=0; i < 64; i++)
+    {
+      uint32_t s1 = Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25);
+      uint32_t ch = (e & f) ^ (~e & g);
+      uint32_t t1 = h + s1 + ch + SHA256_K[i] + w[i];
+      uint32_t s0 = Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22);
+      uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+      uint32_t t2 = s0 + maj;
+      h = g; g = f; f = e; e = d + t1;
+      d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+  }
+}
+
+#ifdef KERNELS_X86
+
+/// ***************************************************************************
+/// Bounds reduction. The points are loaded as a flat stream of doubles, so
+/// lane k of the i-th vector holds component (i * width + k) % 3. Three
+/// vectors cover a whole number of points; the components are sorted out
+/// after the loop.
+/// ***************************************************************************
+
+static void ReduceLanes(const double* mins, const double* maxs, int width,
+    double* bbmin, double* bbmax)
+{
+  for (int v=0; v < 3; v++)
+  {
+    for (int k=0; k < width; k++)
+    {
+      int c = (v * width + k) % 3;
+      double lo = mins[v * width + k], hi = maxs[v * width + k];
+      if (lo < bbmin[c]) bbmin[c] = lo;
+      if (hi > bbmax[c]) bbmax[c] = hi;
+    }
+  }
+}
+
+KERNEL_TARGET("avx2")
+static void BoundsReduceAVX2(const double* xyz, size_t count, double* bbmin, double* bbmax)
+{
+  BoundsReduceScalar(xyz, 1, bbmin, bbmax);
+  size_t blocks = count / 4;
+  if (blocks > 0)
+  {
+    __m256d min0 = _mm256_loadu_pd(xyz), min1 = _mm256_loadu_pd(xyz + 4), min2 = _mm256_loadu_pd(xyz + 8);
+    __m256d max0 = min0, max1 = min1, max2 = min2;
+    for (size_t i=1; i < blocks; i++)
+    {
+      const double* p = xyz + i * 12;
+      __m256d a = _mm256_loadu_pd(p), b = _mm256_loadu_pd(p + 4), c = _mm256_loadu_pd(p + 8);
+      min0 = _mm256_min_pd(min0, a); max0 = _mm256_max_pd(max0, a);
+      min1 = _mm256_min_pd(min1, b); max1 = _mm256_max_pd(max1, b);
+      min2 = _mm256_min_pd(min2, c); max2 = _mm256_max_pd(max2, c);
+    }
+    double mins[12], maxs[12];
+    _mm256_storeu_pd(mins, min0); _mm256_storeu_pd(mins + 4, min1); _mm256_storeu_pd(mins + 8, min2);
+    _mm256_storeu_pd(maxs, max0); _mm256_storeu_pd(maxs + 4, max1); _mm256_storeu_pd(maxs + 8, max2);
+    ReduceLanes(mins, maxs, 4, bbmin, bbmax);
+  }
+  for (size_t i=blocks * 4; i < count; i++)
+  {
+    double lo[3], hi[3];
+    BoundsReduceScalar(xyz + i * 3, 1, lo, hi);
+    for (int c=0; c < 3; c++)
+    {
+      if (lo[c] < bbmin[c]) bbmin[c] = lo[c];
+      if (hi[c] > bbmax[c]) bbmax[c] = hi[c];
+    }
+  }
+}
+
+// GCC's AVX-512 headers trigger false uninitialized warnings.
+#if defined(__GNUC__) && !defined(__clang__)
+  #pragma GCC diagnostic push
+  #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+KERNEL_TARGET("avx512f")
+static void BoundsReduceAVX512(const double* xyz, size_t count, double* bbmin, double* bbmax)
+{
+  BoundsReduceScalar(xyz, 1, bbmin, bbmax);
+  size_t blocks = count / 8;
+  if (blocks > 0)
+  {
+    __m512d min0 = _mm512_loadu_pd(xyz), min1 = _mm512_loadu_pd(xyz + 8), min2 = _mm512_loadu_pd(xyz + 16);
+    __m512d max0 = min0, max1 = min1, max2 = min2;
+    for (size_t i=1; i < blocks; i++)
+    {
+      const double* p = xyz + i * 24;
+      __m512d a = _mm512_loadu_pd(p), b = _mm512_loadu_pd(p + 8), c = _mm512_loadu_pd(p + 16);
+      min0 = _mm512_min_pd(min0, a); max0 = _mm512_max_pd(max0, a);
+      min1 = _mm512_min_pd(min1, b); max1 = _mm512_max_pd(max1, b);
+      min2 = _mm512_min_pd(min2, c); max2 = _mm512_max_pd(max2, c);
+    }
+    double mins[24], maxs[24];
+    _mm512_storeu_pd(mins, min0); _mm512_storeu_pd(mins + 8, min1); _mm512_storeu_pd(mins + 16, min2);
+    _mm512_storeu_pd(maxs, max0); _mm512_storeu_pd(maxs + 8, max1); _mm512_storeu_pd(maxs + 16, max2);
+    ReduceLanes(mins, maxs, 8, bbmin, bbmax);
+  }
+  for (size_t i=blocks * 8; i < count; i++)
+  {
+    double lo[3], hi[3];
+    BoundsReduceScalar(xyz + i * 3, 1, lo, hi);
+    for (int c=0; c < 3; c++)
+    {
+      if (lo[c] < bbmin[c]) bbmin[c] = lo[c];
+      if (hi[c] > bbmax[c]) bbmax[c] = hi[c];
+    }
+  }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+  #pragma GCC diagnostic pop
+#endif
+
+/// ***************************************************************************
+/// Delta filter.
+/// ***************************************************************************
+
+KERNEL_TARGET("sse4.1")
+static void DeltaEncodeSSE41(const uint8_t* src, size_t count, uint8_t* dst)
+{
+  if (count == 0) return;
+  dst[0] = src[0];
+  size_t i = 1;
+  for (; i + 16 <= count; i += 16)
+  {
+    __m128i cur = _mm_loadu_si128((const __m128i*) (src + i));
+    __m128i prev = _mm_loadu_si128((const __m128i*) (src + i - 1));
+    _mm_storeu_si128((__m128i*) (dst + i), _mm_sub_epi8(cur, prev));
+  }
+  for (; i < count; i++)
+    dst[i] = (uint8_t) (src[i] - src[i - 1]);
+}
+
+KERNEL_TARGET("avx2")
+static void DeltaEncodeAVX2(const uint8_t* src, size_t count, uint8_t* dst)
+{
+  if (count == 0) return;
+  dst[0] = src[0];
+  size_t i = 1;
+  for (; i + 32 <= count; i += 32)
+  {
+    __m256i cur = _mm256_loadu_si256((const __m256i*) (src + i));
+    __m256i prev = _mm256_loadu_si256((const __m256i*) (src + i - 1));
+    _mm256_storeu_si256((__m256i*) (dst + i), _mm256_sub_epi8(cur, prev));
+  }
+  for (; i < count; i++)
+    dst[i] = (uint8_t) (src[i] - src[i - 1]);
+}
+
+KERNEL_TARGET("sse4.1")
+static void DeltaDecodeSSE41(const uint8_t* src, size_t count, uint8_t* dst)
+{
+  // Prefix sums of 16 bytes in four shift-and-add steps, plus the carry
+  // from the previous block broadcast to all lanes.
+  __m128i carry = _mm_setzero_si128();
+  const __m128i last = _mm_set1_epi8(15);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i*) (src + i));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 1));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 2));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+    x = _mm_add_epi8(x, carry);
+    _mm_storeu_si128((__m128i*) (dst + i), x);
+    carry = _mm_shuffle_epi8(x, last);
+  }
+  uint8_t prev = (uint8_t) _mm_extract_epi8(carry, 0);
+  for (; i < count; i++)
+  {
+    prev = (uint8_t) (prev + src[i]);
+    dst[i] = prev;
+  }
+}
+
+/// ***************************************************************************
+/// SHA-256 with the SHA extensions. The state is kept in the ABEF/CDGH
+/// layout the instructions expect; every group of four rounds expands
+/// the next four message words with SHA256MSG1/SHA256MSG2.
+/// ***************************************************************************
+
+KERNEL_TARGET("sha,sse4.1")
+static void Sha256BlocksSHA(uint32_t state[8], const uint8_t* data, size_t count)
+{
+  const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+  __m128i tmp = _mm_loadu_si128((const __m128i*) &state[0]);
+  __m128i state1 = _mm_loadu_si128((const __m128i*) &state[4]);
+  tmp = _mm_shuffle_epi32(tmp, 0xB1);             // CDAB
+  state1 = _mm_shuffle_epi32(state1, 0x1B);       // EFGH
+  __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);   // ABEF
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0);    // CDGH
+
+  for (; count > 0; count--, data += 64)
+  {
+    __m128i abefSave = state0;
+    __m128i cdghSave = state1;
+    __m128i w[16];
+
+    for (int i=0; i < 16; i++)
+    {
+      if (i < 4)
+        w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (data + i * 16)), mask);
+      else
+      {
+        __m128i t = _mm_sha256msg1_epu32(w[i - 4], w[i - 3]);
+        t = _mm_add_epi32(t, _mm_alignr_epi8(w[i - 1], w[i - 2], 4));
+        w[i] = _mm_sha256msg2_epu32(t, w[i - 1]);
+      }
+      __m128i msg = _mm_add_epi32(w[i], _mm_loadu_si128((const __m128i*) &SHA256_K[i * 4]));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      msg = _mm_shuffle_epi32(msg, 0x0E);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+    }
+
+    state0 = _mm_add_epi32(state0, abefSave);
+    state1 = _mm_add_epi32(state1, cdghSave);
+  }
+
+  tmp = _mm_shuffle_epi32(state0, 0x1B);          // FEBA
+  state1 = _mm_shuffle_epi32(state1, 0xB1);       // DCHG
+  state0 = _mm_blend_epi16(tmp, state1, 0xF0);    // DCBA
+  state1 = _mm_alignr_epi8(state1, tmp, 8);       // HGFE
+  _mm_storeu_si128((__m128i*) &state[0], state0);
+  _mm_storeu_si128((__m128i*) &state[4], state1);
+}
+
+#endif // KERNELS_X86
+
+/// ***************************************************************************
+/// ***************************************************************************
+
+static const KernelTable g_scalar = {
+  BoundsReduceScalar,
+  DeltaEncodeScalar,
+  DeltaDecodeScalar,
+  Sha256BlocksScalar,
+  "scalar", "scalar", "scalar",
+};
+
+static KernelTable g_kernels = g_scalar;
+
+KernelTable const& GetKernels()
+{
+  return g_kernels;
+}
+
+KernelTable const& GetScalarKernels()
+{
+  return g_scalar;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void KernelsInit(CpuFeatures const& features)
+{
+  g_kernels = g_scalar;
+  #ifdef KERNELS_X86
+    if (features.avx512)
+    {
+      g_kernels.boundsReduce = BoundsReduceAVX512;
+      g_kernels.boundsReduceName = "avx512";
+    }
+    else if (features.avx2)
+    {
+      g_kernels.boundsReduce = BoundsReduceAVX2;
+      g_kernels.boundsReduceName = "avx2";
+    }
+
+    if (features.avx2)
+    {
+      g_kernels.deltaEncode = DeltaEncodeAVX2;
+      g_kernels.deltaDecode = DeltaDecodeSSE41;
+      g_kernels.deltaName = "avx2";
+    }
+    else if (features.sse41)
+    {
+      g_kernels.deltaEncode = DeltaEncodeSSE41;
+      g_kernels.deltaDecode = DeltaDecodeSSE41;
+      g_kernels.deltaName = "sse4.1";
+    }
+
+    if (features.sha)
+    {
+      g_kernels.sha256Blocks = Sha256BlocksSHA;
+      g_kernels.sha256Name = "sha";
+    }
+  #else
+    (void) features;
+  #endif
+}
+
+/// ***************************************************************************
+/// Deterministic pseudo random numbers for the self check.
+/// ***************************************************************************
+static uint32_t NextRandom(uint32_t& seed)
+{
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+const char* KernelsSelfCheck()
+{
+  uint32_t seed = 1;
+
+  // Sizes around the vector widths and block sizes of all variants.
+  static const size_t sizes[] = {1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 257};
+  for (size_t size : sizes)
+  {
+    std::vector<double> xyz(size * 3);
+    for (double& v : xyz)
+      v = (double) NextRandom(seed) / 65536.0 - 128.0;
+    double min1[3], max1[3], min2[3], max2[3];
+    g_scalar.boundsReduce(xyz.data(), size, min1, max1);
+    g_kernels.boundsReduce(xyz.data(), size, min2, max2);
+    if (memcmp(min1, min2, sizeof(min1)) || memcmp(max1, max2, sizeof(max1)))
+      return "boundsReduce";
+
+    std::vector<uint8_t> bytes(size), enc1(size), enc2(size), dec(size);
+    for (uint8_t& b : bytes)
+      b = (uint8_t) NextRandom(seed);
+    g_scalar.deltaEncode(bytes.data(), size, enc1.data());
+    g_kernels.deltaEncode(bytes.data(), size, enc2.data());
+    if (enc1 != enc2) return "deltaEncode";
+    g_kernels.deltaDecode(enc1.data(), size, dec.data());
+    if (dec != bytes) return "deltaDecode";
+    g_kernels.deltaDecode(enc1.data(), size, enc1.data());
+    if (enc1 != bytes) return "deltaDecode";
+  }
+
+  for (size_t blocks=1; blocks <= 4; blocks++)
+  {
+    std::vector<uint8_t> data(blocks * 64);
+    for (uint8_t& b : data)
+      b = (uint8_t) NextRandom(seed);
+    uint32_t state1[8], state2[8];
+    for (int i=0; i < 8; i++)
+      state1[i] = state2[i] = NextRandom(seed) * 2654435761u;
+    g_scalar.sha256Blocks(state1, data.data(), blocks);
+    g_kernels.sha256Blocks(state2, data.data(), blocks);
+    if (memcmp(state1, state2, sizeof(state1)))
+      return "sha256Blocks";
+  }
+  return nullptr;
+}
@@ -0,0 +1,65 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/Kernels.h
+///
+/// Inner loops with SIMD variants that are selected once at startup
+/// based on the CPU features. Every kernel has a scalar reference that
+/// the other variants are checked against. Does not depend on the
+/// Cinema 4D API.
+
+#pragma once
+
+#include "CpuFeatures.h"
+#include <cstddef>
+#include <cstdint>
+
+/// ***************************************************************************
+/// The active kernel variants.
+/// ***************************************************************************
+struct KernelTable
+{
+  /// Computes the component-wise minimum and maximum of \p count > 0
+  /// points that are stored as consecutive x, y, z doubles.
+  void (*boundsReduce)(const double* xyz, size_t count, double* bbmin, double* bbmax);
+
+  /// Stores the difference of every byte to the byte before it, the
+  /// first byte is stored as is. \p src and \p dst must not overlap.
+  void (*deltaEncode)(const uint8_t* src, size_t count, uint8_t* dst);
+
+  /// Reverses deltaEncode(). \p src and \p dst may be the same.
+  void (*deltaDecode)(const uint8_t* src, size_t count, uint8_t* dst);
+
+  /// Runs the SHA-256 compression function over \p count 64 byte blocks.
+  void (*sha256Blocks)(uint32_t state[8], const uint8_t* data, size_t count);
+
+  const char* boundsReduceName;
+  const char* deltaName;
+  const char* sha256Name;
+};
+
+/// ***************************************************************************
+/// Returns the active kernels. These are the scalar kernels until
+/// KernelsInit() is called.
+/// ***************************************************************************
+KernelTable const& GetKernels();
+
+/// ***************************************************************************
+/// Returns the scalar reference kernels.
+/// ***************************************************************************
+KernelTable const& GetScalarKernels();
+
+/// ***************************************************************************
+/// Selects the best kernels for \p features. Must be called before any
+/// other threads use the kernels, ie. from PluginStart().
+/// ***************************************************************************
+void KernelsInit(CpuFeatures const& features);
+
+/// ***************************************************************************
+/// Compares the active kernels with the scalar references on generated
+/// input. Returns the name of the first kernel that disagrees, or
+/// \c nullptr if all agree.
+/// ***************************************************************************
+const char* KernelsSelfCheck();
@@ -0,0 +1,113 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/MappedFile.cpp
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+/// ***************************************************************************
+/// ***************************************************************************
+MappedFile::MappedFile() : m_data(nullptr), m_size(0), m_file(nullptr), m_mapping(nullptr)
+{
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool MappedFile::Open(std::string const& filename)
+{
+  Close();
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) return false;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+  {
+    CloseHandle(file);
+    return false;
+  }
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping)
+  {
+    CloseHandle(file);
+    return false;
+  }
+  void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!data)
+  {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+  m_file = file;
+  m_mapping = mapping;
+  m_data = static_cast<const uint8_t*>(data);
+  m_size = (size_t) size.QuadPart;
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void MappedFile::Close()
+{
+  if (m_data) UnmapViewOfFile(m_data);
+  if (m_mapping) CloseHandle(m_mapping);
+  if (m_file) CloseHandle(m_file);
+  m_data = nullptr;
+  m_size = 0;
+  m_file = m_mapping = nullptr;
+}
+
+#else
+
+/// ***************************************************************************
+/// ***************************************************************************
+MappedFile::MappedFile() : m_data(nullptr), m_size(0)
+{
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool MappedFile::Open(std::string const& filename)
+{
+  Close();
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0)
+  {
+    close(fd);
+    return false;
+  }
+  // The mapping stays valid after the descriptor is closed.
+  void* data = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return false;
+  m_data = static_cast<const uint8_t*>(data);
+  m_size = (size_t) st.st_size;
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void MappedFile::Close()
+{
+  if (m_data) munmap(const_cast<uint8_t*>(m_data), m_size);
+  m_data = nullptr;
+  m_size = 0;
+}
+
+#endif
@@ -0,0 +1,46 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/MappedFile.h
+///
+/// Read-only memory mapping of a whole file. Pages are loaded by the
+/// operating system when they are first accessed and can be dropped
+/// again under memory pressure. Does not depend on the Cinema 4D API.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// ***************************************************************************
+/// ***************************************************************************
+class MappedFile
+{
+  const uint8_t* m_data;
+  size_t m_size;
+#ifdef _WIN32
+  void* m_file;
+  void* m_mapping;
+#endif
+
+  MappedFile(MappedFile const&);
+  MappedFile& operator = (MappedFile const&);
+
+public:
+
+  MappedFile();
+  ~MappedFile() { Close(); }
+
+  /// Maps the file \p filename, closing the previous mapping. Returns
+  /// \c false if the file can not be mapped. Empty files can't be mapped.
+  bool Open(std::string const& filename);
+
+  void Close();
+
+  bool IsOpen() const { return m_data != nullptr; }
+  const uint8_t* GetData() const { return m_data; }
+  size_t GetSize() const { return m_size; }
+};
@@ -12,6 +12,7 @@
 #include <c4d.h>
 #include <c4d_legacy.h>
 #include <c4d_apibridge.h>
+#include <string>
 
 #if API_VERSION < 15000
 namespace maxon {
@@ -33,6 +34,19 @@ inline String HashString(const String& input)
   return String(sha256.getHash().c_str());
 }
 
+/// ***************************************************************************
+/// Converts a Cinema 4D string to a UTF-8 encoded std::string, for use as
+/// a key in standard containers.
+/// ***************************************************************************
+inline std::string ToStdString(const String& str)
+{
+  std::string result;
+  CHAR* cstr = str.GetCStringCopy(STRINGENCODING_UTF8);
+  if (cstr) result = cstr;
+  DeleteMem(cstr);
+  return result;
+}
+
 /// ***************************************************************************
 /// Converts a Cinema 4D Vector to a string.
 /// ***************************************************************************
@@ -148,6 +162,50 @@ public:
   }
 };
 
+/// ***************************************************************************
+/// Removes \p node from the document. If \p doc is not \c nullptr, an undo
+/// is added and the undo step owns the node from then on, it must not be
+/// freed. Otherwise the node is freed. \p node is \c nullptr afterwards.
+/// ***************************************************************************
+template <typename T>
+inline void RemoveWithUndo(T*& node, BaseDocument* doc)
+{
+  if (doc) doc->AddUndo(UNDOTYPE_DELETE, node);
+  node->Remove();
+  if (!doc) T::Free(node);
+  node = nullptr;
+}
+
+/// ***************************************************************************
+/// Returns the bytes of the marker of \p node. Unlike its address, the
+/// marker is not reused when the node is freed and another is allocated.
+/// ***************************************************************************
+inline std::string GetMarkerKey(BaseList2D* node)
+{
+  void* mem = nullptr;
+  LONG size = 0;
+  node->GetMarker().GetMemory(mem, size);
+  if (!mem || size <= 0) return std::string();
+  return std::string(static_cast<const char*>(mem), (size_t) size);
+}
+
+/// ***************************************************************************
+/// Returns a combination of the dirty counts of all objects and tags in the
+/// hierarchy below \p root, excluding \p root itself. The result changes
+/// whenever any of these nodes changes, or nodes are added or removed.
+/// ***************************************************************************
+inline ULONG GetHierarchyDirty(BaseObject* root, DIRTYFLAGS flags)
+{
+  ULONG dirty = 0;
+  for (NodeIterator<BaseObject> it(root->GetDown(), root); it; ++it)
+  {
+    dirty = dirty * 31 + it->GetDirty(flags);
+    for (BaseTag* tag = it->GetFirstTag(); tag; tag = tag->GetNext())
+      dirty = dirty * 31 + tag->GetDirty(flags);
+  }
+  return dirty;
+}
+
 /// ***************************************************************************
 /// Opens a dialog to let the user enter a password. If `singleField`
 /// is set to true, only a single input field is displayed. If set to
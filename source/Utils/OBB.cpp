@@ -0,0 +1,145 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/OBB.cpp
+
+#include "OBB.h"
+#include <algorithm>
+#include <cmath>
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool OBB::IsOutside(BVHPlane const& plane) const
+{
+  // Distance of the center and the projected radius of the box.
+  Real dist = Dot(plane.normal, center) + plane.d;
+  Real radius =
+    std::abs(Dot(plane.normal, axes[0])) * extent.x +
+    std::abs(Dot(plane.normal, axes[1])) * extent.y +
+    std::abs(Dot(plane.normal, axes[2])) * extent.z;
+  return dist < -radius;
+}
+
+/// ***************************************************************************
+/// Computes the eigenvectors of the symmetric 3x3 matrix \p a with the
+/// cyclic Jacobi method. The eigenvectors are stored in the columns of
+/// \p v. \p a is destroyed.
+/// ***************************************************************************
+static void JacobiEigenvectors(Real a[3][3], Real v[3][3])
+{
+  for (LONG i=0; i < 3; i++)
+    for (LONG j=0; j < 3; j++)
+      v[i][j] = (i == j ? 1.0 : 0.0);
+
+  for (LONG sweep=0; sweep < 16; sweep++)
+  {
+    Real off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+    if (off < 1.0e-20) break;
+
+    for (LONG p=0; p < 2; p++)
+    {
+      for (LONG q=p+1; q < 3; q++)
+      {
+        if (std::abs(a[p][q]) < 1.0e-20) continue;
+
+        // Rotation that annihilates a[p][q].
+        Real theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+        Real t = 1.0 / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+        if (theta < 0) t = -t;
+        Real c = 1.0 / std::sqrt(t * t + 1.0);
+        Real s = t * c;
+
+        for (LONG k=0; k < 3; k++)
+        {
+          Real akp = a[k][p], akq = a[k][q];
+          a[k][p] = c * akp - s * akq;
+          a[k][q] = s * akp + c * akq;
+        }
+        for (LONG k=0; k < 3; k++)
+        {
+          Real apk = a[p][k], aqk = a[q][k];
+          a[p][k] = c * apk - s * aqk;
+          a[q][k] = s * apk + c * aqk;
+        }
+        for (LONG k=0; k < 3; k++)
+        {
+          Real vkp = v[k][p], vkq = v[k][q];
+          v[k][p] = c * vkp - s * vkq;
+          v[k][q] = s * vkp + c * vkq;
+        }
+      }
+    }
+  }
+}
+
+/// ***************************************************************************
+/// Fits the box with the axes of \p box to \p points.
+/// ***************************************************************************
+static void FitToAxes(Vector const* points, LONG count, OBB& box)
+{
+  Vector bbmin, bbmax;
+  for (LONG i=0; i < count; i++)
+  {
+    Vector p(Dot(points[i], box.axes[0]), Dot(points[i], box.axes[1]), Dot(points[i], box.axes[2]));
+    if (i == 0)
+    {
+      bbmin = bbmax = p;
+      continue;
+    }
+    bbmin = Vector(std::min(bbmin.x, p.x), std::min(bbmin.y, p.y), std::min(bbmin.z, p.z));
+    bbmax = Vector(std::max(bbmax.x, p.x), std::max(bbmax.y, p.y), std::max(bbmax.z, p.z));
+  }
+  Vector mid = (bbmin + bbmax) * 0.5;
+  box.center = box.axes[0] * mid.x + box.axes[1] * mid.y + box.axes[2] * mid.z;
+  box.extent = (bbmax - bbmin) * 0.5;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool ComputeOBB(Vector const* points, LONG count, OBB& out)
+{
+  if (count <= 0) return false;
+
+  // Axis-aligned candidate.
+  OBB aligned;
+  aligned.axes[0] = Vector(1, 0, 0);
+  aligned.axes[1] = Vector(0, 1, 0);
+  aligned.axes[2] = Vector(0, 0, 1);
+  FitToAxes(points, count, aligned);
+  out = aligned;
+  if (count < 4) return true;
+
+  // Covariance matrix of the points.
+  Vector mean;
+  for (LONG i=0; i < count; i++)
+    mean += points[i];
+  mean = mean / (Real) count;
+
+  Real cov[3][3] = {{0}};
+  for (LONG i=0; i < count; i++)
+  {
+    Vector d = points[i] - mean;
+    Real c[3] = {d.x, d.y, d.z};
+    for (LONG j=0; j < 3; j++)
+      for (LONG k=j; k < 3; k++)
+        cov[j][k] += c[j] * c[k];
+  }
+  cov[1][0] = cov[0][1];
+  cov[2][0] = cov[0][2];
+  cov[2][1] = cov[1][2];
+
+  Real v[3][3];
+  JacobiEigenvectors(cov, v);
+
+  OBB principal;
+  principal.axes[0] = Vector(v[0][0], v[1][0], v[2][0]).GetNormalized();
+  principal.axes[1] = Vector(v[0][1], v[1][1], v[2][1]).GetNormalized();
+  principal.axes[2] = Cross(principal.axes[0], principal.axes[1]).GetNormalized();
+  FitToAxes(points, count, principal);
+
+  if (principal.GetVolume() < aligned.GetVolume())
+    out = principal;
+  return true;
+}
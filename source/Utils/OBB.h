@@ -0,0 +1,53 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/OBB.h
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+#include "BVH.h"
+
+/// ***************************************************************************
+/// An oriented bounding box given by its center, three orthonormal axes
+/// and the half size along each axis.
+/// ***************************************************************************
+struct OBB
+{
+  Vector center;
+  Vector axes[3];
+  Vector extent;
+
+  /// Returns a matrix whose offset is the center and whose axes are
+  /// scaled by the extent, mapping the unit cube [-1, 1] onto the box.
+  Matrix GetMatrix() const
+  {
+    return Matrix(center, axes[0] * extent.x, axes[1] * extent.y, axes[2] * extent.z);
+  }
+
+  /// Returns the volume of the box.
+  Real GetVolume() const
+  {
+    return extent.x * extent.y * extent.z * 8.0;
+  }
+
+  Bool operator == (OBB const& other) const
+  {
+    return center == other.center && extent == other.extent && axes[0] == other.axes[0] &&
+        axes[1] == other.axes[1] && axes[2] == other.axes[2];
+  }
+
+  /// Returns \c true if the box is completely outside of \p plane.
+  Bool IsOutside(BVHPlane const& plane) const;
+};
+
+/// ***************************************************************************
+/// Computes an oriented bounding box of \p count points. The axes are the
+/// principal components of the point cloud. If the axis-aligned box is
+/// smaller, which can happen for boxy point clouds, it is used instead.
+/// Returns \c false if \p count is zero.
+/// ***************************************************************************
+Bool ComputeOBB(Vector const* points, LONG count, OBB& out);
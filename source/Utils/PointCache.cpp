@@ -0,0 +1,174 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/PointCache.cpp
+
+#include "PointCache.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const char MAGIC[4] = {'N', 'R', 'P', 'C'};
+static const uint32_t VERSION = 1;
+static const size_t HEADER_SIZE = 24;
+
+/// ***************************************************************************
+/// Size of the block of an object with \p count points.
+/// ***************************************************************************
+static size_t GetBlockSize(uint32_t count)
+{
+  return 6 * sizeof(float) + (((size_t) count * 6 + 3) & ~(size_t) 3);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool PointCacheWriter::Open(std::string const& filename, int32_t firstFrame,
+    std::vector<uint32_t> const& counts)
+{
+  Close();
+  m_fp = fopen(filename.c_str(), "wb");
+  if (!m_fp) return false;
+  m_counts = counts;
+  m_frames = 0;
+
+  uint32_t header[6] = {0, VERSION, (uint32_t) counts.size(), 0, (uint32_t) firstFrame, 0};
+  memcpy(header, MAGIC, 4);
+  bool ok = fwrite(header, sizeof(header), 1, m_fp) == 1;
+  if (!counts.empty())
+    ok = ok && fwrite(counts.data(), sizeof(uint32_t), counts.size(), m_fp) == counts.size();
+  if (!ok) Close();
+  return ok;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool PointCacheWriter::AddFrame(const double* const* objects)
+{
+  if (!m_fp) return false;
+  for (size_t i=0; i < m_counts.size(); i++)
+  {
+    const double* xyz = objects[i];
+    uint32_t count = m_counts[i];
+    m_buffer.assign(GetBlockSize(count), 0);
+
+    float origin[3] = {0.0f, 0.0f, 0.0f}, step[3] = {0.0f, 0.0f, 0.0f};
+    for (int c=0; c < 3 && count > 0; c++)
+    {
+      double lo = xyz[c], hi = xyz[c];
+      for (uint32_t j=1; j < count; j++)
+      {
+        lo = std::min(lo, xyz[j * 3 + c]);
+        hi = std::max(hi, xyz[j * 3 + c]);
+      }
+      origin[c] = (float) lo;
+      step[c] = (float) ((hi - lo) / 65535.0);
+    }
+    memcpy(m_buffer.data(), origin, sizeof(origin));
+    memcpy(m_buffer.data() + sizeof(origin), step, sizeof(step));
+
+    uint16_t* q = reinterpret_cast<uint16_t*>(m_buffer.data() + 6 * sizeof(float));
+    for (uint32_t j=0; j < count; j++)
+    {
+      for (int c=0; c < 3; c++)
+      {
+        double value = step[c] > 0.0f ? (xyz[j * 3 + c] - origin[c]) / step[c] : 0.0;
+        q[j * 3 + c] = (uint16_t) std::min(std::max(std::floor(value + 0.5), 0.0), 65535.0);
+      }
+    }
+    if (fwrite(m_buffer.data(), 1, m_buffer.size(), m_fp) != m_buffer.size())
+      return false;
+  }
+  m_frames++;
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool PointCacheWriter::Close()
+{
+  if (!m_fp) return false;
+  bool ok = fseek(m_fp, 12, SEEK_SET) == 0 && fwrite(&m_frames, sizeof(m_frames), 1, m_fp) == 1;
+  ok = fclose(m_fp) == 0 && ok;
+  m_fp = nullptr;
+  return ok;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool PointCacheReader::Open(std::string const& filename)
+{
+  Close();
+  if (!m_file.Open(filename)) return false;
+  const uint8_t* data = m_file.GetData();
+  size_t size = m_file.GetSize();
+
+  uint32_t header[6];
+  if (size < HEADER_SIZE)
+  {
+    Close();
+    return false;
+  }
+  memcpy(header, data, sizeof(header));
+  if (memcmp(data, MAGIC, 4) != 0 || header[1] != VERSION)
+  {
+    Close();
+    return false;
+  }
+
+  uint32_t objects = header[2];
+  m_frames = header[3];
+  m_firstFrame = (int32_t) header[4];
+  m_dataOffset = HEADER_SIZE + (size_t) objects * sizeof(uint32_t);
+  if (size < m_dataOffset)
+  {
+    Close();
+    return false;
+  }
+  m_counts.resize(objects);
+  if (objects > 0)
+    memcpy(m_counts.data(), data + HEADER_SIZE, objects * sizeof(uint32_t));
+
+  m_offsets.resize(objects);
+  m_frameSize = 0;
+  for (uint32_t i=0; i < objects; i++)
+  {
+    m_offsets[i] = m_frameSize;
+    m_frameSize += GetBlockSize(m_counts[i]);
+  }
+  if (m_frameSize > 0 && (size - m_dataOffset) / m_frameSize < m_frames)
+  {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void PointCacheReader::Close()
+{
+  m_file.Close();
+  m_frames = 0;
+  m_counts.clear();
+  m_offsets.clear();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void PointCacheReader::ReadPoints(uint32_t frame, uint32_t object, double* xyz) const
+{
+  const uint8_t* block = m_file.GetData() + m_dataOffset + frame * m_frameSize + m_offsets[object];
+  float origin[3], step[3];
+  memcpy(origin, block, sizeof(origin));
+  memcpy(step, block + sizeof(origin), sizeof(step));
+  const uint16_t* q = reinterpret_cast<const uint16_t*>(block + 6 * sizeof(float));
+  uint32_t count = m_counts[object];
+  for (uint32_t j=0; j < count; j++)
+  {
+    xyz[j * 3 + 0] = origin[0] + q[j * 3 + 0] * (double) step[0];
+    xyz[j * 3 + 1] = origin[1] + q[j * 3 + 1] * (double) step[1];
+    xyz[j * 3 + 2] = origin[2] + q[j * 3 + 2] * (double) step[2];
+  }
+}
@@ -0,0 +1,95 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/PointCache.h
+///
+/// Point positions of a set of objects over a range of frames, quantized
+/// to 16 bits per component within the bounds of every object in every
+/// frame. The file is memory mapped for playback. Does not depend on the
+/// Cinema 4D API.
+///
+/// Layout, in the byte order of the machine that wrote it:
+///
+///     char[4]  magic "NRPC"
+///     u32      version (1)
+///     u32      number of objects
+///     u32      number of frames
+///     i32      first frame
+///     u32      reserved
+///     u32[]    number of points of every object
+///     frame*   frames
+///
+/// A frame is a block for every object, a block is the origin and the
+/// step of the quantization as float[3] each, followed by three u16 per
+/// point, padded to a multiple of 4 bytes.
+
+#pragma once
+
+#include "MappedFile.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/// ***************************************************************************
+/// Writes a point cache frame by frame.
+/// ***************************************************************************
+class PointCacheWriter
+{
+  FILE* m_fp;
+  std::vector<uint32_t> m_counts;
+  uint32_t m_frames;
+  std::vector<uint8_t> m_buffer;
+
+  PointCacheWriter(PointCacheWriter const&);
+  PointCacheWriter& operator = (PointCacheWriter const&);
+
+public:
+
+  PointCacheWriter() : m_fp(nullptr), m_frames(0) { }
+  ~PointCacheWriter() { Close(); }
+
+  /// Creates the file \p filename for objects with \p counts points that
+  /// starts at \p firstFrame.
+  bool Open(std::string const& filename, int32_t firstFrame, std::vector<uint32_t> const& counts);
+
+  /// Appends the next frame. \p objects has a pointer for every object
+  /// to its points, stored as consecutive x, y, z doubles.
+  bool AddFrame(const double* const* objects);
+
+  /// Completes the file. Returns \c false if any write failed.
+  bool Close();
+};
+
+/// ***************************************************************************
+/// Reads a memory mapped point cache. Reading is thread-safe.
+/// ***************************************************************************
+class PointCacheReader
+{
+  MappedFile m_file;
+  uint32_t m_frames;
+  int32_t m_firstFrame;
+  std::vector<uint32_t> m_counts;
+  std::vector<size_t> m_offsets;   ///< Offset of the block of every object in a frame.
+  size_t m_frameSize;
+  size_t m_dataOffset;
+
+public:
+
+  PointCacheReader() : m_frames(0), m_firstFrame(0), m_frameSize(0), m_dataOffset(0) { }
+
+  bool Open(std::string const& filename);
+  void Close();
+
+  bool IsOpen() const { return m_file.IsOpen(); }
+  uint32_t GetObjectCount() const { return (uint32_t) m_counts.size(); }
+  uint32_t GetFrameCount() const { return m_frames; }
+  int32_t GetFirstFrame() const { return m_firstFrame; }
+  uint32_t GetPointCount(uint32_t object) const { return m_counts[object]; }
+
+  /// Decodes the points of \p object in \p frame, counted from the first
+  /// frame, into \p xyz.
+  void ReadPoints(uint32_t frame, uint32_t object, double* xyz) const;
+};
@@ -0,0 +1,142 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/ScratchArena.cpp
+
+#include "ScratchArena.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static const size_t MIN_BLOCKSIZE = 64 * 1024;
+
+/// Memory kept by an empty arena. Larger arenas give the rest back.
+static const size_t MAX_RETAINED = 1024 * 1024;
+
+static std::atomic<long long> g_reused(0);
+static std::atomic<long long> g_allocated(0);
+
+/// ***************************************************************************
+/// ***************************************************************************
+ScratchArena::~ScratchArena()
+{
+  for (Block& block : m_blocks)
+    free(block.data);
+}
+
+/// ***************************************************************************
+/// Counts the bytes [begin, end) of \p block as reused or new.
+/// ***************************************************************************
+void ScratchArena::Account(Block& block, size_t begin, size_t end)
+{
+  size_t reused = 0;
+  if (begin < block.highWater)
+    reused = (end < block.highWater ? end : block.highWater) - begin;
+  if (reused)
+    g_reused.fetch_add((long long) reused, std::memory_order_relaxed);
+  if (end - begin > reused)
+    g_allocated.fetch_add((long long) (end - begin - reused), std::memory_order_relaxed);
+  if (end > block.highWater)
+    block.highWater = end;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void* ScratchArena::Allocate(size_t size, size_t align)
+{
+  if (size == 0) size = 1;
+  while (true)
+  {
+    if (m_block < m_blocks.size())
+    {
+      Block& block = m_blocks[m_block];
+      size_t begin = (m_offset + align - 1) & ~(align - 1);
+      if (begin + size <= block.size)
+      {
+        Account(block, begin, begin + size);
+        m_offset = begin + size;
+        return block.data + begin;
+      }
+      if (m_offset == 0)
+      {
+        // This block is empty but too small. Nothing after the current
+        // position is in use, so it can be replaced by a larger block.
+        free(block.data);
+        m_blocks.erase(m_blocks.begin() + m_block);
+        continue;
+      }
+      m_block++;
+      m_offset = 0;
+      continue;
+    }
+
+    Block block;
+    block.size = size + align > MIN_BLOCKSIZE ? size + align : MIN_BLOCKSIZE;
+    block.data = static_cast<uint8_t*>(malloc(block.size));
+    block.highWater = 0;
+    if (!block.data) throw std::bad_alloc();
+    m_blocks.push_back(block);
+    m_offset = 0;
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool ScratchArena::TryExtend(void* ptr, size_t size, size_t newSize)
+{
+  if (m_block >= m_blocks.size()) return false;
+  Block& block = m_blocks[m_block];
+  uint8_t* p = static_cast<uint8_t*>(ptr);
+  if (p + size != block.data + m_offset) return false;
+  size_t begin = p - block.data;
+  if (begin + newSize > block.size) return false;
+  Account(block, m_offset, begin + newSize);
+  m_offset = begin + newSize;
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void ScratchArena::Reset(Marker const& marker)
+{
+  m_block = marker.block;
+  m_offset = marker.offset;
+  if (m_block != 0 || m_offset != 0) return;
+
+  size_t retained = 0;
+  for (size_t i=0; i < m_blocks.size(); i++)
+  {
+    retained += m_blocks[i].size;
+    if (retained > MAX_RETAINED && i > 0)
+    {
+      for (size_t j=i; j < m_blocks.size(); j++)
+        free(m_blocks[j].data);
+      m_blocks.resize(i);
+      break;
+    }
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+ScratchArena& ScratchArena::GetThreadArena()
+{
+  static thread_local ScratchArena arena;
+  return arena;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+long long GetScratchBytesReused()
+{
+  return g_reused.load(std::memory_order_relaxed);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+long long GetScratchBytesAllocated()
+{
+  return g_allocated.load(std::memory_order_relaxed);
+}
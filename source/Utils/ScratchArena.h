@@ -0,0 +1,158 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/ScratchArena.h
+///
+/// Per-thread bump allocator for temporary arrays of traversals and
+/// pack-up operations. Memory is released in bulk when a ScratchScope
+/// ends and reused by the next scope on the same thread, so hot paths
+/// don't allocate from the heap once the arena has grown to their needs.
+/// Does not depend on the Cinema 4D API.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+/// ***************************************************************************
+/// ***************************************************************************
+class ScratchArena
+{
+public:
+
+  /// A position in the arena that it can be reset to.
+  struct Marker
+  {
+    size_t block;
+    size_t offset;
+  };
+
+  ScratchArena() : m_block(0), m_offset(0) { }
+  ~ScratchArena();
+
+  /// Returns \p size bytes aligned to \p align. Never returns \c nullptr.
+  void* Allocate(size_t size, size_t align=alignof(std::max_align_t));
+
+  /// Grows the last allocation \p ptr of \p size bytes to \p newSize
+  /// bytes if it is at the top of the arena and the block has room.
+  bool TryExtend(void* ptr, size_t size, size_t newSize);
+
+  Marker GetMarker() const { Marker m = {m_block, m_offset}; return m; }
+
+  /// Releases everything allocated since \p marker was taken. When the
+  /// arena becomes empty, memory beyond the retention limit is returned
+  /// to the heap.
+  void Reset(Marker const& marker);
+
+  /// Returns the arena of the calling thread.
+  static ScratchArena& GetThreadArena();
+
+private:
+
+  struct Block
+  {
+    uint8_t* data;
+    size_t size;
+    size_t highWater;   ///< Bytes of the block that were used before.
+  };
+
+  std::vector<Block> m_blocks;
+  size_t m_block;
+  size_t m_offset;
+
+  ScratchArena(ScratchArena const&);
+  ScratchArena& operator = (ScratchArena const&);
+
+  void Account(Block& block, size_t begin, size_t end);
+};
+
+/// ***************************************************************************
+/// Releases all scratch memory allocated on this thread during its
+/// lifetime when it goes out of scope.
+/// ***************************************************************************
+class ScratchScope
+{
+  ScratchArena& m_arena;
+  ScratchArena::Marker m_marker;
+
+public:
+
+  ScratchScope() : m_arena(ScratchArena::GetThreadArena()), m_marker(m_arena.GetMarker()) { }
+  ~ScratchScope() { m_arena.Reset(m_marker); }
+
+  ScratchArena& GetArena() const { return m_arena; }
+
+private:
+
+  ScratchScope(ScratchScope const&);
+  ScratchScope& operator = (ScratchScope const&);
+};
+
+/// ***************************************************************************
+/// A growable array in the scratch arena of a ScratchScope. Only for
+/// types that can be copied bitwise, the elements are never destructed.
+/// ***************************************************************************
+template <typename T>
+class ScratchVector
+{
+  static_assert(std::is_trivially_destructible<T>::value, "ScratchVector elements are never destructed");
+
+  ScratchArena& m_arena;
+  T* m_data;
+  size_t m_size;
+  size_t m_capacity;
+
+public:
+
+  explicit ScratchVector(ScratchScope const& scope, size_t capacity=16)
+  : m_arena(scope.GetArena()), m_data(nullptr), m_size(0), m_capacity(0)
+  {
+    Reserve(capacity);
+  }
+
+  void Reserve(size_t capacity)
+  {
+    if (capacity <= m_capacity) return;
+    if (m_data && m_arena.TryExtend(m_data, m_capacity * sizeof(T), capacity * sizeof(T)))
+    {
+      m_capacity = capacity;
+      return;
+    }
+    T* data = static_cast<T*>(m_arena.Allocate(capacity * sizeof(T), alignof(T)));
+    if (m_size) memcpy(data, m_data, m_size * sizeof(T));
+    m_data = data;
+    m_capacity = capacity;
+  }
+
+  void PushBack(T const& value)
+  {
+    if (m_size == m_capacity)
+      Reserve(m_capacity ? m_capacity * 2 : 16);
+    m_data[m_size++] = value;
+  }
+
+  T PopBack() { return m_data[--m_size]; }
+  T& Back() { return m_data[m_size - 1]; }
+  void Clear() { m_size = 0; }
+
+  bool IsEmpty() const { return m_size == 0; }
+  size_t GetSize() const { return m_size; }
+  T* GetData() { return m_data; }
+  T const* GetData() const { return m_data; }
+  T& operator [] (size_t index) { return m_data[index]; }
+  T const& operator [] (size_t index) const { return m_data[index]; }
+  T* begin() { return m_data; }
+  T* end() { return m_data + m_size; }
+};
+
+/// ***************************************************************************
+/// Returns the number of scratch bytes, summed over all threads, that were
+/// served from memory used before, and from memory used the first time.
+/// ***************************************************************************
+long long GetScratchBytesReused();
+long long GetScratchBytesAllocated();
@@ -0,0 +1,80 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/Sha256.cpp
+
+#include "Sha256.h"
+#include "Kernels.h"
+#include <cstring>
+
+/// ***************************************************************************
+/// ***************************************************************************
+void Sha256Hasher::Reset()
+{
+  static const uint32_t initial[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+  };
+  memcpy(m_state, initial, sizeof(m_state));
+  m_bufferSize = 0;
+  m_length = 0;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void Sha256Hasher::Add(const void* data, size_t size)
+{
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  m_length += size;
+
+  if (m_bufferSize > 0)
+  {
+    size_t n = 64 - m_bufferSize;
+    if (n > size) n = size;
+    memcpy(m_buffer + m_bufferSize, p, n);
+    m_bufferSize += n;
+    p += n;
+    size -= n;
+    if (m_bufferSize < 64) return;
+    GetKernels().sha256Blocks(m_state, m_buffer, 1);
+    m_bufferSize = 0;
+  }
+
+  // Hash full blocks directly from the input.
+  size_t blocks = size / 64;
+  if (blocks > 0)
+  {
+    GetKernels().sha256Blocks(m_state, p, blocks);
+    p += blocks * 64;
+    size -= blocks * 64;
+  }
+
+  memcpy(m_buffer, p, size);
+  m_bufferSize = size;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+std::string Sha256Hasher::GetHash()
+{
+  uint64_t bits = m_length * 8;
+  uint8_t padding[72] = {0x80};
+  size_t padSize = (m_bufferSize < 56 ? 56 : 120) - m_bufferSize;
+  uint8_t length[8];
+  for (int i=0; i < 8; i++)
+    length[i] = (uint8_t) (bits >> (56 - i * 8));
+  Add(padding, padSize);
+  Add(length, 8);
+
+  static const char digits[] = "0123456789abcdef";
+  std::string hash(64, '0');
+  for (int i=0; i < 8; i++)
+  {
+    for (int j=0; j < 8; j++)
+      hash[i * 8 + j] = digits[(m_state[i] >> (28 - j * 4)) & 15];
+  }
+  Reset();
+  return hash;
+}
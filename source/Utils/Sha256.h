@@ -0,0 +1,39 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/Sha256.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// ***************************************************************************
+/// SHA-256 that runs the compression function through the dispatched
+/// kernel in Utils/Kernels.h. Produces the same lowercase hex digests as
+/// the `SHA256` class of the hash-library, which is still used for the
+/// password hashes.
+/// ***************************************************************************
+class Sha256Hasher
+{
+  uint32_t m_state[8];
+  uint8_t m_buffer[64];
+  size_t m_bufferSize;
+  uint64_t m_length;
+
+public:
+
+  Sha256Hasher() { Reset(); }
+
+  /// Starts a new hash.
+  void Reset();
+
+  /// Adds \p size bytes from \p data to the hash.
+  void Add(const void* data, size_t size);
+
+  /// Returns the hex digest of the data added so far. Resets the hasher.
+  std::string GetHash();
+};
@@ -0,0 +1,86 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/Stats.cpp
+
+#include "Stats.h"
+#include "ScratchArena.h"
+#include <atomic>
+
+// Implemented in EvalProfile.cpp.
+extern String GetEvaluationReport();
+
+static std::atomic<long long> g_counters[STATCOUNTER_COUNT];
+
+static const char* const g_counterNames[STATCOUNTER_COUNT] = {
+  "Description requests",
+  "Description modifications",
+  "Dependency cache hits",
+  "Dependency cache misses",
+  "Bounding box cache hits",
+  "Bounding box cache misses",
+  "Bounding box caches restored",
+  "Containers warmed after loading",
+  "Icon cache hits",
+  "Icon cache misses",
+  "Spatial index queries",
+  "Spatial index refits",
+  "Spatial index rebuilds",
+};
+
+/// ***************************************************************************
+/// ***************************************************************************
+const char* GetStatName(STATCOUNTER counter)
+{
+  return counter < STATCOUNTER_COUNT ? g_counterNames[counter] : "Unknown";
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void StatIncrement(STATCOUNTER counter, LLONG value)
+{
+  g_counters[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+LLONG StatGet(STATCOUNTER counter)
+{
+  return (LLONG) g_counters[counter].load(std::memory_order_relaxed);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void StatReset()
+{
+  for (LONG i=0; i < STATCOUNTER_COUNT; i++)
+    g_counters[i].store(0, std::memory_order_relaxed);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+String GetStatisticsReport()
+{
+  String report = "Container Object Statistics\n";
+  for (LONG i=0; i < STATCOUNTER_COUNT; i++)
+  {
+    report += "  " + String(g_counterNames[i]) + ": ";
+    report += LLongToString(StatGet((STATCOUNTER) i)) + "\n";
+  }
+  report += "  Scratch bytes reused: " + LLongToString((LLONG) GetScratchBytesReused()) + "\n";
+  report += "  Scratch bytes allocated: " + LLongToString((LLONG) GetScratchBytesAllocated()) + "\n";
+  report += GetEvaluationReport();
+  return report;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+String GetStatisticsSummary()
+{
+  LLONG requests = StatGet(STATCOUNTER_DESCRIPTION_REQUESTS);
+  LLONG modified = StatGet(STATCOUNTER_DESCRIPTION_MODIFIED);
+  return "Descriptions: " + LLongToString(requests) + " requested, " +
+    LLongToString(modified) + " modified";
+}
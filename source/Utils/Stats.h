@@ -0,0 +1,52 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/Stats.h
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+
+/// ***************************************************************************
+/// Global counters to see how often the plugin is called by Cinema 4D and
+/// how well its caches perform. Counters are process-wide and thread-safe.
+/// ***************************************************************************
+enum STATCOUNTER
+{
+  STATCOUNTER_DESCRIPTION_REQUESTS,
+  STATCOUNTER_DESCRIPTION_MODIFIED,
+  STATCOUNTER_DEPENDENCY_HITS,
+  STATCOUNTER_DEPENDENCY_MISSES,
+  STATCOUNTER_BBOX_HITS,
+  STATCOUNTER_BBOX_MISSES,
+  STATCOUNTER_BBOX_RESTORED,
+  STATCOUNTER_WARMUP_CONTAINERS,
+  STATCOUNTER_ICON_HITS,
+  STATCOUNTER_ICON_MISSES,
+  STATCOUNTER_INDEX_QUERIES,
+  STATCOUNTER_INDEX_REFITS,
+  STATCOUNTER_INDEX_REBUILDS,
+
+  STATCOUNTER_COUNT
+};
+
+/// Increments the counter \p counter by \p value.
+void StatIncrement(STATCOUNTER counter, LLONG value=1);
+
+/// Returns the current value of the counter \p counter.
+LLONG StatGet(STATCOUNTER counter);
+
+/// Returns the name of the counter \p counter.
+const char* GetStatName(STATCOUNTER counter);
+
+/// Resets all counters to zero.
+void StatReset();
+
+/// Returns a multi-line report of all counters.
+String GetStatisticsReport();
+
+/// Returns a short single-line summary for the developer info field.
+String GetStatisticsSummary();
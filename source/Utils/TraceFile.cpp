@@ -0,0 +1,228 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/TraceFile.cpp
+
+#include "TraceFile.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+static const char MAGIC[4] = {'N', 'R', 'C', 'T'};
+static const uint32_t VERSION = 1;
+
+/// Bytes buffered before they are written to the file.
+static const size_t FLUSH_SIZE = 64 * 1024;
+
+/// ***************************************************************************
+/// State of the running recording.
+/// ***************************************************************************
+struct TraceRecorder
+{
+  std::mutex lock;
+  FILE* fp;
+  std::vector<uint8_t> buffer;
+  uint64_t lastTime;
+  std::unordered_map<const void*, uint32_t> objects;
+  std::unordered_map<std::thread::id, uint8_t> threads;
+  uint32_t nextObject;
+
+  TraceRecorder() : fp(nullptr), lastTime(0), nextObject(0) { }
+};
+
+static TraceRecorder g_recorder;
+static std::atomic<bool> g_active(false);
+
+// Read by TraceNow() without the lock, in steady clock ticks.
+static std::atomic<int64_t> g_epoch(0);
+
+/// ***************************************************************************
+/// ***************************************************************************
+static void PutVarint(std::vector<uint8_t>& out, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    out.push_back((uint8_t) (value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((uint8_t) value);
+}
+
+/// ***************************************************************************
+/// Writes the buffered events. Must be called with the lock held.
+/// ***************************************************************************
+static void Flush()
+{
+  if (g_recorder.fp && !g_recorder.buffer.empty())
+    fwrite(g_recorder.buffer.data(), 1, g_recorder.buffer.size(), g_recorder.fp);
+  g_recorder.buffer.clear();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+const char* GetTraceEventName(uint32_t type)
+{
+  static const char* const names[TRACEEVENT_COUNT] = {
+    "GetDimension", "BoundingBoxMeasure", "GetInfo", "Message", "GetCustomIcon",
+    "GetDDescription", "GetDParameter", "SetDParameter", "Execute", "Draw"};
+  return type < TRACEEVENT_COUNT ? names[type] : "Unknown";
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool TraceStart(std::string const& filename)
+{
+  TraceStop();
+  std::lock_guard<std::mutex> lock(g_recorder.lock);
+  g_recorder.fp = fopen(filename.c_str(), "wb");
+  if (!g_recorder.fp) return false;
+
+  g_recorder.buffer.assign(MAGIC, MAGIC + 4);
+  for (int i=0; i < 4; i++)
+    g_recorder.buffer.push_back((uint8_t) (VERSION >> (8 * i)));
+  g_epoch = (int64_t) std::chrono::steady_clock::now().time_since_epoch().count();
+  g_recorder.lastTime = 0;
+  g_recorder.objects.clear();
+  g_recorder.threads.clear();
+  g_recorder.nextObject = 0;
+  g_active = true;
+  return true;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void TraceStop()
+{
+  g_active = false;
+  std::lock_guard<std::mutex> lock(g_recorder.lock);
+  if (!g_recorder.fp) return;
+  Flush();
+  fclose(g_recorder.fp);
+  g_recorder.fp = nullptr;
+  g_recorder.objects.clear();
+  g_recorder.threads.clear();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool TraceIsActive()
+{
+  return g_active.load(std::memory_order_relaxed);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+uint64_t TraceNow()
+{
+  std::chrono::steady_clock::duration elapsed(
+    (int64_t) std::chrono::steady_clock::now().time_since_epoch().count() - g_epoch.load());
+  return (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void TraceRecord(TRACEEVENT type, const void* object, uint32_t arg, uint64_t start)
+{
+  if (!TraceIsActive()) return;
+  uint64_t end = TraceNow();
+  std::lock_guard<std::mutex> lock(g_recorder.lock);
+  if (!g_recorder.fp) return;
+
+  auto obj = g_recorder.objects.find(object);
+  if (obj == g_recorder.objects.end())
+    obj = g_recorder.objects.emplace(object, g_recorder.nextObject++).first;
+  auto thread = g_recorder.threads.find(std::this_thread::get_id());
+  if (thread == g_recorder.threads.end())
+  {
+    uint8_t number = (uint8_t) std::min<size_t>(g_recorder.threads.size(), 255);
+    thread = g_recorder.threads.emplace(std::this_thread::get_id(), number).first;
+  }
+
+  // Events are recorded when the call returns, so the start times of
+  // nested and concurrent calls are not in order. The delta is stored
+  // zigzag encoded.
+  int64_t delta = (int64_t) (start - g_recorder.lastTime);
+  g_recorder.lastTime = start;
+
+  std::vector<uint8_t>& out = g_recorder.buffer;
+  out.push_back((uint8_t) type);
+  out.push_back(thread->second);
+  PutVarint(out, ((uint64_t) delta << 1) ^ (uint64_t) (delta >> 63));
+  PutVarint(out, end - start);
+  PutVarint(out, obj->second);
+  PutVarint(out, arg);
+  if (out.size() >= FLUSH_SIZE)
+    Flush();
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void TraceForget(const void* object)
+{
+  if (!TraceIsActive()) return;
+  std::lock_guard<std::mutex> lock(g_recorder.lock);
+  g_recorder.objects.erase(object);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+static bool GetVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value)
+{
+  value = 0;
+  for (int shift=0; shift < 64; shift += 7)
+  {
+    if (p == end) return false;
+    uint8_t byte = *p++;
+    value |= (uint64_t) (byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return true;
+  }
+  return false;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+bool TraceReadFile(std::string const& filename, std::vector<TraceEvent>& events)
+{
+  events.clear();
+  FILE* fp = fopen(filename.c_str(), "rb");
+  if (!fp) return false;
+  std::vector<uint8_t> data;
+  uint8_t buffer[64 * 1024];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+    data.insert(data.end(), buffer, buffer + count);
+  fclose(fp);
+
+  if (data.size() < 8 || memcmp(data.data(), MAGIC, 4) != 0) return false;
+  uint32_t version = data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t) data[7] << 24);
+  if (version != VERSION) return false;
+
+  const uint8_t* p = data.data() + 8;
+  const uint8_t* end = data.data() + data.size();
+  uint64_t time = 0;
+  while (p != end)
+  {
+    if (end - p < 2) return false;
+    TraceEvent event;
+    event.type = *p++;
+    event.thread = *p++;
+    uint64_t delta, duration, object, arg;
+    if (!GetVarint(p, end, delta) || !GetVarint(p, end, duration) ||
+        !GetVarint(p, end, object) || !GetVarint(p, end, arg))
+      return false;
+    time += (uint64_t) ((int64_t) (delta >> 1) ^ -(int64_t) (delta & 1));
+    event.time = time;
+    event.duration = (uint32_t) duration;
+    event.object = (uint32_t) object;
+    event.arg = (uint32_t) arg;
+    events.push_back(event);
+  }
+  return true;
+}
@@ -0,0 +1,129 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Utils/TraceFile.h
+///
+/// Records the calls Cinema 4D makes into the plugin to a compact binary
+/// trace, so that the `replay` tool can analyse them and run the recorded
+/// workload against the standalone parts of the plugin. Does not depend
+/// on the Cinema 4D API.
+///
+/// Layout, all integers little endian:
+///
+///     char[4]  magic "NRCT"
+///     u32      version (1)
+///     event*   events until the end of the file
+///
+/// Every event is a type byte, a thread byte and the varints of the time
+/// since the previous event, the duration, the object and the argument.
+/// Times are in microseconds.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// ***************************************************************************
+/// Recorded entry points. Don't reorder, the values are stored in traces.
+/// ***************************************************************************
+enum TRACEEVENT
+{
+  TRACEEVENT_GETDIMENSION,      ///< ObjectData::GetDimension()
+  TRACEEVENT_BBOX_MEASURE,      ///< Bounding box measured, argument is the number of points.
+  TRACEEVENT_GETINFO,           ///< GetInfo() hook
+  TRACEEVENT_MESSAGE,           ///< NodeData::Message(), argument is the message type.
+  TRACEEVENT_GETCUSTOMICON,     ///< MSG_GETCUSTOMICON, argument is the encoded icon size.
+  TRACEEVENT_GETDDESCRIPTION,   ///< NodeData::GetDDescription()
+  TRACEEVENT_GETDPARAMETER,     ///< NodeData::GetDParameter(), argument is the parameter ID.
+  TRACEEVENT_SETDPARAMETER,     ///< NodeData::SetDParameter(), argument is the parameter ID.
+  TRACEEVENT_EXECUTE,           ///< ObjectData::Execute(), argument is the priority.
+  TRACEEVENT_DRAW,              ///< ObjectData::Draw(), argument is the draw pass.
+  TRACEEVENT_COUNT,
+};
+
+/// Returns the name of the event \p type.
+const char* GetTraceEventName(uint32_t type);
+
+/// ***************************************************************************
+/// ***************************************************************************
+struct TraceEvent
+{
+  uint64_t time;       ///< Microseconds since the recording started.
+  uint32_t duration;   ///< Microseconds spent in the call.
+  uint32_t object;     ///< Number of the object, in the order they were first seen.
+  uint32_t arg;
+  uint8_t type;        ///< A #TRACEEVENT.
+  uint8_t thread;      ///< Number of the thread, in the order they were first seen.
+};
+
+/// ***************************************************************************
+/// Starts recording to \p filename, replacing a running recording.
+/// Returns \c false if the file can not be created.
+/// ***************************************************************************
+bool TraceStart(std::string const& filename);
+
+/// ***************************************************************************
+/// Writes the remaining events and closes the trace.
+/// ***************************************************************************
+void TraceStop();
+
+/// ***************************************************************************
+/// Returns \c true while recording. Cheap enough to check on every call.
+/// ***************************************************************************
+bool TraceIsActive();
+
+/// ***************************************************************************
+/// Microseconds on the trace clock.
+/// ***************************************************************************
+uint64_t TraceNow();
+
+/// ***************************************************************************
+/// Records a call to \p type for \p object that started at \p start.
+/// Does nothing if not recording.
+/// ***************************************************************************
+void TraceRecord(TRACEEVENT type, const void* object, uint32_t arg, uint64_t start);
+
+/// ***************************************************************************
+/// Drops the number of \p object, a later object at the same address is
+/// recorded as a new object.
+/// ***************************************************************************
+void TraceForget(const void* object);
+
+/// ***************************************************************************
+/// Reads all events of a trace. Returns \c false if the file is not a
+/// valid trace, \p events holds the events up to the error.
+/// ***************************************************************************
+bool TraceReadFile(std::string const& filename, std::vector<TraceEvent>& events);
+
+/// ***************************************************************************
+/// Records the time from construction to destruction as an event.
+/// ***************************************************************************
+class TraceScope
+{
+  TRACEEVENT m_type;
+  const void* m_object;
+  uint32_t m_arg;
+  uint64_t m_start;
+  bool m_active;
+
+  TraceScope(TraceScope const&);
+  TraceScope& operator = (TraceScope const&);
+
+public:
+
+  TraceScope(TRACEEVENT type, const void* object, uint32_t arg=0)
+    : m_type(type), m_object(object), m_arg(arg), m_start(0), m_active(TraceIsActive())
+  {
+    if (m_active) m_start = TraceNow();
+  }
+
+  ~TraceScope()
+  {
+    if (m_active) TraceRecord(m_type, m_object, m_arg, m_start);
+  }
+
+  void SetArg(uint32_t arg) { m_arg = arg; }
+};
@@ -0,0 +1,226 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Warmup.cpp
+
+#include "Warmup.h"
+#include "ContainerIndex.h"
+#include "ContainerObject.h"
+#include "Dedupe.h"
+#include "Utils/Misc.h"
+#include "Utils/Stats.h"
+#include "res/c4d_symbols.h"
+#include <algorithm>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+enum
+{
+  ID_CACHEWARMUP = 1036112,
+};
+
+/// Milliseconds spent per time slice, and between slices.
+static const LONG SLICE_TIME = 10;
+static const LONG SLICE_INTERVAL = 20;
+
+/// Number of slices a container waits for its document to be evaluated.
+static const LONG MAX_DEFER = 50;
+
+/// ***************************************************************************
+/// ***************************************************************************
+struct WarmupEntry
+{
+  BaseLink* link;
+  LONG deferred;
+};
+
+// Only accessed from the main thread.
+static std::vector<WarmupEntry> g_queue;
+
+// Documents are loaded from other threads, too. Containers are queued
+// here and moved to #g_queue by the main thread.
+static std::mutex g_lock;
+static std::vector<WarmupEntry> g_incoming;
+
+/// ***************************************************************************
+/// Frees the entries of \p queue that link to \p op, or all entries if
+/// \p op is \c nullptr.
+/// ***************************************************************************
+static void RemoveEntries(std::vector<WarmupEntry>& queue, BaseObject* op)
+{
+  for (auto it = queue.begin(); it != queue.end(); )
+  {
+    if (!op || it->link->ForceGetLink() == op)
+    {
+      BaseLink::Free(it->link);
+      it = queue.erase(it);
+    }
+    else
+      ++it;
+  }
+}
+
+/// ***************************************************************************
+/// Moves the containers queued since the last call to #g_queue. Must be
+/// called from the main thread.
+/// ***************************************************************************
+static void TakeIncoming()
+{
+  std::vector<WarmupEntry> incoming;
+  {
+    std::lock_guard<std::mutex> lock(g_lock);
+    incoming.swap(g_incoming);
+  }
+  for (WarmupEntry const& entry : incoming)
+  {
+    RemoveEntries(g_queue, static_cast<BaseObject*>(entry.link->ForceGetLink()));
+    g_queue.push_back(entry);
+  }
+}
+
+/// ***************************************************************************
+/// Returns true if there are containers waiting, queued or incoming.
+/// ***************************************************************************
+static Bool HasPending()
+{
+  if (!g_queue.empty()) return true;
+  std::lock_guard<std::mutex> lock(g_lock);
+  return !g_incoming.empty();
+}
+
+/// ***************************************************************************
+/// Returns \c true if the generators in the hierarchy of \p op have been
+/// evaluated, measuring their bounds before gives empty boxes. Only the
+/// first enabled generator is checked.
+/// ***************************************************************************
+static Bool IsEvaluated(BaseObject* op)
+{
+  for (NodeIterator<BaseObject> it(op->GetDown(), op); it; ++it)
+  {
+    if ((it->GetInfo() & OBJECT_GENERATOR) && it->GetDeformMode())
+      return it->GetCache() != nullptr;
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// Validates the bounding box and the deduplication key of \p op. A box
+/// restored from the document is adopted if it is still valid.
+/// ***************************************************************************
+static void WarmContainer(BaseObject* op)
+{
+  Vector bbmin, bbmax;
+  ContainerGetBounds(op, &bbmin, &bbmax, true);
+  DedupeState* state = ContainerGetDedupeState(op);
+  if (state) DedupeVerify(op, *state);
+  StatIncrement(STATCOUNTER_WARMUP_CONTAINERS);
+}
+
+/// ***************************************************************************
+/// Moves the queued containers that are visible in the active view of the
+/// active document to the front of the queue.
+/// ***************************************************************************
+static void SortVisibleFirst()
+{
+  BaseDocument* doc = GetActiveDocument();
+  if (!doc) return;
+  std::vector<BaseObject*> visible;
+  ContainerIndexQueryFrustum(doc, doc->GetActiveBaseDraw(), visible, false);
+  if (visible.empty()) return;
+
+  std::unordered_set<BaseObject*> lookup(visible.begin(), visible.end());
+  std::stable_partition(g_queue.begin(), g_queue.end(), [&lookup](WarmupEntry const& entry) {
+    return lookup.count(static_cast<BaseObject*>(entry.link->ForceGetLink())) != 0;
+  });
+}
+
+/// ***************************************************************************
+/// Warms queued containers until the time slice is used up.
+/// ***************************************************************************
+static void ProcessSlice()
+{
+  SortVisibleFirst();
+  LONG deadline = GeGetTimer() + SLICE_TIME;
+  for (auto it = g_queue.begin(); it != g_queue.end() && GeGetTimer() < deadline; )
+  {
+    BaseObject* op = static_cast<BaseObject*>(it->link->ForceGetLink());
+    if (op && op->GetDocument())
+    {
+      if (!IsEvaluated(op) && ++it->deferred < MAX_DEFER)
+      {
+        ++it;
+        continue;
+      }
+      WarmContainer(op);
+    }
+    BaseLink::Free(it->link);
+    it = g_queue.erase(it);
+  }
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void CacheWarmupQueue(BaseObject* op)
+{
+  if (!op) return;
+  WarmupEntry entry;
+  entry.link = BaseLink::Alloc();
+  if (!entry.link) return;
+  entry.link->SetLink(op);
+  entry.deferred = 0;
+  {
+    // May be called while a document is loaded in another thread.
+    std::lock_guard<std::mutex> lock(g_lock);
+    RemoveEntries(g_incoming, op);
+    g_incoming.push_back(entry);
+  }
+
+  // Wake up the message plugin so it asks for the timer again.
+  SpecialEventAdd(ID_CACHEWARMUP);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+void CacheWarmupCancel(BaseObject* op)
+{
+  RemoveEntries(g_queue, op);
+  std::lock_guard<std::mutex> lock(g_lock);
+  RemoveEntries(g_incoming, op);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+class CacheWarmupMessage : public MessageData
+{
+public:
+
+  virtual LONG GetTimer()
+  {
+    return HasPending() ? SLICE_INTERVAL : 0;
+  }
+
+  virtual Bool CoreMessage(LONG id, const BaseContainer& bc)
+  {
+    if (id == MSG_TIMER || id == ID_CACHEWARMUP)
+    {
+      TakeIncoming();
+      if (!g_queue.empty()) ProcessSlice();
+    }
+    return true;
+  }
+
+};
+
+/// ***************************************************************************
+/// ***************************************************************************
+Bool RegisterCacheWarmup()
+{
+  return RegisterMessagePlugin(
+    ID_CACHEWARMUP,
+    GeLoadString(IDS_CACHEWARMUP),
+    0,
+    gNew(CacheWarmupMessage));
+}
@@ -0,0 +1,33 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file Warmup.h
+///
+/// Validates the caches of containers after a document was loaded, in
+/// time slices from a timer and visible containers first, so that the
+/// first interaction with the viewport doesn't have to compute the
+/// caches of all containers at once.
+
+#pragma once
+
+#include <c4d.h>
+#include <c4d_legacy.h>
+
+/// ***************************************************************************
+/// Queues the container \p op to have its caches validated. Called when
+/// the container was loaded or merged, which may happen in any thread.
+/// ***************************************************************************
+void CacheWarmupQueue(BaseObject* op);
+
+/// ***************************************************************************
+/// Removes \p op, or all containers if \p op is \c nullptr, from the queue.
+/// Must be called from the main thread.
+/// ***************************************************************************
+void CacheWarmupCancel(BaseObject* op);
+
+/// ***************************************************************************
+/// Registers the message plugin that processes the time slices.
+/// ***************************************************************************
+Bool RegisterCacheWarmup();
@@ -10,16 +10,56 @@
 #include <c4d_apibridge.h>
 #include <c4d_legacy.h>
 #include "Utils/Misc.h"
+#include "Utils/JobSystem.h"
+#include "Utils/Kernels.h"
+#include "Utils/TraceFile.h"
+#include "ContainerApi.h"
 
 using c4d_apibridge::GlobalResource;
 
 extern Bool RegisterContainerObject(Bool prePass);
 extern Bool RegisterCommands();
+extern Bool RegisterPreferences();
+extern Bool RegisterProgressiveUnpack();
+extern void ProgressiveUnpackCancel(BaseObject* op);
+extern Bool RegisterCacheWarmup();
+extern void CacheWarmupCancel(BaseObject* op);
+extern void IconCacheFlush();
+extern void TraceRecordingUpdate();
+extern void EvalProfileUpdate();
+extern Bool RegisterSelectionSummary();
+extern Bool RegisterDedupe();
+extern Bool RegisterCatalog();
+extern Bool RegisterPlaybackCache();
+extern void PlaybackCacheCleanup();
+extern Bool RegisterContainerApi();
 
 Bool PluginStart()
 {
+  // Select the SIMD kernels for this CPU. If any of them disagrees with
+  // its scalar reference, don't trust any and stay with the scalar ones.
+  KernelsInit(DetectCpuFeatures());
+  const char* failed = KernelsSelfCheck();
+  if (failed)
+  {
+    GePrint("Container Object: kernel self check failed for " + String(failed) + ", using scalar kernels");
+    KernelsInit(CpuFeatures());
+  }
+
+  // One worker pool for the whole plugin, sized like Cinema's own so
+  // that render nodes are not oversubscribed.
+  JobSystemInit((uint32_t) GeGetCurrentThreadCount());
+
   RegisterContainerObject(false);
   RegisterCommands();
+  RegisterPreferences();
+  RegisterProgressiveUnpack();
+  RegisterCacheWarmup();
+  RegisterSelectionSummary();
+  RegisterDedupe();
+  RegisterCatalog();
+  RegisterPlaybackCache();
+  RegisterContainerApi();
   return false;
 }
 
@@ -32,6 +72,14 @@ Bool PluginMessage(LONG msgType, void* pData)
     case C4DPL_BUILDMENU:
       RegisterContainerObject(true);
       break;
+    case C4DPL_STARTACTIVITY:
+      // The preferences are available now.
+      TraceRecordingUpdate();
+      EvalProfileUpdate();
+      PlaybackCacheCleanup();
+      break;
+    case CONTAINERAPI_MESSAGE:
+      return ContainerApiMessage(static_cast<BaseContainer*>(pData));
     default:
       break;
   }
@@ -40,5 +88,10 @@ Bool PluginMessage(LONG msgType, void* pData)
 
 void PluginEnd()
 {
+  ProgressiveUnpackCancel(nullptr);
+  CacheWarmupCancel(nullptr);
+  TraceStop();
+  IconCacheFlush();
+  JobSystemShutdown();
 }
 
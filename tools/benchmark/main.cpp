@@ -0,0 +1,429 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file tools/benchmark/main.cpp
+///
+/// Measures the throughput of the parts of the plugin that don't depend
+/// on the Cinema 4D API. Run with `--help` for the available benchmarks.
+
+#include "source/Utils/IconCodec.h"
+#include "source/Utils/JobSystem.h"
+#include "source/Utils/Kernels.h"
+#include "source/Utils/PointCache.h"
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+/// ***************************************************************************
+/// Generates a synthetic icon: a gradient background with flat shapes and
+/// a little noise, roughly what rendered or drawn icons look like.
+/// ***************************************************************************
+static std::vector<uint8_t> MakeIcon(uint32_t size, uint32_t channels, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> pixels((size_t) size * size * channels);
+  for (uint32_t y=0; y < size; y++)
+  {
+    for (uint32_t x=0; x < size; x++)
+    {
+      uint8_t* p = &pixels[((size_t) y * size + x) * channels];
+      int dx = (int) x - (int) size / 2, dy = (int) y - (int) size / 2;
+      bool inside = dx * dx + dy * dy < (int) (size * size / 8);
+      for (uint32_t c=0; c < channels; c++)
+      {
+        int value = inside ? 40 + 60 * (int) c : (int) ((x + y) * 255 / (2 * size));
+        if ((rng() & 7) == 0) value += (int) (rng() % 5) - 2;
+        p[c] = (uint8_t) (value < 0 ? 0 : (value > 255 ? 255 : value));
+      }
+      if (channels == 4) p[3] = inside ? 255 : 0;
+    }
+  }
+  return pixels;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+static double Seconds(Clock::time_point start)
+{
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/// ***************************************************************************
+/// Encodes and decodes icons and reports the throughput in megabytes of
+/// raw pixels per second. Returns \c false if a round trip failed.
+/// ***************************************************************************
+static bool BenchmarkIcons(uint32_t size, int iterations)
+{
+  std::vector<uint8_t> pixels = MakeIcon(size, 4, 42);
+  std::vector<uint8_t> encoded;
+  std::vector<uint8_t> decoded;
+  uint32_t w, h, channels;
+
+  Clock::time_point start = Clock::now();
+  for (int i=0; i < iterations; i++)
+  {
+    encoded.clear();
+    IconEncode(pixels.data(), size, size, 4, encoded);
+  }
+  double encodeTime = Seconds(start);
+
+  start = Clock::now();
+  for (int i=0; i < iterations; i++)
+  {
+    if (!IconDecode(encoded.data(), encoded.size(), decoded, w, h, channels))
+    {
+      fprintf(stderr, "error: icon decode failed\n");
+      return false;
+    }
+  }
+  double decodeTime = Seconds(start);
+
+  if (decoded != pixels)
+  {
+    fprintf(stderr, "error: icon round trip is not lossless\n");
+    return false;
+  }
+
+  double mb = (double) pixels.size() * iterations / (1024.0 * 1024.0);
+  printf("icon codec %ux%u RGBA, %d iterations\n", size, size, iterations);
+  printf("  size:   %zu -> %zu bytes (%.1f%%)\n", pixels.size(), encoded.size(),
+    100.0 * encoded.size() / pixels.size());
+  printf("  encode: %.1f MB/s (%.2f us per icon)\n", mb / encodeTime, 1.0e6 * encodeTime / iterations);
+  printf("  decode: %.1f MB/s (%.2f us per icon)\n", mb / decodeTime, 1.0e6 * decodeTime / iterations);
+  return true;
+}
+
+/// ***************************************************************************
+/// Records a deforming mesh of \p points points over \p frames frames to
+/// a point cache and plays it back. Reports the file size, the playback
+/// throughput and the largest quantization error relative to the extent
+/// of the mesh. Returns \c false if the error is too large.
+/// ***************************************************************************
+static bool BenchmarkPointCache(uint32_t points, uint32_t frames)
+{
+  std::vector<double> xyz((size_t) points * 3);
+  auto deform = [&](uint32_t frame) {
+    for (uint32_t i=0; i < points; i++)
+    {
+      double angle = i * 0.001 + frame * 0.05;
+      xyz[i * 3 + 0] = 100.0 * cos(angle) + (i % 97);
+      xyz[i * 3 + 1] = 200.0 * (i / (double) points) + 10.0 * sin(frame * 0.1);
+      xyz[i * 3 + 2] = 100.0 * sin(angle) - (i % 89);
+    }
+  };
+
+  const char* filename = "benchmark.pointcache";
+  PointCacheWriter writer;
+  if (!writer.Open(filename, 0, std::vector<uint32_t>(1, points)))
+  {
+    fprintf(stderr, "error: could not create %s\n", filename);
+    return false;
+  }
+  Clock::time_point start = Clock::now();
+  for (uint32_t frame=0; frame < frames; frame++)
+  {
+    deform(frame);
+    const double* objects[] = {xyz.data()};
+    writer.AddFrame(objects);
+  }
+  bool ok = writer.Close();
+  double recordTime = Seconds(start);
+
+  PointCacheReader reader;
+  if (!ok || !reader.Open(filename) || reader.GetFrameCount() != frames)
+  {
+    fprintf(stderr, "error: could not read %s\n", filename);
+    remove(filename);
+    return false;
+  }
+  std::vector<double> decoded(xyz.size());
+  start = Clock::now();
+  for (uint32_t frame=0; frame < frames; frame++)
+    reader.ReadPoints(frame, 0, decoded.data());
+  double playTime = Seconds(start);
+
+  // The last frame is still in xyz.
+  double error = 0.0, extent = 0.0;
+  for (int c=0; c < 3; c++)
+  {
+    double lo = xyz[c], hi = xyz[c];
+    for (size_t i=c; i < xyz.size(); i += 3)
+    {
+      lo = std::min(lo, xyz[i]);
+      hi = std::max(hi, xyz[i]);
+      error = std::max(error, std::abs(decoded[i] - xyz[i]));
+    }
+    extent = std::max(extent, hi - lo);
+  }
+  reader.Close();
+
+  FILE* fp = fopen(filename, "rb");
+  long fileSize = 0;
+  if (fp && fseek(fp, 0, SEEK_END) == 0) fileSize = ftell(fp);
+  if (fp) fclose(fp);
+  remove(filename);
+
+  double mb = (double) points * frames * 3 * sizeof(float) / (1024.0 * 1024.0);
+  printf("point cache %u points x %u frames\n", points, frames);
+  printf("  size:   %.1f MB as floats -> %.1f MB\n", mb, fileSize / (1024.0 * 1024.0));
+  printf("  record: %.1f frames/s\n", frames / recordTime);
+  printf("  play:   %.1f frames/s (%.1f MB/s of floats)\n", frames / playTime, mb / playTime);
+  printf("  error:  %.6f (%.4f%% of the extent)\n", error, 100.0 * error / extent);
+  if (error > extent / 65535.0)
+  {
+    fprintf(stderr, "error: point cache quantization error is too large\n");
+    return false;
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// Runs \p kernel over \p bytes bytes of input \p iterations times and
+/// prints the throughput.
+/// ***************************************************************************
+template <typename Fn>
+static void ReportKernel(const char* name, const char* variant, size_t bytes, int iterations, Fn kernel)
+{
+  Clock::time_point start = Clock::now();
+  for (int i=0; i < iterations; i++)
+    kernel();
+  double seconds = Seconds(start);
+  double mb = (double) bytes * iterations / (1024.0 * 1024.0);
+  printf("  %-14s %-8s %8.1f MB/s\n", name, variant, mb / seconds);
+}
+
+/// ***************************************************************************
+/// Compares the throughput of the scalar and the active kernels.
+/// ***************************************************************************
+static bool BenchmarkKernels(int iterations)
+{
+  const size_t points = 1 << 16;
+  const size_t bytes = 1 << 20;
+  std::mt19937 rng(7);
+  std::vector<double> xyz(points * 3);
+  for (double& v : xyz)
+    v = (double) rng() / 65536.0;
+  std::vector<uint8_t> data(bytes), out(bytes);
+  for (uint8_t& b : data)
+    b = (uint8_t) rng();
+  int rounds = iterations / 200 > 0 ? iterations / 200 : 1;
+
+  printf("kernels, %d rounds\n", rounds);
+  const KernelTable* tables[2] = {&GetScalarKernels(), &GetKernels()};
+  for (const KernelTable* k : tables)
+  {
+    double bbmin[3], bbmax[3];
+    uint32_t state[8] = {0};
+    ReportKernel("boundsReduce", k->boundsReduceName, xyz.size() * sizeof(double), rounds,
+      [&]() { k->boundsReduce(xyz.data(), points, bbmin, bbmax); });
+    ReportKernel("deltaEncode", k->deltaName, bytes, rounds,
+      [&]() { k->deltaEncode(data.data(), bytes, out.data()); });
+    ReportKernel("deltaDecode", k->deltaName, bytes, rounds,
+      [&]() { k->deltaDecode(data.data(), bytes, out.data()); });
+    ReportKernel("sha256Blocks", k->sha256Name, bytes, rounds,
+      [&]() { k->sha256Blocks(state, data.data(), bytes / 64); });
+  }
+  return true;
+}
+
+/// ***************************************************************************
+/// Runs a parallel bounds reduction and many small jobs with 1, 2, 4, ...
+/// up to \p maxThreads threads and prints the speedup over one thread.
+/// Returns \c false if a parallel result differs from the serial one.
+/// ***************************************************************************
+static bool BenchmarkJobs(uint32_t maxThreads, int iterations)
+{
+  const size_t points = 1 << 21;
+  const size_t smallJobs = 100000;
+  std::mt19937 rng(11);
+  std::vector<double> xyz(points * 3);
+  for (double& v : xyz)
+    v = (double) rng() / 65536.0 - 32768.0;
+  int rounds = iterations / 1000 > 0 ? iterations / 1000 : 1;
+
+  double expectMin[3], expectMax[3];
+  GetKernels().boundsReduce(xyz.data(), points, expectMin, expectMax);
+
+  printf("jobs, %d rounds, up to %u threads\n", rounds, maxThreads);
+  double baseReduce = 0, baseSmall = 0;
+  bool ok = true;
+  for (uint32_t threads=1; threads <= maxThreads; threads = threads * 2 > maxThreads && threads != maxThreads ? maxThreads : threads * 2)
+  {
+    JobSystemInit(threads);
+
+    double bbmin[3], bbmax[3];
+    Clock::time_point start = Clock::now();
+    for (int r=0; r < rounds; r++)
+    {
+      std::mutex lock;
+      for (int i=0; i < 3; i++) { bbmin[i] = 1e300; bbmax[i] = -1e300; }
+      ParallelFor(points, 16 * 1024, [&](size_t begin, size_t end) {
+        double lo[3], hi[3];
+        GetKernels().boundsReduce(xyz.data() + begin * 3, end - begin, lo, hi);
+        std::lock_guard<std::mutex> guard(lock);
+        for (int i=0; i < 3; i++)
+        {
+          if (lo[i] < bbmin[i]) bbmin[i] = lo[i];
+          if (hi[i] > bbmax[i]) bbmax[i] = hi[i];
+        }
+      });
+    }
+    double reduceTime = Seconds(start) / rounds;
+    if (memcmp(bbmin, expectMin, sizeof(bbmin)) || memcmp(bbmax, expectMax, sizeof(bbmax)))
+    {
+      fprintf(stderr, "error: parallel bounds differ with %u threads\n", threads);
+      ok = false;
+    }
+
+    std::atomic<long long> sum(0);
+    start = Clock::now();
+    {
+      JobGroup group;
+      for (size_t i=0; i < smallJobs; i++)
+        group.Run([&sum, i] { sum.fetch_add((long long) i, std::memory_order_relaxed); });
+      group.Wait();
+    }
+    double smallTime = Seconds(start);
+    if (sum.load() != (long long) (smallJobs * (smallJobs - 1) / 2))
+    {
+      fprintf(stderr, "error: small jobs lost with %u threads\n", threads);
+      ok = false;
+    }
+
+    // Jobs of a cancelled group that didn't start must be skipped.
+    std::atomic<int> ran(0);
+    {
+      JobGroup group;
+      group.Cancel();
+      for (int i=0; i < 1000; i++)
+        group.Run([&ran] { ran++; });
+    }
+    if (ran.load() != 0)
+    {
+      fprintf(stderr, "error: cancelled jobs ran with %u threads\n", threads);
+      ok = false;
+    }
+
+    if (threads == 1)
+    {
+      baseReduce = reduceTime;
+      baseSmall = smallTime;
+    }
+    printf("  %2u threads: bounds %7.2f ms (%.2fx)  small jobs %6.2f us/job (%.2fx)  steals %lld\n",
+      threads, 1.0e3 * reduceTime, baseReduce / reduceTime, 1.0e6 * smallTime / smallJobs,
+      baseSmall / smallTime, JobSystemGetStealCount());
+    if (threads == maxThreads) break;
+  }
+  JobSystemShutdown();
+  return ok;
+}
+
+/// ***************************************************************************
+/// Checks the kernels for every subset of the CPU features against the
+/// scalar references. Returns \c false if one of them disagrees.
+/// ***************************************************************************
+static bool VerifyKernels()
+{
+  CpuFeatures cpu = DetectCpuFeatures();
+  printf("cpu: sse4.1=%d avx2=%d avx512=%d sha=%d\n", cpu.sse41, cpu.avx2, cpu.avx512, cpu.sha);
+  bool ok = true;
+  for (int mask=0; mask < 16; mask++)
+  {
+    CpuFeatures features;
+    features.sse41 = cpu.sse41 && (mask & 1);
+    features.avx2 = cpu.avx2 && (mask & 2);
+    features.avx512 = cpu.avx512 && (mask & 4);
+    features.sha = cpu.sha && (mask & 8);
+    KernelsInit(features);
+    const char* failed = KernelsSelfCheck();
+    KernelTable const& k = GetKernels();
+    printf("  bounds=%-7s delta=%-7s sha256=%-7s %s\n", k.boundsReduceName, k.deltaName,
+      k.sha256Name, failed ? failed : "ok");
+    if (failed) ok = false;
+  }
+  KernelsInit(cpu);
+  return ok;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+static void Usage()
+{
+  printf("usage: benchmark [--iterations N] [--threads N] [--scalar] [--verify] [benchmark...]\n\n");
+  printf("  --threads maximum number of threads for the jobs benchmark\n");
+  printf("  --scalar  use the scalar kernels only\n");
+  printf("  --verify  check all kernel variants against the scalar kernels\n\n");
+  printf("benchmarks:\n");
+  printf("  icons     icon codec encode/decode throughput\n");
+  printf("  kernels   scalar and SIMD kernel throughput\n");
+  printf("  jobs      job system scaling over the number of threads\n");
+  printf("  points    point cache record and playback throughput\n");
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+int main(int argc, char** argv)
+{
+  int iterations = 20000;
+  bool scalar = false;
+  bool verify = false;
+  uint32_t threads = std::thread::hardware_concurrency();
+  std::vector<std::string> names;
+  for (int i=1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h"))
+    {
+      Usage();
+      return 0;
+    }
+    else if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+      iterations = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+      threads = (uint32_t) atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--scalar"))
+      scalar = true;
+    else if (!strcmp(argv[i], "--verify"))
+      verify = true;
+    else
+      names.push_back(argv[i]);
+  }
+  bool ok = true;
+  if (verify)
+  {
+    ok = VerifyKernels();
+    if (names.empty()) return ok ? 0 : 1;
+  }
+  KernelsInit(scalar ? CpuFeatures() : DetectCpuFeatures());
+
+  if (names.empty())
+    names.push_back("icons");
+
+  for (std::string const& name : names)
+  {
+    if (name == "icons")
+      ok = BenchmarkIcons(64, iterations) && ok;
+    else if (name == "kernels")
+      ok = BenchmarkKernels(iterations) && ok;
+    else if (name == "points")
+      ok = BenchmarkPointCache(50000, std::max(iterations / 100, 10)) && ok;
+    else if (name == "jobs")
+      ok = BenchmarkJobs(threads > 0 ? threads : 1, iterations) && ok;
+    else
+    {
+      fprintf(stderr, "error: unknown benchmark '%s'\n", name.c_str());
+      return 2;
+    }
+  }
+  return ok ? 0 : 1;
+}
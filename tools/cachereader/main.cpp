@@ -0,0 +1,200 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file tools/cachereader/main.cpp
+///
+/// Reads the geometry caches exported from containers (see
+/// source/Utils/GeometryCache.h) without Cinema 4D. Prints a summary,
+/// the bounds of every frame or writes a frame as a Wavefront OBJ file.
+/// Run with `--help` for the options.
+
+#include "source/Utils/GeometryCache.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+/// ***************************************************************************
+/// ***************************************************************************
+static double Seconds(Clock::time_point start)
+{
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/// ***************************************************************************
+/// Prints the meshes and frames of the cache.
+/// ***************************************************************************
+static void PrintSummary(GeometryCacheReader const& reader, bool meshes)
+{
+  uint64_t points = 0, polygons = 0;
+  for (size_t i=0; i < reader.GetMeshCount(); i++)
+  {
+    GeometryCacheMesh const& mesh = reader.GetMesh(i);
+    points += mesh.points;
+    polygons += mesh.polygons;
+    if (meshes)
+      printf("mesh %u: %s, %u points, %u polygons\n", mesh.id, mesh.name.c_str(),
+        mesh.points, mesh.polygons);
+  }
+  if (meshes) printf("\n");
+
+  std::vector<int32_t> const& frames = reader.GetFrames();
+  printf("%zu meshes, %llu points, %llu polygons\n", reader.GetMeshCount(),
+    (unsigned long long) points, (unsigned long long) polygons);
+  if (frames.empty())
+    printf("no frames\n");
+  else
+    printf("%zu frames from %d to %d\n", frames.size(), frames.front(), frames.back());
+  if (!reader.IsComplete())
+    printf("the file is incomplete, it was read up to its last complete chunk\n");
+}
+
+/// ***************************************************************************
+/// Prints the bounds of all points of every frame.
+/// ***************************************************************************
+static void PrintBounds(GeometryCacheReader const& reader)
+{
+  Clock::time_point start = Clock::now();
+  uint64_t total = 0;
+  for (int32_t frame : reader.GetFrames())
+  {
+    float lo[3] = {0.0f, 0.0f, 0.0f}, hi[3] = {0.0f, 0.0f, 0.0f};
+    bool first = true;
+    for (uint32_t id : reader.GetFrameMeshes(frame))
+    {
+      GeometryCacheMesh const* mesh = reader.FindMesh(id);
+      const float* xyz = reader.GetPoints(frame, id);
+      if (!mesh || !xyz) continue;
+      for (uint32_t i=0; i < mesh->points; i++)
+      {
+        for (int c=0; c < 3; c++)
+        {
+          float value = xyz[i * 3 + c];
+          lo[c] = first ? value : std::min(lo[c], value);
+          hi[c] = first ? value : std::max(hi[c], value);
+        }
+        first = false;
+      }
+      total += mesh->points;
+    }
+    printf("frame %d: (%g, %g, %g) - (%g, %g, %g)\n", frame, lo[0], lo[1], lo[2],
+      hi[0], hi[1], hi[2]);
+  }
+  double time = Seconds(start);
+  fprintf(stderr, "%llu points in %.2f ms (%.1f M points/s)\n", (unsigned long long) total,
+    time * 1e3, time > 0.0 ? total / time / 1e6 : 0.0);
+}
+
+/// ***************************************************************************
+/// Writes all meshes of \p frame to the OBJ file \p filename.
+/// ***************************************************************************
+static bool WriteObj(GeometryCacheReader const& reader, int32_t frame, std::string const& filename)
+{
+  std::vector<uint32_t> const& meshes = reader.GetFrameMeshes(frame);
+  if (meshes.empty())
+  {
+    fprintf(stderr, "error: frame %d is not in the cache\n", frame);
+    return false;
+  }
+  FILE* fp = fopen(filename.c_str(), "w");
+  if (!fp)
+  {
+    fprintf(stderr, "error: can not create '%s'\n", filename.c_str());
+    return false;
+  }
+
+  uint64_t base = 1;
+  for (uint32_t id : meshes)
+  {
+    GeometryCacheMesh const* mesh = reader.FindMesh(id);
+    const float* xyz = reader.GetPoints(frame, id);
+    if (!mesh || !xyz) continue;
+    fprintf(fp, "o %s\n", mesh->name.c_str());
+    for (uint32_t i=0; i < mesh->points; i++)
+      fprintf(fp, "v %g %g %g\n", xyz[i * 3], xyz[i * 3 + 1], xyz[i * 3 + 2]);
+    for (uint32_t i=0; i < mesh->polygons; i++)
+    {
+      const int32_t* p = mesh->indices + i * 4;
+      if (p[2] == p[3])
+        fprintf(fp, "f %llu %llu %llu\n", (unsigned long long) (base + p[0]),
+          (unsigned long long) (base + p[1]), (unsigned long long) (base + p[2]));
+      else
+        fprintf(fp, "f %llu %llu %llu %llu\n", (unsigned long long) (base + p[0]),
+          (unsigned long long) (base + p[1]), (unsigned long long) (base + p[2]),
+          (unsigned long long) (base + p[3]));
+    }
+    base += mesh->points;
+  }
+  return fclose(fp) == 0;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+static void Usage()
+{
+  printf("usage: cachereader [options] CACHE\n\n");
+  printf("Prints the meshes and frames of a geometry cache exported from a container.\n\n");
+  printf("  --meshes            list the meshes\n");
+  printf("  --bounds            print the bounds of every frame\n");
+  printf("  --obj FRAME FILE    write FRAME as a Wavefront OBJ file\n");
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+int main(int argc, char** argv)
+{
+  bool meshes = false;
+  bool bounds = false;
+  bool obj = false;
+  int32_t objFrame = 0;
+  std::string objFile;
+  std::string filename;
+  for (int i=1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h"))
+    {
+      Usage();
+      return 0;
+    }
+    else if (!strcmp(argv[i], "--meshes"))
+      meshes = true;
+    else if (!strcmp(argv[i], "--bounds"))
+      bounds = true;
+    else if (!strcmp(argv[i], "--obj") && i + 2 < argc)
+    {
+      obj = true;
+      objFrame = atoi(argv[++i]);
+      objFile = argv[++i];
+    }
+    else
+      filename = argv[i];
+  }
+  if (filename.empty())
+  {
+    Usage();
+    return 2;
+  }
+
+  Clock::time_point start = Clock::now();
+  GeometryCacheReader reader;
+  if (!reader.Open(filename))
+  {
+    fprintf(stderr, "error: '%s' is not a valid geometry cache\n", filename.c_str());
+    return 1;
+  }
+  fprintf(stderr, "opened in %.2f ms\n", Seconds(start) * 1e3);
+
+  PrintSummary(reader, meshes);
+  if (bounds)
+    PrintBounds(reader);
+  if (obj && !WriteObj(reader, objFrame, objFile))
+    return 1;
+  return 0;
+}
@@ -0,0 +1,278 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file tools/inspector/main.cpp
+///
+/// Searches the container catalogs written next to saved documents (see
+/// source/Utils/CatalogFile.h) without loading the documents. Directories
+/// are searched recursively. Run with `--help` for the options.
+
+#include "source/Utils/CatalogFile.h"
+#include "source/Utils/IconCodec.h"
+#include "source/Utils/Kernels.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+/// ***************************************************************************
+/// ***************************************************************************
+struct Options
+{
+  std::string query;
+  std::string field;      ///< Only match this field, all text fields if empty.
+  std::string iconDir;    ///< Write the icons of matches here if not empty.
+  bool list;              ///< Match all entries, there is no query.
+  bool protectedOnly;
+  bool verbose;
+
+  Options() : list(false), protectedOnly(false), verbose(false) { }
+};
+
+/// ***************************************************************************
+/// ***************************************************************************
+static bool EndsWith(std::string const& str, std::string const& suffix)
+{
+  return str.size() >= suffix.size() &&
+    str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+/// ***************************************************************************
+/// Returns \c true if \p haystack contains \p needle, ignoring the case of
+/// ASCII letters. \p needle must be lower case.
+/// ***************************************************************************
+static bool ContainsNoCase(std::string const& haystack, std::string const& needle)
+{
+  auto it = std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(),
+    [](char a, char b) { return tolower((unsigned char) a) == b; });
+  return it != haystack.end();
+}
+
+/// ***************************************************************************
+/// Adds \p path to \p files if it is a catalog, or all catalogs below it
+/// if it is a directory.
+/// ***************************************************************************
+static void CollectCatalogs(std::string const& path, std::vector<std::string>& files, bool explicitPath)
+{
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0)
+  {
+    if (explicitPath) fprintf(stderr, "warning: '%s' does not exist\n", path.c_str());
+    return;
+  }
+  if (!S_ISDIR(st.st_mode))
+  {
+    if (explicitPath || EndsWith(path, CATALOG_EXTENSION))
+      files.push_back(path);
+    return;
+  }
+
+  DIR* dir = opendir(path.c_str());
+  if (!dir) return;
+  while (dirent* ent = readdir(dir))
+  {
+    if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, "..")) continue;
+    CollectCatalogs(path + "/" + ent->d_name, files, false);
+  }
+  closedir(dir);
+}
+
+/// ***************************************************************************
+/// Returns the field \p name of \p entry, or \c nullptr if there is no
+/// such field.
+/// ***************************************************************************
+static std::string const* GetField(CatalogEntry const& entry, std::string const& name)
+{
+  if (name == "path") return &entry.path;
+  if (name == "name") return &entry.name;
+  if (name == "version") return &entry.version;
+  if (name == "url") return &entry.url;
+  if (name == "author") return &entry.author;
+  if (name == "email") return &entry.authorEmail;
+  if (name == "description") return &entry.description;
+  if (name == "fingerprint") return &entry.fingerprint;
+  return nullptr;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+static bool Matches(CatalogEntry const& entry, Options const& opts)
+{
+  if (opts.protectedOnly && !(entry.flags & CATALOGFLAG_PROTECTED))
+    return false;
+  if (opts.list)
+    return true;
+  if (!opts.field.empty())
+  {
+    std::string const* value = GetField(entry, opts.field);
+    if (opts.field == "fingerprint")
+      return value->compare(0, opts.query.size(), opts.query) == 0;
+    return ContainsNoCase(*value, opts.query);
+  }
+  static const char* const fields[] = {
+    "name", "path", "version", "url", "author", "email", "description"};
+  for (const char* field : fields)
+  {
+    if (ContainsNoCase(*GetField(entry, field), opts.query))
+      return true;
+  }
+  return false;
+}
+
+/// ***************************************************************************
+/// Writes the icon of \p entry as a PAM image. Returns \c false if the
+/// icon is not valid or the file could not be written.
+/// ***************************************************************************
+static bool WriteIcon(CatalogEntry const& entry, std::string const& filename)
+{
+  std::vector<uint8_t> pixels;
+  uint32_t width, height, channels;
+  if (!IconDecode(entry.icon.data(), entry.icon.size(), pixels, width, height, channels))
+    return false;
+
+  static const char* const types[] = {"GRAYSCALE", "GRAYSCALE_ALPHA", "RGB", "RGB_ALPHA"};
+  FILE* fp = fopen(filename.c_str(), "wb");
+  if (!fp) return false;
+  fprintf(fp, "P7\nWIDTH %u\nHEIGHT %u\nDEPTH %u\nMAXVAL 255\nTUPLTYPE %s\nENDHDR\n",
+    width, height, channels, types[channels - 1]);
+  bool ok = fwrite(pixels.data(), 1, pixels.size(), fp) == pixels.size();
+  return fclose(fp) == 0 && ok;
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+static void PrintEntry(std::string const& file, CatalogEntry const& entry, bool verbose)
+{
+  std::string document = file;
+  if (EndsWith(document, CATALOG_EXTENSION))
+    document.resize(document.size() - strlen(CATALOG_EXTENSION));
+
+  printf("%s: %s", document.c_str(), entry.path.c_str());
+  if (!entry.name.empty()) printf("  \"%s\"", entry.name.c_str());
+  if (!entry.version.empty()) printf(" %s", entry.version.c_str());
+  if (!entry.author.empty()) printf(" by %s", entry.author.c_str());
+  if (entry.flags & CATALOGFLAG_PROTECTED) printf(" [protected]");
+  printf("\n");
+  if (!verbose) return;
+
+  if (!entry.authorEmail.empty()) printf("    email:       %s\n", entry.authorEmail.c_str());
+  if (!entry.url.empty()) printf("    url:         %s\n", entry.url.c_str());
+  if (!entry.description.empty()) printf("    description: %s\n", entry.description.c_str());
+  printf("    fingerprint: %s\n", entry.fingerprint.c_str());
+  printf("    icon:        %s\n", entry.icon.empty() ? "none" : (std::to_string(entry.icon.size()) + " bytes").c_str());
+  for (std::string const& dependency : entry.files)
+    printf("    file:        %s\n", dependency.c_str());
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+static void Usage()
+{
+  printf("usage: inspector [options] QUERY PATH...\n");
+  printf("       inspector [options] --list PATH...\n\n");
+  printf("Searches the container catalogs (*%s) in the PATHs, directories are\n", CATALOG_EXTENSION);
+  printf("searched recursively. QUERY matches any part of the text fields,\n");
+  printf("ignoring case.\n\n");
+  printf("  --field F    only match field F: path, name, version, url, author,\n");
+  printf("               email, description or fingerprint (matches a prefix)\n");
+  printf("  --list       list all containers, there is no QUERY\n");
+  printf("  --protected  only match protected containers\n");
+  printf("  --icons DIR  write the icons of the matches to DIR as PAM images\n");
+  printf("  --verbose    print all fields of the matches\n");
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+int main(int argc, char** argv)
+{
+  Options opts;
+  std::vector<std::string> args;
+  for (int i=1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h"))
+    {
+      Usage();
+      return 0;
+    }
+    else if (!strcmp(argv[i], "--field") && i + 1 < argc)
+      opts.field = argv[++i];
+    else if (!strcmp(argv[i], "--icons") && i + 1 < argc)
+      opts.iconDir = argv[++i];
+    else if (!strcmp(argv[i], "--list"))
+      opts.list = true;
+    else if (!strcmp(argv[i], "--protected"))
+      opts.protectedOnly = true;
+    else if (!strcmp(argv[i], "--verbose") || !strcmp(argv[i], "-v"))
+      opts.verbose = true;
+    else
+      args.push_back(argv[i]);
+  }
+
+  if (!opts.list)
+  {
+    if (args.empty())
+    {
+      Usage();
+      return 2;
+    }
+    opts.query = args.front();
+    args.erase(args.begin());
+    if (opts.field != "fingerprint")
+      std::transform(opts.query.begin(), opts.query.end(), opts.query.begin(),
+        [](char c) { return (char) tolower((unsigned char) c); });
+  }
+  if (!opts.field.empty() && !GetField(CatalogEntry(), opts.field))
+  {
+    fprintf(stderr, "error: unknown field '%s'\n", opts.field.c_str());
+    return 2;
+  }
+  if (args.empty())
+    args.push_back(".");
+
+  KernelsInit(DetectCpuFeatures());
+  Clock::time_point start = Clock::now();
+  std::vector<std::string> files;
+  for (std::string const& arg : args)
+    CollectCatalogs(arg, files, true);
+  std::sort(files.begin(), files.end());
+
+  size_t matches = 0, iconsWritten = 0;
+  std::vector<CatalogEntry> entries;
+  for (std::string const& file : files)
+  {
+    if (!CatalogReadFile(file, entries))
+    {
+      fprintf(stderr, "warning: '%s' is not a valid catalog\n", file.c_str());
+      continue;
+    }
+    for (CatalogEntry const& entry : entries)
+    {
+      if (!Matches(entry, opts)) continue;
+      PrintEntry(file, entry, opts.verbose);
+      if (!opts.iconDir.empty() && !entry.icon.empty())
+      {
+        std::string filename = opts.iconDir + "/" + std::to_string(matches) + ".pam";
+        if (WriteIcon(entry, filename))
+          iconsWritten++;
+        else
+          fprintf(stderr, "warning: could not write '%s'\n", filename.c_str());
+      }
+      matches++;
+    }
+  }
+
+  double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  fprintf(stderr, "%zu matches in %zu catalogs (%.2f ms)", matches, files.size(), ms);
+  if (!opts.iconDir.empty()) fprintf(stderr, ", %zu icons written", iconsWritten);
+  fprintf(stderr, "\n");
+  return matches > 0 ? 0 : 1;
+}
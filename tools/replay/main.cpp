@@ -0,0 +1,298 @@
+/// Copyright (C) 2013-2015, Niklas Rosenstein
+/// All rights reserved.
+///
+/// Licensed under the GNU Lesser General Public License.
+///
+/// \file tools/replay/main.cpp
+///
+/// Analyses a trace recorded by the plugin (see source/Utils/TraceFile.h)
+/// and runs the recorded workload against the parts of the plugin that
+/// don't depend on the Cinema 4D API, so that changes to them can be
+/// measured with the call patterns of real sessions. Run with `--help`
+/// for the options.
+
+#include "source/Utils/IconCodec.h"
+#include "source/Utils/Kernels.h"
+#include "source/Utils/TraceFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+/// Size of the icons used for the replay, the size of container icons.
+static const uint32_t ICON_SIZE = 64;
+
+/// ***************************************************************************
+/// ***************************************************************************
+static double Seconds(Clock::time_point start)
+{
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/// ***************************************************************************
+/// Returns the value at \p fraction of the sorted \p values.
+/// ***************************************************************************
+static uint32_t Percentile(std::vector<uint32_t> const& values, double fraction)
+{
+  if (values.empty()) return 0;
+  size_t index = (size_t) (fraction * (values.size() - 1) + 0.5);
+  return values[index];
+}
+
+/// ***************************************************************************
+/// Prints the number and duration of the calls per entry point.
+/// ***************************************************************************
+static void PrintSummary(std::vector<TraceEvent> const& events)
+{
+  std::vector<std::vector<uint32_t>> durations(TRACEEVENT_COUNT);
+  std::unordered_set<uint32_t> objects;
+  std::unordered_set<uint32_t> threads;
+  uint64_t first = UINT64_MAX, last = 0;
+  for (TraceEvent const& event : events)
+  {
+    if (event.type < TRACEEVENT_COUNT)
+      durations[event.type].push_back(event.duration);
+    objects.insert(event.object);
+    threads.insert(event.thread);
+    first = std::min(first, event.time);
+    last = std::max(last, event.time + event.duration);
+  }
+
+  printf("%zu events, %zu objects, %zu threads, %.2f s recorded\n\n", events.size(),
+    objects.size(), threads.size(), events.empty() ? 0.0 : (last - first) / 1e6);
+  printf("%-20s %10s %10s %8s %8s %8s %8s\n", "entry point", "calls", "total ms",
+    "mean us", "p50 us", "p99 us", "max us");
+  for (uint32_t type=0; type < TRACEEVENT_COUNT; type++)
+  {
+    std::vector<uint32_t>& values = durations[type];
+    if (values.empty()) continue;
+    std::sort(values.begin(), values.end());
+    uint64_t total = 0;
+    for (uint32_t value : values) total += value;
+    printf("%-20s %10zu %10.2f %8.1f %8u %8u %8u\n", GetTraceEventName(type), values.size(),
+      total / 1e3, (double) total / values.size(), Percentile(values, 0.5),
+      Percentile(values, 0.99), values.back());
+  }
+}
+
+/// ***************************************************************************
+/// Prints the largest number of calls per entry point that started within
+/// \p window microseconds, eg. the calls during a single redraw.
+/// ***************************************************************************
+static void PrintBursts(std::vector<TraceEvent> const& events, uint64_t window)
+{
+  printf("\nlargest bursts within %.1f ms\n", window / 1e3);
+  for (uint32_t type=0; type < TRACEEVENT_COUNT; type++)
+  {
+    std::vector<uint64_t> times;
+    for (TraceEvent const& event : events)
+      if (event.type == type) times.push_back(event.time);
+    if (times.empty()) continue;
+    std::sort(times.begin(), times.end());
+
+    size_t best = 0, begin = 0;
+    uint64_t bestStart = 0;
+    for (size_t end=0; end < times.size(); end++)
+    {
+      while (times[end] - times[begin] >= window) begin++;
+      if (end - begin + 1 > best)
+      {
+        best = end - begin + 1;
+        bestStart = times[begin];
+      }
+    }
+    printf("%-20s %10zu calls at %.3f s\n", GetTraceEventName(type), best, bestStart / 1e6);
+  }
+}
+
+/// ***************************************************************************
+/// Generates the icon of the object \p object. Icons only differ a
+/// little, so that they compress like real icons.
+/// ***************************************************************************
+static void MakeIcon(uint32_t object, std::vector<uint8_t>& encoded)
+{
+  std::vector<uint8_t> pixels((size_t) ICON_SIZE * ICON_SIZE * 4);
+  for (uint32_t y=0; y < ICON_SIZE; y++)
+  {
+    for (uint32_t x=0; x < ICON_SIZE; x++)
+    {
+      uint8_t* p = &pixels[((size_t) y * ICON_SIZE + x) * 4];
+      int dx = (int) x - (int) ICON_SIZE / 2, dy = (int) y - (int) ICON_SIZE / 2;
+      bool inside = dx * dx + dy * dy < (int) (ICON_SIZE * ICON_SIZE / 8);
+      p[0] = (uint8_t) (inside ? 40 + object % 200 : (x + y) * 2);
+      p[1] = (uint8_t) (inside ? 100 : x * 4);
+      p[2] = (uint8_t) (inside ? 160 : y * 4);
+      p[3] = inside ? 255 : 0;
+    }
+  }
+  encoded.clear();
+  IconEncode(pixels.data(), ICON_SIZE, ICON_SIZE, 4, encoded);
+}
+
+/// ***************************************************************************
+/// Replays the icon requests against a least-recently-used cache of
+/// decoded icons with a budget of \p budget bytes, like the plugin's icon
+/// cache. Objects without a custom icon are skipped.
+/// ***************************************************************************
+static void ReplayIcons(std::vector<TraceEvent> const& events, size_t budget)
+{
+  std::unordered_map<uint32_t, std::vector<uint8_t>> icons;
+  std::list<uint32_t> lru;
+  std::unordered_map<uint32_t, std::list<uint32_t>::iterator> lookup;
+  const size_t iconBytes = (size_t) ICON_SIZE * ICON_SIZE * 4;
+  size_t requests = 0, misses = 0;
+  uint64_t recorded = 0;
+  double decodeTime = 0.0;
+  std::vector<uint8_t> pixels;
+
+  for (TraceEvent const& event : events)
+  {
+    if (event.type != TRACEEVENT_GETCUSTOMICON || event.arg == 0) continue;
+    requests++;
+    recorded += event.duration;
+    auto it = lookup.find(event.object);
+    if (it != lookup.end())
+    {
+      lru.splice(lru.begin(), lru, it->second);
+      continue;
+    }
+
+    misses++;
+    std::vector<uint8_t>& encoded = icons[event.object];
+    if (encoded.empty()) MakeIcon(event.object, encoded);
+    uint32_t width, height, channels;
+    Clock::time_point start = Clock::now();
+    IconDecode(encoded.data(), encoded.size(), pixels, width, height, channels);
+    decodeTime += Seconds(start);
+
+    lru.push_front(event.object);
+    lookup[event.object] = lru.begin();
+    while (lru.size() * iconBytes > budget && lru.size() > 1)
+    {
+      lookup.erase(lru.back());
+      lru.pop_back();
+    }
+  }
+
+  if (requests == 0) return;
+  printf("\nicons: %zu requests, %zu decodes (%.1f%% hits) with a %.1f MB budget\n",
+    requests, misses, 100.0 * (requests - misses) / requests, budget / (1024.0 * 1024.0));
+  printf("icons: %.2f ms decoding, %.2f ms recorded in GetCustomIcon\n",
+    decodeTime * 1e3, recorded / 1e3);
+}
+
+/// ***************************************************************************
+/// Replays the bounding box measurements with the recorded number of
+/// points through the bounds kernel.
+/// ***************************************************************************
+static void ReplayBounds(std::vector<TraceEvent> const& events)
+{
+  std::vector<double> xyz;
+  size_t measures = 0, points = 0;
+  uint64_t recorded = 0;
+  double time = 0.0;
+  KernelTable const& kernels = GetKernels();
+  for (TraceEvent const& event : events)
+  {
+    if (event.type != TRACEEVENT_BBOX_MEASURE) continue;
+    measures++;
+    recorded += event.duration;
+    if (event.arg == 0) continue;
+    if (xyz.size() < (size_t) event.arg * 3)
+    {
+      size_t old = xyz.size();
+      xyz.resize((size_t) event.arg * 3);
+      for (size_t i=old; i < xyz.size(); i++)
+        xyz[i] = (double) ((i * 7919) % 1000) - 500.0;
+    }
+    double bbmin[3], bbmax[3];
+    Clock::time_point start = Clock::now();
+    kernels.boundsReduce(xyz.data(), event.arg, bbmin, bbmax);
+    time += Seconds(start);
+    points += event.arg;
+  }
+
+  if (measures == 0) return;
+  printf("\nbounds: %zu measures, %zu points through %s\n", measures, points,
+    kernels.boundsReduceName);
+  printf("bounds: %.2f ms reducing, %.2f ms recorded in the measures\n",
+    time * 1e3, recorded / 1e3);
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+static void Usage()
+{
+  printf("usage: replay [options] TRACE\n\n");
+  printf("Prints the calls recorded in TRACE and replays the icon requests and\n");
+  printf("bounding box measurements against the standalone plugin code.\n\n");
+  printf("  --window MS    time window for the burst analysis (default 16)\n");
+  printf("  --budget MB    budget of the icon cache for the replay (default 16)\n");
+  printf("  --scalar       use the scalar kernels only\n");
+  printf("  --no-replay    only print the analysis\n");
+}
+
+/// ***************************************************************************
+/// ***************************************************************************
+int main(int argc, char** argv)
+{
+  double window = 16.0;
+  double budget = 16.0;
+  bool scalar = false;
+  bool replay = true;
+  std::string filename;
+  for (int i=1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h"))
+    {
+      Usage();
+      return 0;
+    }
+    else if (!strcmp(argv[i], "--window") && i + 1 < argc)
+      window = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--budget") && i + 1 < argc)
+      budget = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--scalar"))
+      scalar = true;
+    else if (!strcmp(argv[i], "--no-replay"))
+      replay = false;
+    else
+      filename = argv[i];
+  }
+  if (filename.empty())
+  {
+    Usage();
+    return 2;
+  }
+
+  std::vector<TraceEvent> events;
+  if (!TraceReadFile(filename, events))
+  {
+    if (events.empty())
+    {
+      fprintf(stderr, "error: '%s' is not a valid trace\n", filename.c_str());
+      return 1;
+    }
+    // Cinema was probably closed without stopping the recording.
+    fprintf(stderr, "warning: '%s' is truncated, using the first %zu events\n",
+      filename.c_str(), events.size());
+  }
+
+  PrintSummary(events);
+  PrintBursts(events, (uint64_t) (window * 1e3));
+  if (replay)
+  {
+    KernelsInit(scalar ? CpuFeatures() : DetectCpuFeatures());
+    ReplayIcons(events, (size_t) (budget * 1024 * 1024));
+    ReplayBounds(events);
+  }
+  return 0;
+}